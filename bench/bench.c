@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "../src/cartridge.h"
+#include "../src/perfcounters.h"
+
+#define KIB_16 16 * 1024
+#define KIB_8  8  * 1024
+
+#define MAX_RESULTS    128
+#define MAX_NAME       64
+#define MAX_RUNS       64
+#define DEFAULT_RUNS   5
+#define DEFAULT_THRESHOLD 5.0
+
+typedef struct _BenchResult {
+    char name[MAX_NAME];
+    double value;
+} BenchResult;
+
+static BenchResult gBaseline[MAX_RESULTS];
+static uint32_t gBaselineCount;
+static double gThreshold = DEFAULT_THRESHOLD;
+static uint32_t gRegressions;
+static uint32_t gFailedChecks;
+
+/* Host counters over the timed runs of the last BenchMeasure, which the
+ * next BenchReport prints per unit of work. */
+static PerfCounters gPerf;
+static PerfSample gPerfSample;
+static uint64_t gPerfUnits;
+
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int CompareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double BenchMeasure(const BenchConfig *cfg, BenchWork work, void *ctx) {
+    double rates[MAX_RUNS];
+    uint32_t runs = cfg->runs;
+
+    work(ctx);
+
+    memset(&gPerfSample, 0, sizeof(gPerfSample));
+    gPerfUnits = 0;
+
+    for (uint32_t i = 0; i < runs; ++i) {
+        PerfSample before, after;
+
+        PerfCountersRead(&gPerf, &before);
+        double start = Now();
+        uint64_t units = work(ctx);
+        double elapsed = Now() - start;
+        PerfCountersRead(&gPerf, &after);
+
+        rates[i] = elapsed > 0 ? (double)units / elapsed : 0;
+        PerfSampleAdd(&gPerfSample, &before, &after);
+        gPerfUnits += units;
+    }
+
+    qsort(rates, runs, sizeof(double), CompareDoubles);
+    return rates[runs / 2];
+}
+
+static const BenchResult *FindBaseline(const char *name) {
+    for (uint32_t i = 0; i < gBaselineCount; ++i) {
+        if (strcmp(gBaseline[i].name, name) == 0)
+            return &gBaseline[i];
+    }
+    return NULL;
+}
+
+/* Every metric is a rate, so a lower value than the baseline is worse. */
+void BenchReport(const char *name, double value, const char *unit) {
+    printf("%s\t%.0f\t%s", name, value, unit);
+
+    if (gBaselineCount) {
+        const BenchResult *base = FindBaseline(name);
+
+        if (!base || base->value <= 0) {
+            printf("\t-\t-\tnew");
+        } else {
+            double delta = (value - base->value) / base->value * 100.0;
+            uint8_t regressed = delta < -gThreshold;
+
+            printf("\t%.0f\t%+.2f%%\t%s", base->value, delta, regressed ? "REGRESSION" : "ok");
+            gRegressions += regressed;
+        }
+    }
+
+    printf("\n");
+
+    /* A comment, so baselines and comparisons only see the rates. */
+    if (gPerf.open && gPerfUnits) {
+        char line[256];
+
+        PerfCountersFormat(&gPerf, &gPerfSample, gPerfUnits, line, sizeof(line));
+        printf("# %s per unit: %s\n", name, line);
+        gPerfUnits = 0;
+    }
+
+    fflush(stdout);
+}
+
+void BenchSkip(const char *name, const char *reason) {
+    printf("# %s skipped: %s\n", name, reason);
+    fflush(stdout);
+}
+
+void BenchCheck(const char *name, uint8_t ok, const char *detail) {
+    if (ok) {
+        printf("# %s ok\n", name);
+    } else {
+        printf("# %s FAILED: %s\n", name, detail);
+        ++gFailedChecks;
+    }
+    fflush(stdout);
+}
+
+static uint8_t LoadBaseline(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Couldn't open baseline %s\n", path);
+        return 0;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) && gBaselineCount < MAX_RESULTS) {
+        BenchResult *result = &gBaseline[gBaselineCount];
+
+        if (line[0] == '#')
+            continue;
+
+        if (sscanf(line, "%63s %lf", result->name, &result->value) == 2)
+            ++gBaselineCount;
+    }
+
+    fclose(file);
+    return 1;
+}
+
+Cartridge *BenchSyntheticCart(const uint8_t *program, uint16_t len, uint16_t nmiOffset) {
+    Cartridge *cart = malloc(sizeof(Cartridge));
+
+    cart->mapper = &mappers[0];
+    cart->prgBanks = 1;
+    cart->chrBanks = 1;
+    cart->prg = calloc(1, KIB_16);
+    cart->chr = calloc(1, KIB_8);
+    cart->mirroring = MIRROR_HORIZONTAL;
+    cart->vram = NULL;
+    cart->prgRam = calloc(1, PRG_RAM_SIZE);
+    cart->battery = 0;
+    cart->saveMapped = 0;
+
+    if (len)
+        memcpy(cart->prg, program, len);
+
+    /* $C000 is at the start of the bank, vectors at its end. */
+    uint16_t nmi = 0xC000 + nmiOffset;
+    cart->prg[0x3FFA] = nmi & 0xFF;
+    cart->prg[0x3FFB] = nmi >> 8;
+    cart->prg[0x3FFC] = 0x00;
+    cart->prg[0x3FFD] = 0xC0;
+    cart->prg[0x3FFE] = nmi & 0xFF;
+    cart->prg[0x3FFF] = nmi >> 8;
+
+    return cart;
+}
+
+Cartridge *BenchLoadRom(const char *path) {
+    return CartridgeLoadFile(path);
+}
+
+void BenchFreeCart(Cartridge *cart) {
+    CartridgeDestroy(cart);
+    free(cart);
+}
+
+static void Usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [--rom nestest.nes] [--runs N] [--baseline FILE] [--threshold PCT]\n"
+            "Prints one \"name value unit\" line per metric. With --baseline, appends\n"
+            "the baseline value, the change and ok/REGRESSION, and exits with 1 if\n"
+            "any metric dropped more than the threshold (default %.0f%%).\n"
+            "Where perf_event_open allows, each metric is followed by a comment\n"
+            "with the host instructions, IPC and misses per unit of work.\n",
+            name, DEFAULT_THRESHOLD);
+}
+
+int32_t main(int32_t argc, char **argv) {
+    BenchConfig cfg = {"test_roms/nestest.nes", DEFAULT_RUNS};
+    const char *baseline = NULL;
+
+    for (int32_t i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+            cfg.romPath = argv[++i];
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            cfg.runs = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            gThreshold = strtod(argv[++i], NULL);
+        } else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (cfg.runs == 0 || cfg.runs > MAX_RUNS) {
+        fprintf(stderr, "--runs must be between 1 and %d\n", MAX_RUNS);
+        return 2;
+    }
+
+    if (baseline && !LoadBaseline(baseline))
+        return 2;
+
+    printf("# nes-bench runs=%u%s\n", cfg.runs,
+           PerfCountersOpen(&gPerf) ? "" : " (no host counters)");
+
+    BenchCpu(&cfg);
+    BenchMemory(&cfg);
+    BenchPpu(&cfg);
+    BenchSystem(&cfg);
+    BenchHash(&cfg);
+    BenchPalette(&cfg);
+    BenchScaler(&cfg);
+    BenchVecEnv(&cfg);
+
+    if (gFailedChecks) {
+        fprintf(stderr, "%u check(s) failed\n", gFailedChecks);
+        return 1;
+    }
+
+    if (gRegressions) {
+        fprintf(stderr, "%u metric(s) regressed more than %.1f%%\n", gRegressions, gThreshold);
+        return 1;
+    }
+
+    return 0;
+}
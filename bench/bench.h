@@ -0,0 +1,42 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+
+#define BENCH_DOTS_PER_FRAME (341 * 262)
+
+typedef struct _Cartridge Cartridge;
+
+typedef struct _BenchConfig {
+    const char *romPath;
+    uint32_t runs;
+} BenchConfig;
+
+/* Does a fixed amount of work and returns how many units it processed. */
+typedef uint64_t (*BenchWork)(void *ctx);
+
+/* Runs work once to warm up and then cfg->runs times, returning the median
+ * rate in units per second. */
+double BenchMeasure(const BenchConfig *cfg, BenchWork work, void *ctx);
+void BenchReport(const char *name, double value, const char *unit);
+void BenchSkip(const char *name, const char *reason);
+/* For the few things the bench has to get right before timing means
+ * anything. A failed check makes the bench exit with 1. */
+void BenchCheck(const char *name, uint8_t ok, const char *detail);
+
+/* NROM-128 cartridge with program at $C000, which is also the reset vector,
+ * and the NMI vector pointing at nmiOffset inside program. */
+Cartridge *BenchSyntheticCart(const uint8_t *program, uint16_t len, uint16_t nmiOffset);
+Cartridge *BenchLoadRom(const char *path);
+void BenchFreeCart(Cartridge *cart);
+
+void BenchCpu(const BenchConfig *cfg);
+void BenchMemory(const BenchConfig *cfg);
+void BenchPpu(const BenchConfig *cfg);
+void BenchSystem(const BenchConfig *cfg);
+void BenchHash(const BenchConfig *cfg);
+void BenchPalette(const BenchConfig *cfg);
+void BenchScaler(const BenchConfig *cfg);
+void BenchVecEnv(const BenchConfig *cfg);
+
+#endif
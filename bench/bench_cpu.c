@@ -0,0 +1,111 @@
+#include "bench.h"
+#include "../src/cpu.h"
+#include "../src/memory.h"
+
+#define CYCLES_PER_RUN     4000000
+/* nestest's official opcode tests end after about this many cycles. */
+#define NESTEST_PASS_CYCLES 14579
+#define NESTEST_START       0xC000
+
+typedef struct _CpuBench {
+    Cartridge *cart;
+    Memory mem;
+    Cpu cpu;
+    uint64_t totalCycles;
+} CpuBench;
+
+/* Accumulator, flags and zeropage read-modify-write in a tight loop. */
+static const uint8_t gAluLoop[] = {
+    0xA2, 0x00,       /* C000 LDX #$00     */
+    0xA9, 0x01,       /* C002 LDA #$01     */
+    0x18,             /* C004 CLC          */
+    0x65, 0x10,       /* C005 ADC $10      */
+    0x85, 0x10,       /* C007 STA $10      */
+    0x2A,             /* C009 ROL A        */
+    0x49, 0xFF,       /* C00A EOR #$FF     */
+    0xE8,             /* C00C INX          */
+    0xD0, 0xF3,       /* C00D BNE $C002    */
+    0x4C, 0x00, 0xC0, /* C00F JMP $C000    */
+    0x40              /* C012 RTI          */
+};
+
+/* Indexed and indirect loads/stores across RAM and PRG. */
+static const uint8_t gMemoryLoop[] = {
+    0xA9, 0x00,       /* C000 LDA #$00     */
+    0x85, 0x20,       /* C002 STA $20      */
+    0xA9, 0x03,       /* C004 LDA #$03     */
+    0x85, 0x21,       /* C006 STA $21      */
+    0xA0, 0x00,       /* C008 LDY #$00     */
+    0xB9, 0x00, 0xC1, /* C00A LDA $C100,Y  */
+    0x99, 0x00, 0x02, /* C00D STA $0200,Y  */
+    0xB1, 0x20,       /* C010 LDA ($20),Y  */
+    0x91, 0x20,       /* C012 STA ($20),Y  */
+    0xC8,             /* C014 INY          */
+    0xD0, 0xF3,       /* C015 BNE $C00A    */
+    0x4C, 0x08, 0xC0, /* C017 JMP $C008    */
+    0x40              /* C01A RTI          */
+};
+
+static void Reset(CpuBench *bench) {
+    bench->totalCycles = 0;
+    MemoryInit(&bench->mem, bench->cart, &bench->totalCycles);
+    CpuInit(&bench->cpu, &bench->mem, &bench->totalCycles);
+}
+
+static uint64_t RunCycles(CpuBench *bench, uint64_t cycles) {
+    uint64_t instructions = 0;
+
+    for (uint64_t i = 0; i < cycles; ++i)
+        instructions += CpuEmulate(&bench->cpu);
+
+    return instructions;
+}
+
+static uint64_t SyntheticWork(void *ctx) {
+    return RunCycles(ctx, CYCLES_PER_RUN);
+}
+
+static uint64_t NestestWork(void *ctx) {
+    CpuBench *bench = ctx;
+    uint64_t instructions = 0;
+
+    for (uint32_t pass = 0; pass < CYCLES_PER_RUN / NESTEST_PASS_CYCLES; ++pass) {
+        Reset(bench);
+
+        /* Take the reset interrupt, then jump to the automated test entry. */
+        CpuEmulate(&bench->cpu);
+        bench->cpu.regs.pc = NESTEST_START;
+
+        instructions += RunCycles(bench, NESTEST_PASS_CYCLES);
+    }
+
+    return instructions;
+}
+
+static void RunSynthetic(const BenchConfig *cfg, const char *name,
+                         const uint8_t *program, uint16_t len) {
+    CpuBench bench;
+
+    bench.cart = BenchSyntheticCart(program, len, len - 1);
+    Reset(&bench);
+
+    BenchReport(name, BenchMeasure(cfg, SyntheticWork, &bench), "instr/s");
+
+    BenchFreeCart(bench.cart);
+}
+
+void BenchCpu(const BenchConfig *cfg) {
+    RunSynthetic(cfg, "cpu.loop_alu", gAluLoop, sizeof(gAluLoop));
+    RunSynthetic(cfg, "cpu.loop_memory", gMemoryLoop, sizeof(gMemoryLoop));
+
+    CpuBench bench;
+    bench.cart = BenchLoadRom(cfg->romPath);
+    if (!bench.cart) {
+        BenchSkip("cpu.nestest", "no nestest ROM (use --rom)");
+        return;
+    }
+
+    BenchReport("cpu.nestest", BenchMeasure(cfg, NestestWork, &bench), "instr/s");
+
+    BenchFreeCart(bench.cart);
+}
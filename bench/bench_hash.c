@@ -0,0 +1,33 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/hash.h"
+#include "../src/ppu.h"
+
+#define HASHES_PER_RUN 2000
+
+static volatile uint32_t gSink;
+
+static uint64_t FrameHashWork(void *ctx) {
+    const uint8_t *frame = ctx;
+    uint32_t hash = 0;
+
+    for (uint32_t i = 0; i < HASHES_PER_RUN; ++i)
+        hash ^= HashFrame(frame);
+
+    gSink = hash;
+    return HASHES_PER_RUN;
+}
+
+/* Compare against ppu.frames: hashing should stay well under 1% of a frame. */
+void BenchHash(const BenchConfig *cfg) {
+    uint8_t *frame = malloc(PPU_WIDTH * PPU_HEIGHT);
+
+    srand(1);
+    for (uint32_t i = 0; i < PPU_WIDTH * PPU_HEIGHT; ++i)
+        frame[i] = rand() & 0x3F;
+
+    BenchReport("hash.frame", BenchMeasure(cfg, FrameHashWork, frame), "frames/s");
+
+    free(frame);
+}
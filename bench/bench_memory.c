@@ -0,0 +1,93 @@
+#include <stddef.h>
+
+#include "bench.h"
+#include "../src/memory.h"
+#include "../src/ppu.h"
+#include "../src/coverage.h"
+
+#define OPS_PER_RUN 8000000
+#define OAM_DMAS_PER_RUN 200000
+
+typedef struct _Region {
+    const char *readName;
+    const char *writeName;
+    uint16_t base;
+    uint16_t mask;
+} Region;
+
+typedef struct _MemoryBench {
+    Memory mem;
+    Ppu ppu;
+    const Region *region;
+    uint64_t totalCycles;
+} MemoryBench;
+
+static const Region gRegions[] = {
+    {"mem.read.ram",  "mem.write.ram",  0x0000, 0x1FFF},
+    {"mem.read.ppu",  "mem.write.ppu",  0x2000, 0x1FFF},
+    /* Stops short of $4014, which has its own metric. */
+    {"mem.read.io",   "mem.write.io",   0x4000, 0x000F},
+    {"mem.read.cart", "mem.write.cart", 0x8000, 0x7FFF}
+};
+
+static volatile uint8_t gSink;
+
+static uint64_t ReadWork(void *ctx) {
+    MemoryBench *bench = ctx;
+    uint16_t base = bench->region->base;
+    uint16_t mask = bench->region->mask;
+    uint8_t sum = 0;
+
+    for (uint32_t i = 0; i < OPS_PER_RUN; ++i)
+        sum += ReadCpuByte(&bench->mem, base + (i & mask));
+
+    gSink = sum;
+    return OPS_PER_RUN;
+}
+
+static uint64_t WriteWork(void *ctx) {
+    MemoryBench *bench = ctx;
+    uint16_t base = bench->region->base;
+    uint16_t mask = bench->region->mask;
+
+    for (uint32_t i = 0; i < OPS_PER_RUN; ++i)
+        WriteCpuByte(&bench->mem, base + (i & mask), (uint8_t)i);
+
+    return OPS_PER_RUN;
+}
+
+static uint64_t OamDmaWork(void *ctx) {
+    MemoryBench *bench = ctx;
+
+    for (uint32_t i = 0; i < OAM_DMAS_PER_RUN; ++i)
+        WriteCpuByte(&bench->mem, OAMDMA, i & 0x07);
+
+    return OAM_DMAS_PER_RUN;
+}
+
+void BenchMemory(const BenchConfig *cfg) {
+    MemoryBench bench;
+    Cartridge *cart = BenchSyntheticCart(NULL, 0, 0);
+
+    bench.totalCycles = 0;
+    MemoryInit(&bench.mem, cart, &bench.totalCycles);
+    PpuInit(&bench.ppu, &bench.mem, &bench.totalCycles);
+
+    for (uint32_t i = 0; i < sizeof(gRegions) / sizeof(gRegions[0]); ++i) {
+        bench.region = &gRegions[i];
+
+        BenchReport(bench.region->readName, BenchMeasure(cfg, ReadWork, &bench), "ops/s");
+        BenchReport(bench.region->writeName, BenchMeasure(cfg, WriteWork, &bench), "ops/s");
+    }
+
+    BenchReport("mem.oam_dma", BenchMeasure(cfg, OamDmaWork, &bench), "copies/s");
+
+    /* PRG reads with coverage on, against mem.read.cart without. */
+    bench.mem.coverage = CoverageCreate(cart);
+    MemoryMapPages(&bench.mem);
+    bench.region = &gRegions[sizeof(gRegions) / sizeof(gRegions[0]) - 1];
+    BenchReport("mem.read.cart.coverage", BenchMeasure(cfg, ReadWork, &bench), "ops/s");
+    CoverageDestroy(bench.mem.coverage);
+
+    BenchFreeCart(cart);
+}
@@ -0,0 +1,72 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/palette.h"
+#include "../src/ppu.h"
+
+#define FRAMES_PER_RUN 500
+
+typedef struct _PaletteBench {
+    Palette palette;
+    PaletteRowFn convertRow;
+    uint8_t *frame;
+    uint8_t emphasis[PPU_HEIGHT];
+    uint32_t *pixels;
+} PaletteBench;
+
+static uint64_t RowWork(void *ctx) {
+    PaletteBench *bench = ctx;
+
+    for (uint32_t i = 0; i < FRAMES_PER_RUN; ++i) {
+        for (uint16_t y = 0; y < PPU_HEIGHT; ++y)
+            bench->convertRow(bench->palette.rgba, bench->frame + y * PPU_WIDTH,
+                              bench->pixels + y * PPU_WIDTH, PPU_WIDTH);
+    }
+
+    return (uint64_t)FRAMES_PER_RUN * PPU_WIDTH * PPU_HEIGHT;
+}
+
+static uint64_t FrameWork(void *ctx) {
+    PaletteBench *bench = ctx;
+
+    for (uint32_t i = 0; i < FRAMES_PER_RUN; ++i)
+        PaletteConvertFrame(&bench->palette, bench->frame, bench->emphasis, bench->pixels);
+
+    return (uint64_t)FRAMES_PER_RUN * PPU_WIDTH * PPU_HEIGHT;
+}
+
+static void RunKernel(const BenchConfig *cfg, const char *name, PALETTE_KERNEL kernel,
+                      PaletteBench *bench) {
+    bench->convertRow = PaletteRowKernel(kernel);
+
+    if (!bench->convertRow) {
+        BenchSkip(name, "not supported by this CPU");
+        return;
+    }
+
+    BenchReport(name, BenchMeasure(cfg, RowWork, bench), "pixels/s");
+}
+
+void BenchPalette(const BenchConfig *cfg) {
+    PaletteBench *bench = aligned_alloc(_Alignof(PaletteBench), sizeof(PaletteBench));
+
+    bench->frame = malloc(PPU_WIDTH * PPU_HEIGHT);
+    bench->pixels = malloc(PPU_WIDTH * PPU_HEIGHT * sizeof(uint32_t));
+    PaletteInitDefault(&bench->palette);
+
+    srand(1);
+    for (uint32_t i = 0; i < PPU_WIDTH * PPU_HEIGHT; ++i)
+        bench->frame[i] = rand() & 0x3F;
+
+    /* A game flipping emphasis every few lines, to cover the LUT switch. */
+    for (uint16_t y = 0; y < PPU_HEIGHT; ++y)
+        bench->emphasis[y] = (y / 8) & (PALETTE_EMPHASIS_NUM - 1);
+
+    RunKernel(cfg, "palette.row.scalar", PALETTE_KERNEL_SCALAR, bench);
+    RunKernel(cfg, "palette.row.avx2", PALETTE_KERNEL_AVX2, bench);
+    BenchReport("palette.frame", BenchMeasure(cfg, FrameWork, bench), "pixels/s");
+
+    free(bench->frame);
+    free(bench->pixels);
+    free(bench);
+}
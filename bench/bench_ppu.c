@@ -0,0 +1,48 @@
+#include <stddef.h>
+
+#include "bench.h"
+#include "../src/memory.h"
+#include "../src/ppu.h"
+
+#define FRAMES_PER_RUN 60
+
+typedef struct _PpuBench {
+    Memory mem;
+    Ppu ppu;
+    uint64_t totalCycles;
+} PpuBench;
+
+static uint64_t DotsWork(void *ctx) {
+    PpuBench *bench = ctx;
+    uint64_t dots = (uint64_t)FRAMES_PER_RUN * BENCH_DOTS_PER_FRAME;
+
+    for (uint64_t i = 0; i < dots; ++i)
+        PpuEmulate(&bench->ppu);
+
+    return dots;
+}
+
+void BenchPpu(const BenchConfig *cfg) {
+    PpuBench bench;
+    Cartridge *cart = BenchSyntheticCart(NULL, 0, 0);
+
+    bench.totalCycles = 0;
+    MemoryInit(&bench.mem, cart, &bench.totalCycles);
+    PpuInit(&bench.ppu, &bench.mem, &bench.totalCycles);
+
+    /* Keep the NMI path and both layers live the way a game would. */
+    WriteCpuByte(&bench.mem, PPUCTRL, PPUCTRL_GENERATE_NMI_AT_VBLANK_BIT);
+    WriteCpuByte(&bench.mem, PPUMASK, PPUMASK_BG_BIT | PPUMASK_SPRITES_BIT);
+
+    double dots = BenchMeasure(cfg, DotsWork, &bench);
+    BenchReport("ppu.dots", dots, "dots/s");
+    BenchReport("ppu.frames", dots / BENCH_DOTS_PER_FRAME, "frames/s");
+
+    /* Frame-skip mode: status flags only, no pixels. */
+    bench.ppu.renderPixels = 0;
+
+    dots = BenchMeasure(cfg, DotsWork, &bench);
+    BenchReport("ppu.frames_skipped", dots / BENCH_DOTS_PER_FRAME, "frames/s");
+
+    BenchFreeCart(cart);
+}
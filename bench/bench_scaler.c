@@ -0,0 +1,79 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/palette.h"
+#include "../src/ppu.h"
+#include "../src/scaler.h"
+
+#define FRAMES_PER_RUN 20
+
+typedef struct _ScalerBench {
+    Scaler scaler;
+    uint32_t *rgba;
+} ScalerBench;
+
+static uint64_t FrameWork(void *ctx) {
+    ScalerBench *bench = ctx;
+
+    for (uint32_t i = 0; i < FRAMES_PER_RUN; ++i)
+        ScalerRun(&bench->scaler, bench->rgba);
+
+    return FRAMES_PER_RUN;
+}
+
+static void RunFilter(const BenchConfig *cfg, const char *name, SCALE_FILTER filter, uint32_t factor,
+                      SCALE_KERNEL kernel, ScalerBench *bench) {
+    if (!ScalerInit(&bench->scaler, filter, factor, kernel)) {
+        BenchSkip(name, "not supported by this CPU");
+        return;
+    }
+
+    BenchReport(name, BenchMeasure(cfg, FrameWork, bench), "frames/s");
+    ScalerDestroy(&bench->scaler);
+}
+
+static void RunKernels(const BenchConfig *cfg, const char *names[3], SCALE_FILTER filter,
+                       uint32_t factor, ScalerBench *bench) {
+    RunFilter(cfg, names[0], filter, factor, SCALE_KERNEL_SCALAR, bench);
+    RunFilter(cfg, names[1], filter, factor, SCALE_KERNEL_SSE2, bench);
+    RunFilter(cfg, names[2], filter, factor, SCALE_KERNEL_AVX2, bench);
+}
+
+void BenchScaler(const BenchConfig *cfg) {
+    static const char *nearest[3] = {"scale.nearest4x.scalar", "scale.nearest4x.sse2", "scale.nearest4x.avx2"};
+    static const char *scanlines[3] = {"scale.scanlines4x.scalar", "scale.scanlines4x.sse2",
+                                       "scale.scanlines4x.avx2"};
+    static const char *scale2x[3] = {"scale.scale2x4x.scalar", "scale.scale2x4x.sse2", "scale.scale2x4x.avx2"};
+    static const char *scale3x[3] = {"scale.scale3x3x.scalar", "scale.scale3x3x.sse2", "scale.scale3x3x.avx2"};
+    ScalerBench *bench = malloc(sizeof(ScalerBench));
+    uint8_t *frame = malloc(PPU_WIDTH * PPU_HEIGHT);
+    uint8_t emphasis[PPU_HEIGHT] = {0};
+    Palette palette;
+
+    /* Flat 4x4 blocks, so the Scale2x/3x rules see both edges and runs. */
+    srand(1);
+    for (uint16_t y = 0; y < PPU_HEIGHT; y += 4) {
+        for (uint16_t x = 0; x < PPU_WIDTH; x += 4) {
+            uint8_t color = rand() & 0x3F;
+
+            for (uint16_t i = 0; i < 4; ++i) {
+                for (uint16_t j = 0; j < 4; ++j)
+                    frame[(y + i) * PPU_WIDTH + x + j] = color;
+            }
+        }
+    }
+
+    bench->rgba = malloc(PPU_WIDTH * PPU_HEIGHT * sizeof(uint32_t));
+    PaletteInitDefault(&palette);
+    PaletteConvertFrame(&palette, frame, emphasis, bench->rgba);
+
+    RunKernels(cfg, nearest, SCALE_NEAREST, 4, bench);
+    RunKernels(cfg, scanlines, SCALE_SCANLINES, 4, bench);
+    RunKernels(cfg, scale2x, SCALE_2X, 4, bench);
+    /* Scale3x has no 4x mode. */
+    RunKernels(cfg, scale3x, SCALE_3X, 3, bench);
+
+    free(frame);
+    free(bench->rgba);
+    free(bench);
+}
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/nes.h"
+#include "../src/cpu.h"
+#include "../src/memory.h"
+#include "../src/ppu.h"
+
+#define FRAMES_PER_RUN 60
+
+typedef struct _SystemBench {
+    Memory mem;
+    Cpu cpu;
+    Ppu ppu;
+    uint64_t totalCycles;
+} SystemBench;
+
+/* Polls VBlank the way a game's main loop waits for the next frame. */
+static const uint8_t gVblankLoop[] = {
+    0xAD, 0x02, 0x20, /* C000 LDA $2002    */
+    0x10, 0xFB,       /* C003 BPL $C000    */
+    0xE6, 0x10,       /* C005 INC $10      */
+    0x4C, 0x00, 0xC0, /* C007 JMP $C000    */
+    0x40              /* C00A RTI          */
+};
+
+/* Calls a short subroutine over and over, for the profiler to follow. */
+static const uint8_t gCallLoop[] = {
+    0x20, 0x06, 0xC0, /* C000 JSR $C006    */
+    0x4C, 0x00, 0xC0, /* C003 JMP $C000    */
+    0xA2, 0x08,       /* C006 LDX #$08     */
+    0xCA,             /* C008 DEX          */
+    0xD0, 0xFD,       /* C009 BNE $C008    */
+    0x60,             /* C00B RTS          */
+    0x40              /* C00C RTI          */
+};
+
+/* Hammers the PPU registers, for the trace to record. */
+static const uint8_t gPpuLoop[] = {
+    0xAD, 0x02, 0x20, /* C000 LDA $2002    */
+    0x8D, 0x06, 0x20, /* C003 STA $2006    */
+    0x8D, 0x07, 0x20, /* C006 STA $2007    */
+    0x4C, 0x00, 0xC0, /* C009 JMP $C000    */
+    0x40              /* C00C RTI          */
+};
+
+/* Same stepping as NesRunFrame. */
+static uint64_t FramesWork(void *ctx) {
+    SystemBench *bench = ctx;
+    uint64_t cycles = (uint64_t)FRAMES_PER_RUN * BENCH_DOTS_PER_FRAME / 3;
+
+    for (uint64_t i = 0; i < cycles; ++i) {
+        CpuEmulate(&bench->cpu);
+
+        PpuEmulate(&bench->ppu);
+        PpuEmulate(&bench->ppu);
+        PpuEmulate(&bench->ppu);
+
+        if (bench->ppu.needsNmi) {
+            CpuRequestInterrupt(&bench->cpu, NMI);
+            bench->ppu.needsNmi = 0;
+        }
+    }
+
+    return FRAMES_PER_RUN;
+}
+
+static void Run(const BenchConfig *cfg, const char *name, Cartridge *cart) {
+    SystemBench bench;
+
+    bench.totalCycles = 0;
+    MemoryInit(&bench.mem, cart, &bench.totalCycles);
+    CpuInit(&bench.cpu, &bench.mem, &bench.totalCycles);
+    PpuInit(&bench.ppu, &bench.mem, &bench.totalCycles);
+
+    BenchReport(name, BenchMeasure(cfg, FramesWork, &bench), "frames/s");
+
+    BenchFreeCart(cart);
+}
+
+static uint64_t NesFramesWork(void *ctx) {
+    Nes *nes = ctx;
+
+    for (uint32_t i = 0; i < FRAMES_PER_RUN; ++i)
+        NesRunFrame(nes);
+
+    return FRAMES_PER_RUN;
+}
+
+static uint8_t SetSampling(Nes *nes, uint8_t on) {
+    NesSetSampling(nes, on);
+    return 1;
+}
+
+/* attach, when given, is NesSetProfiler or the like, turned on first. */
+static void RunNes(const BenchConfig *cfg, const char *name, const uint8_t *program, uint16_t len,
+                   uint8_t (*attach)(Nes *, uint8_t)) {
+    Nes *nes = aligned_alloc(_Alignof(Nes), sizeof(Nes));
+
+    NesInitCart(nes, BenchSyntheticCart(program, len, len - 1));
+    if (attach)
+        attach(nes, 1);
+
+    BenchReport(name, BenchMeasure(cfg, NesFramesWork, nes), "frames/s");
+
+    NesDestroy(nes);
+    free(nes);
+}
+
+/* Stopping at a breakpoint and resuming must leave the machine exactly
+ * where an uninterrupted run would be. */
+static void CheckBreakpointResume(void) {
+    uint32_t hashes[2];
+    uint32_t hits = 0;
+    char detail[64];
+
+    for (uint8_t stop = 0; stop < 2; ++stop) {
+        Nes *nes = aligned_alloc(_Alignof(Nes), sizeof(Nes));
+
+        NesInitCart(nes, BenchSyntheticCart(gCallLoop, sizeof(gCallLoop), sizeof(gCallLoop) - 1));
+        nes->idleSkip = 0;
+        if (stop)
+            DebuggerAddBreakpoint(&nes->debugger, 0xC008);
+
+        for (uint32_t i = 0; i < FRAMES_PER_RUN; ++i) {
+            while (!NesRunFrame(nes)) {
+                DebuggerResume(&nes->debugger);
+                ++hits;
+            }
+        }
+
+        hashes[stop] = NesStateHash(nes);
+        NesDestroy(nes);
+        free(nes);
+    }
+
+    snprintf(detail, sizeof(detail), "%u hits, state %08x instead of %08x",
+             hits, hashes[1], hashes[0]);
+    BenchCheck("system.breakpoint_resume", hits && hashes[0] == hashes[1], detail);
+}
+
+void BenchSystem(const BenchConfig *cfg) {
+    CheckBreakpointResume();
+
+    Run(cfg, "system.vblank_loop", BenchSyntheticCart(gVblankLoop, sizeof(gVblankLoop), sizeof(gVblankLoop) - 1));
+    RunNes(cfg, "system.call_loop", gCallLoop, sizeof(gCallLoop), NULL);
+    RunNes(cfg, "system.call_loop.profiled", gCallLoop, sizeof(gCallLoop), NesSetProfiler);
+    RunNes(cfg, "system.call_loop.sampled", gCallLoop, sizeof(gCallLoop), SetSampling);
+    RunNes(cfg, "system.ppu_loop", gPpuLoop, sizeof(gPpuLoop), NULL);
+    RunNes(cfg, "system.ppu_loop.traced", gPpuLoop, sizeof(gPpuLoop), NesSetTrace);
+
+    Cartridge *cart = BenchLoadRom(cfg->romPath);
+    if (!cart) {
+        BenchSkip("system.nestest", "no nestest ROM (use --rom)");
+        return;
+    }
+
+    Run(cfg, "system.nestest", cart);
+}
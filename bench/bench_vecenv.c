@@ -0,0 +1,64 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/vecenv.h"
+#include "../src/cartridge.h"
+
+#define ENV_NUM         64
+#define FRAMES_PER_STEP 4
+
+/* Counts frames into RAM and polls the pad, so every env has work to do. */
+static const uint8_t gPadLoop[] = {
+    0xAD, 0x02, 0x20, /* C000 LDA $2002    */
+    0x10, 0xFB,       /* C003 BPL $C000    */
+    0xA9, 0x01,       /* C005 LDA #$01     */
+    0x8D, 0x16, 0x40, /* C007 STA $4016    */
+    0xAD, 0x16, 0x40, /* C00A LDA $4016    */
+    0xE6, 0x10,       /* C00D INC $10      */
+    0x4C, 0x00, 0xC0, /* C00F JMP $C000    */
+    0x40              /* C012 RTI          */
+};
+
+typedef struct _VecEnvBench {
+    VecEnv *venv;
+    uint8_t actions[ENV_NUM * CONTROLLER_NUM];
+    VecEnvOutput out;
+} VecEnvBench;
+
+static uint64_t StepWork(void *ctx) {
+    VecEnvBench *bench = ctx;
+
+    VecEnvStep(bench->venv, bench->actions, FRAMES_PER_STEP, &bench->out);
+
+    return (uint64_t)ENV_NUM * FRAMES_PER_STEP;
+}
+
+static void Run(const BenchConfig *cfg, const char *name, Cartridge *cart, uint32_t threads) {
+    VecEnvBench bench = {0};
+
+    bench.venv = VecEnvCreateCart(cart, ENV_NUM, threads);
+    if (!bench.venv) {
+        BenchSkip(name, "couldn't create the environments");
+        return;
+    }
+
+    bench.out.frames = malloc((size_t)ENV_NUM * PPU_WIDTH * PPU_HEIGHT);
+    bench.out.ram = malloc((size_t)ENV_NUM * CPU_RAM_SIZE);
+    bench.out.hashes = malloc(ENV_NUM * sizeof(uint32_t));
+
+    BenchReport(name, BenchMeasure(cfg, StepWork, &bench), "env-frames/s");
+
+    free(bench.out.frames);
+    free(bench.out.ram);
+    free(bench.out.hashes);
+    VecEnvDestroy(bench.venv);
+}
+
+void BenchVecEnv(const BenchConfig *cfg) {
+    Cartridge *cart = BenchSyntheticCart(gPadLoop, sizeof(gPadLoop), sizeof(gPadLoop) - 1);
+
+    Run(cfg, "vecenv.step.1thread", cart, 1);
+    Run(cfg, "vecenv.step", cart, 0);
+
+    BenchFreeCart(cart);
+}
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../src/nes.h"
+
+/* blargg's protocol: $6000 holds the status once $6001-$6003 hold the
+ * signature, and $6004 on a NUL-terminated message. */
+#define STATUS_ADDR    0x6000
+#define SIGNATURE_ADDR 0x6001
+#define TEXT_ADDR      0x6004
+#define STATUS_RUNNING 0x80
+#define STATUS_RESET   0x81
+
+static const uint8_t gSignature[] = {0xDE, 0xB0, 0x61};
+
+/* The ROM wants reset pressed no sooner than 100ms after it asks. */
+#define RESET_DELAY_FRAMES 7
+
+#define MAX_ROMS        1024
+#define MAX_PATH        1024
+#define MAX_TEXT        512
+#define DEFAULT_TIMEOUT 120
+
+typedef enum _ROM_RESULT {
+    ROM_PASS,
+    ROM_FAIL,      /* A nonzero result, a jammed CPU or no memory to run it */
+    ROM_TIMEOUT,   /* Still running, or never wrote the signature */
+    ROM_UNLOADABLE /* An unsupported mapper, most likely */
+} ROM_RESULT;
+
+static const char *gResultNames[] = {"PASS", "FAIL", "TIMEOUT", "SKIP"};
+
+typedef struct _RomRun {
+    char path[MAX_PATH];
+
+    ROM_RESULT result;
+    uint8_t status;
+    uint8_t sawSignature;
+    uint8_t jammed;
+    uint8_t jamOpcode;
+    uint16_t jamPc;
+    char text[MAX_TEXT];
+    uint64_t frames;
+    double wallSeconds;
+} RomRun;
+
+typedef struct _Runner {
+    RomRun *runs;
+    uint32_t num;
+    atomic_uint next;
+    uint64_t timeoutFrames;
+} Runner;
+
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint8_t HasSignature(const Nes *nes) {
+    for (uint8_t i = 0; i < sizeof(gSignature); ++i) {
+        if (PeekCpuByte(&nes->mem, SIGNATURE_ADDR + i) != gSignature[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+static void ReadText(const Nes *nes, char *text) {
+    uint32_t i;
+
+    for (i = 0; i < MAX_TEXT - 1; ++i) {
+        text[i] = PeekCpuByte(&nes->mem, TEXT_ADDR + i);
+        if (!text[i])
+            break;
+    }
+
+    text[i] = '\0';
+}
+
+static void RunRom(RomRun *run, uint64_t timeoutFrames) {
+    Nes *nes = aligned_alloc(_Alignof(Nes), sizeof(Nes));
+    uint64_t resetFrame = 0;
+    double start = Now();
+
+    run->result = ROM_UNLOADABLE;
+    run->text[0] = '\0';
+
+    if (!nes) {
+        run->result = ROM_FAIL;
+        snprintf(run->text, MAX_TEXT, "Not enough memory for a Nes");
+        return;
+    }
+
+    if (!NesInitFile(nes, run->path)) {
+        free(nes);
+        return;
+    }
+
+    run->result = ROM_TIMEOUT;
+
+    for (run->frames = 0; run->frames < timeoutFrames; ++run->frames) {
+        NesRunFrame(nes);
+
+        /* Nothing runs again short of a reset, which the ROM didn't ask for. */
+        if (nes->cpu.jammed) {
+            run->result = ROM_FAIL;
+            run->jammed = 1;
+            run->jamPc = nes->cpu.regs.pc;
+            run->jamOpcode = PeekCpuByte(&nes->mem, run->jamPc);
+            ++run->frames;
+            break;
+        }
+
+        if (!HasSignature(nes))
+            continue;
+
+        run->sawSignature = 1;
+        run->status = PeekCpuByte(&nes->mem, STATUS_ADDR);
+
+        if (run->status == STATUS_RESET) {
+            if (!resetFrame)
+                resetFrame = run->frames + RESET_DELAY_FRAMES;
+            if (run->frames >= resetFrame) {
+                NesReset(nes);
+                resetFrame = 0;
+            }
+        } else if (run->status < STATUS_RUNNING) {
+            run->result = run->status == 0 ? ROM_PASS : ROM_FAIL;
+            ++run->frames;
+            break;
+        }
+    }
+
+    if (run->sawSignature)
+        ReadText(nes, run->text);
+
+    run->wallSeconds = Now() - start;
+    NesFree(nes);
+}
+
+static void *Worker(void *arg) {
+    Runner *runner = arg;
+    uint32_t index;
+
+    while ((index = atomic_fetch_add(&runner->next, 1)) < runner->num)
+        RunRom(&runner->runs[index], runner->timeoutFrames);
+
+    return NULL;
+}
+
+static uint8_t IsRom(const char *name) {
+    size_t len = strlen(name);
+    return len > 4 && strcmp(name + len - 4, ".nes") == 0;
+}
+
+static void AddRom(const char *path, RomRun *runs, uint32_t *num, uint32_t *dropped) {
+    if (*num < MAX_ROMS)
+        snprintf(runs[(*num)++].path, MAX_PATH, "%s", path);
+    else
+        ++*dropped;
+}
+
+/* Adds path if it's a ROM, or the ROMs under it if it's a directory.
+ * Symlinked directories below path are skipped, so a loop can't recurse
+ * forever. */
+static void Collect(const char *path, RomRun *runs, uint32_t *num, uint32_t *dropped) {
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Couldn't open %s\n", path);
+        return;
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        AddRom(path, runs, num, dropped);
+        return;
+    }
+
+    DIR *dir = opendir(path);
+    struct dirent *entry;
+
+    if (!dir) {
+        fprintf(stderr, "Couldn't open %s\n", path);
+        return;
+    }
+
+    while ((entry = readdir(dir))) {
+        char child[MAX_PATH];
+
+        if (entry->d_name[0] == '.')
+            continue;
+
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        if (lstat(child, &st) != 0)
+            continue;
+
+        if (S_ISDIR(st.st_mode))
+            Collect(child, runs, num, dropped);
+        else if (IsRom(entry->d_name))
+            AddRom(child, runs, num, dropped);
+    }
+
+    closedir(dir);
+}
+
+static int ComparePaths(const void *a, const void *b) {
+    return strcmp(((const RomRun *)a)->path, ((const RomRun *)b)->path);
+}
+
+/* The message with its lines indented under the ROM's. */
+static void PrintText(const char *text) {
+    const char *line = text;
+
+    while (*line) {
+        const char *end = strchr(line, '\n');
+        int32_t len = end ? end - line : (int32_t)strlen(line);
+
+        if (len)
+            printf("    %.*s\n", len, line);
+        line += len + (end != NULL);
+    }
+}
+
+static void Usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [--jobs N] [--timeout SECONDS] [--verbose] ROM|DIR...\n"
+            "Runs test ROMs that report through $6000 (blargg's suites) headless,\n"
+            "one per core, and prints PASS, FAIL, TIMEOUT or SKIP for each with\n"
+            "the emulated and wall time it took. Directories are searched for\n"
+            ".nes files. FAIL prints the ROM's message, --verbose every ROM's.\n"
+            "Gives up on a ROM after %d emulated seconds unless --timeout, and\n"
+            "exits with 1 unless every ROM passed.\n",
+            name, DEFAULT_TIMEOUT);
+}
+
+int32_t main(int32_t argc, char **argv) {
+    static RomRun runs[MAX_ROMS];
+    static const char *paths[MAX_ROMS];
+    uint32_t pathNum = 0;
+    uint32_t dropped = 0;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    double timeout = DEFAULT_TIMEOUT;
+    uint8_t verbose = 0;
+    Runner runner;
+
+    for (int32_t i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            timeout = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = 1;
+        } else if (argv[i][0] != '-' && pathNum < MAX_ROMS) {
+            paths[pathNum++] = argv[i];
+        } else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (!pathNum || jobs < 1 || timeout <= 0) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    runner.runs = runs;
+    runner.num = 0;
+    runner.timeoutFrames = timeout * NTSC_FRAME_RATE;
+    atomic_init(&runner.next, 0);
+
+    for (uint32_t i = 0; i < pathNum; ++i)
+        Collect(paths[i], runs, &runner.num, &dropped);
+
+    if (!runner.num) {
+        fprintf(stderr, "No ROMs found\n");
+        return 2;
+    }
+
+    if (dropped)
+        fprintf(stderr, "Only running %d ROMs, %u more were found\n", MAX_ROMS, dropped);
+
+    qsort(runs, runner.num, sizeof(RomRun), ComparePaths);
+
+    if ((unsigned long)jobs > runner.num)
+        jobs = runner.num;
+
+    pthread_t threads[jobs];
+    double start = Now();
+    long started;
+
+    for (started = 1; started < jobs; ++started) {
+        if (pthread_create(&threads[started], NULL, Worker, &runner) != 0)
+            break;
+    }
+
+    Worker(&runner);
+    for (long i = 1; i < started; ++i)
+        pthread_join(threads[i], NULL);
+
+    double wall = Now() - start;
+    uint32_t counts[ROM_UNLOADABLE + 1] = {0};
+    double emulated = 0;
+
+    for (uint32_t i = 0; i < runner.num; ++i) {
+        const RomRun *run = &runs[i];
+        double seconds = run->frames / NTSC_FRAME_RATE;
+
+        ++counts[run->result];
+        emulated += seconds;
+
+        printf("%-7s %s", gResultNames[run->result], run->path);
+        if (run->jammed)
+            printf(" (jammed on opcode %02x at $%04x)", run->jamOpcode, run->jamPc);
+        else if (run->result == ROM_FAIL && run->sawSignature)
+            printf(" (code %u)", run->status);
+        else if (run->result == ROM_TIMEOUT && !run->sawSignature)
+            printf(" (no $6000 signature)");
+
+        if (run->result != ROM_UNLOADABLE)
+            printf("  %.1f s emulated, %.3f s wall, %.0fx\n", seconds, run->wallSeconds,
+                   run->wallSeconds > 0 ? seconds / run->wallSeconds : 0.0);
+        else
+            printf("\n");
+
+        if (verbose || run->result == ROM_FAIL)
+            PrintText(run->text);
+    }
+
+    printf("%u passed, %u failed, %u timed out, %u skipped; %.1f s emulated in %.2f s wall "
+           "on %ld thread%s\n", counts[ROM_PASS], counts[ROM_FAIL], counts[ROM_TIMEOUT],
+           counts[ROM_UNLOADABLE], emulated, wall, started, started == 1 ? "" : "s");
+
+    return counts[ROM_PASS] == runner.num ? 0 : 1;
+}
@@ -1,15 +1,211 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "cartridge.h"
 
 #define NROM_128_MASK 0x3FFF
 #define NROM_256_MASK 0x7FFF
 
+#define KIB_16 16 * 1024
+#define KIB_8  8  * 1024
+
+#define INES_HEADER_SIZE  16
+#define INES_TRAINER_SIZE 512
+
+#define PRG_RAM_ADDR_BEG 0x6000
+#define PRG_ROM_ADDR_BEG 0x8000
+
+#define FLAGS6_VERTICAL_BIT    0x01
+#define FLAGS6_BATTERY_BIT     0x02
+#define FLAGS6_TRAINER_BIT     0x04
+#define FLAGS6_FOUR_SCREEN_BIT 0x08
+
 Mapper mappers[] = {
-    {Mapper0CpuWrite, Mapper0CpuRead, Mapper0PpuWrite, Mapper0PpuRead}
+    {Mapper0CpuRead, Mapper0PpuWrite, Mapper0PpuRead}
 };
 
+/* Parses an iNES image. Only mapper 0 exists, so the mapper number is
+ * checked but not used to pick one. */
+Cartridge *CartridgeLoadINes(const uint8_t *data, size_t size) {
+    if (size < INES_HEADER_SIZE || memcmp(data, "NES\x1A", 4) != 0) {
+        fprintf(stderr, "Not an iNES image\n");
+        return NULL;
+    }
+
+    uint8_t flags6 = data[6];
+    uint8_t mapper = (data[7] & 0xF0) | (flags6 >> 4);
+    if (mapper != 0) {
+        fprintf(stderr, "Unsupported mapper %u\n", mapper);
+        return NULL;
+    }
+
+    uint8_t prgBanks = data[4];
+    uint8_t chrBanks = data[5];
+    size_t offset = INES_HEADER_SIZE + (flags6 & FLAGS6_TRAINER_BIT ? INES_TRAINER_SIZE : 0);
+    size_t prgSize = (size_t)prgBanks * KIB_16;
+    size_t chrSize = (size_t)chrBanks * KIB_8;
+
+    if (prgBanks == 0 || prgBanks > 2 || chrBanks > 1 || offset + prgSize + chrSize > size) {
+        fprintf(stderr, "Bad NROM image: %u PRG and %u CHR banks in %zu bytes\n",
+                prgBanks, chrBanks, size);
+        return NULL;
+    }
+
+    Cartridge *cart = malloc(sizeof(Cartridge));
+    if (!cart) {
+        fprintf(stderr, "Not enough memory for the cartridge\n");
+        return NULL;
+    }
+
+    cart->mapper = &mappers[0];
+    cart->prgBanks = prgBanks; /* In 16KiB */
+    cart->chrBanks = chrBanks; /* In 8KiB, 0 means 8KiB of CHR RAM */
+    cart->prg = malloc(prgSize);
+    cart->chr = calloc(1, KIB_8);
+    cart->vram = NULL;
+    /* iNES 1 has no PRG-RAM size worth trusting, boards that have any
+     * have 8KiB, and it costs nothing on boards that don't. */
+    cart->prgRam = calloc(1, PRG_RAM_SIZE);
+    cart->battery = !!(flags6 & FLAGS6_BATTERY_BIT);
+    cart->saveMapped = 0;
+
+    if (flags6 & FLAGS6_FOUR_SCREEN_BIT) {
+        cart->mirroring = MIRROR_FOUR_SCREEN;
+        cart->vram = calloc(1, 2 * NAMETABLE_SIZE);
+    } else {
+        cart->mirroring = flags6 & FLAGS6_VERTICAL_BIT ? MIRROR_VERTICAL : MIRROR_HORIZONTAL;
+    }
+
+    if (!cart->prg || !cart->chr || !cart->prgRam ||
+        (cart->mirroring == MIRROR_FOUR_SCREEN && !cart->vram)) {
+        fprintf(stderr, "Not enough memory for the cartridge\n");
+        CartridgeDestroy(cart);
+        free(cart);
+        return NULL;
+    }
+
+    memcpy(cart->prg, data + offset, prgSize);
+    memcpy(cart->chr, data + offset + prgSize, chrSize);
+
+    return cart;
+}
+
+Cartridge *CartridgeLoadFile(const char *path) {
+    FILE *rom = fopen(path, "rb");
+    if (!rom) {
+        fprintf(stderr, "Couldn't open ROM %s\n", path);
+        return NULL;
+    }
+
+    fseek(rom, 0, SEEK_END);
+    long size = ftell(rom);
+    fseek(rom, 0, SEEK_SET);
+
+    uint8_t *data = malloc(size > 0 ? size : 1);
+    if (!data) {
+        fprintf(stderr, "Not enough memory for ROM %s\n", path);
+        fclose(rom);
+        return NULL;
+    }
+
+    size_t read = fread(data, 1, size > 0 ? size : 0, rom);
+    fclose(rom);
+
+    Cartridge *cart = CartridgeLoadINes(data, read);
+    free(data);
+
+    return cart;
+}
+
+Cartridge *CartridgeClone(const Cartridge *cart) {
+    Cartridge *clone = malloc(sizeof(Cartridge));
+    size_t prgSize = (size_t)cart->prgBanks * KIB_16;
+
+    if (!clone)
+        return NULL;
+
+    *clone = *cart;
+    clone->prg = malloc(prgSize);
+    clone->chr = malloc(KIB_8);
+    clone->vram = cart->vram ? malloc(2 * NAMETABLE_SIZE) : NULL;
+    clone->prgRam = malloc(PRG_RAM_SIZE);
+    clone->saveMapped = 0;
+
+    if (!clone->prg || !clone->chr || (cart->vram && !clone->vram) || !clone->prgRam) {
+        CartridgeDestroy(clone);
+        free(clone);
+        return NULL;
+    }
+
+    memcpy(clone->prg, cart->prg, prgSize);
+    memcpy(clone->chr, cart->chr, KIB_8);
+    memcpy(clone->prgRam, cart->prgRam, PRG_RAM_SIZE);
+    if (cart->vram)
+        memcpy(clone->vram, cart->vram, 2 * NAMETABLE_SIZE);
+
+    return clone;
+}
+
+uint8_t CartridgeMapSave(Cartridge *cart, const char *path) {
+    struct stat st;
+    int32_t fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0) {
+        fprintf(stderr, "Couldn't open save file %s\n", path);
+        return 0;
+    }
+
+    /* A new file reads back as zeros, like fresh PRG-RAM. */
+    if (fstat(fd, &st) != 0 || (st.st_size < PRG_RAM_SIZE && ftruncate(fd, PRG_RAM_SIZE) != 0)) {
+        fprintf(stderr, "Couldn't size save file %s\n", path);
+        close(fd);
+        return 0;
+    }
+
+    uint8_t *ram = mmap(NULL, PRG_RAM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (ram == MAP_FAILED) {
+        fprintf(stderr, "Couldn't map save file %s\n", path);
+        return 0;
+    }
+
+    if (cart->saveMapped)
+        munmap(cart->prgRam, PRG_RAM_SIZE);
+    else
+        free(cart->prgRam);
+
+    cart->prgRam = ram;
+    cart->saveMapped = 1;
+    return 1;
+}
+
+/* PRG-RAM, CHR and VRAM can be written; PRG ROM can't. */
+size_t CartridgeStateSize(const Cartridge *cart) {
+    return PRG_RAM_SIZE + KIB_8 + (cart->vram ? 2 * NAMETABLE_SIZE : 0);
+}
+
+void CartridgeSaveState(const Cartridge *cart, uint8_t *state) {
+    memcpy(state, cart->prgRam, PRG_RAM_SIZE);
+    memcpy(state + PRG_RAM_SIZE, cart->chr, KIB_8);
+
+    if (cart->vram)
+        memcpy(state + PRG_RAM_SIZE + KIB_8, cart->vram, 2 * NAMETABLE_SIZE);
+}
+
+void CartridgeLoadState(Cartridge *cart, const uint8_t *state) {
+    memcpy(cart->prgRam, state, PRG_RAM_SIZE);
+    memcpy(cart->chr, state + PRG_RAM_SIZE, KIB_8);
+
+    if (cart->vram)
+        memcpy(cart->vram, state + PRG_RAM_SIZE + KIB_8, 2 * NAMETABLE_SIZE);
+}
+
 void CartridgeDestroy(Cartridge *cart) {
     cart->mapper = NULL;
 
@@ -19,18 +215,34 @@ void CartridgeDestroy(Cartridge *cart) {
     free(cart->chr);
     cart->chr = NULL;
 
+    free(cart->vram);
+    cart->vram = NULL;
+
+    /* Unmapping leaves the dirty pages for the kernel to write back. */
+    if (cart->saveMapped)
+        munmap(cart->prgRam, PRG_RAM_SIZE);
+    else
+        free(cart->prgRam);
+    cart->prgRam = NULL;
+    cart->saveMapped = 0;
+
     cart->prgBanks = 0;
     cart->chrBanks = 0;
 }
 
+/* $4020-$5FFF is unused on NROM, and writes to ROM go nowhere. */
 void WriteCpuByteCartridge(Cartridge *cart, uint16_t addr, uint8_t byte) {
-    uint32_t decoded = cart->mapper->mapCpuWrite(cart, addr);
-    cart->prg[decoded] = byte;
+    if (addr >= PRG_RAM_ADDR_BEG && addr < PRG_ROM_ADDR_BEG)
+        cart->prgRam[addr & (PRG_RAM_SIZE - 1)] = byte;
 }
 
 uint8_t ReadCpuByteCartridge(Cartridge *cart, uint16_t addr) {
-    uint32_t decoded = cart->mapper->mapCpuRead(cart, addr);
-    return cart->prg[decoded];
+    if (addr >= PRG_ROM_ADDR_BEG)
+        return cart->prg[cart->mapper->mapCpuRead(cart, addr)];
+    else if (addr >= PRG_RAM_ADDR_BEG)
+        return cart->prgRam[addr & (PRG_RAM_SIZE - 1)];
+
+    return 0;
 }
 
 void WritePpuByteCartridge(Cartridge *cart, uint16_t addr, uint8_t byte) {
@@ -43,19 +255,17 @@ uint8_t ReadPpuByteCartridge(Cartridge *cart, uint16_t addr) {
     return cart->chr[decoded];
 }
 
-uint32_t Mapper0CpuWrite(Cartridge *cart, uint16_t addr) {
-    return addr & (cart->prgBanks == 1 ? NROM_128_MASK : NROM_256_MASK);
-}
-
 uint32_t Mapper0CpuRead(Cartridge *cart, uint16_t addr) {
     return addr & (cart->prgBanks == 1 ? NROM_128_MASK : NROM_256_MASK);
 }
 
 // Possible FIXME in these two functions.
 uint32_t Mapper0PpuWrite(Cartridge *cart, uint16_t addr) {
+    (void)cart;
     return addr;
 }
 
 uint32_t Mapper0PpuRead(Cartridge *cart, uint16_t addr) {
+    (void)cart;
     return addr;
 }
@@ -2,9 +2,15 @@
 #define CARTRIDGE_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include "memory.h"
 
+/* Work RAM at $6000-$7FFF. */
+#define PRG_RAM_SIZE (8 * 1024)
+/* NROM's one bank of CHR, ROM or RAM. */
+#define CHR_SIZE     (8 * 1024)
+
 typedef struct _Mapper Mapper;
 
 typedef struct _Cartridge {
@@ -13,10 +19,22 @@ typedef struct _Cartridge {
     uint8_t *prg;
     uint8_t *chr;
     Mapper *mapper;
+
+    MIRRORING mirroring;
+    /* Extra 2KiB for four-screen boards, NULL otherwise. */
+    uint8_t *vram;
+
+    /* Battery boards keep prgRam across power cycles. With a save file
+     * it's a shared mapping of the file rather than a heap buffer, so
+     * every write lands in the page cache and the kernel writes it back. */
+    uint8_t *prgRam;
+    uint8_t battery;
+    uint8_t saveMapped;
 } Cartridge;
 
+/* NROM's PRG is ROM, so there's no CPU write mapping until a mapper with
+ * registers needs one. */
 typedef struct _Mapper {
-    uint32_t (*mapCpuWrite)(Cartridge*, uint16_t);
     uint32_t (*mapCpuRead)(Cartridge*, uint16_t);
     uint32_t (*mapPpuWrite)(Cartridge*, uint16_t);
     uint32_t (*mapPpuRead)(Cartridge*, uint16_t);
@@ -27,9 +45,26 @@ uint8_t ReadCpuByteCartridge(Cartridge *cart, uint16_t addr);
 void WritePpuByteCartridge(Cartridge *cart, uint16_t addr, uint8_t byte);
 uint8_t ReadPpuByteCartridge(Cartridge *cart, uint16_t addr);
 
+Cartridge *CartridgeLoadINes(const uint8_t *data, size_t size);
+Cartridge *CartridgeLoadFile(const char *path);
+
+/* Clones get their own PRG-RAM, never the save file. Returns NULL when out
+ * of memory. */
+Cartridge *CartridgeClone(const Cartridge *cart);
+
+/* Backs PRG-RAM with path, created or grown to PRG_RAM_SIZE as needed.
+ * Whatever was in PRG-RAM is replaced by the file's contents, so this
+ * belongs before the first frame. Memory's pages have to be remapped
+ * after. */
+uint8_t CartridgeMapSave(Cartridge *cart, const char *path);
+
+/* The cartridge's writable memory, for save states. PRG-RAM is part of
+ * it, so loading a state also rewrites the save file. */
+size_t CartridgeStateSize(const Cartridge *cart);
+void CartridgeSaveState(const Cartridge *cart, uint8_t *state);
+void CartridgeLoadState(Cartridge *cart, const uint8_t *state);
 void CartridgeDestroy(Cartridge *cart);
 
-uint32_t Mapper0CpuWrite(Cartridge *, uint16_t);
 uint32_t Mapper0CpuRead(Cartridge *, uint16_t);
 uint32_t Mapper0PpuWrite(Cartridge *, uint16_t);
 uint32_t Mapper0PpuRead(Cartridge *, uint16_t);
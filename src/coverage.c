@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "coverage.h"
+#include "cartridge.h"
+
+#define PRG_BANK_SIZE 16384
+#define CHR_BANK_SIZE 8192
+#define PRG_ROM_ADDR_BEG 0x8000
+#define IMAGE_WIDTH 256
+
+Coverage *CoverageCreate(Cartridge *cart) {
+    /* Zeroed, so a failed map leaves CoverageDestroy only NULLs to free. */
+    Coverage *cov = calloc(1, sizeof(Coverage));
+
+    if (!cov)
+        return NULL;
+
+    cov->cart = cart;
+    cov->prgSize = (uint32_t)cart->prgBanks * PRG_BANK_SIZE;
+    cov->pc = 0;
+    cov->length = 1;
+
+    for (uint8_t kind = 0; kind < COVERAGE_KINDS; ++kind) {
+        cov->maps[kind] = calloc((cov->prgSize + 7) / 8, 1);
+
+        if (!cov->maps[kind]) {
+            CoverageDestroy(cov);
+            return NULL;
+        }
+    }
+
+    return cov;
+}
+
+void CoverageDestroy(Coverage *cov) {
+    for (uint8_t kind = 0; kind < COVERAGE_KINDS; ++kind)
+        free(cov->maps[kind]);
+
+    free(cov);
+}
+
+static void Mark(Coverage *cov, uint8_t kind, uint16_t addr) {
+    if (addr < PRG_ROM_ADDR_BEG)
+        return;
+
+    uint32_t offset = cov->cart->mapper->mapCpuRead(cov->cart, addr);
+    cov->maps[kind][offset >> 3] |= 1 << (offset & 7);
+}
+
+void CoverageFetch(Coverage *cov, uint16_t pc) {
+    cov->pc = pc;
+    cov->length = 1;
+}
+
+void CoverageSetLength(Coverage *cov, uint8_t length) {
+    cov->length = length;
+}
+
+/* Opcode at distance 0, operand below length, data past it. */
+void CoverageRead(Coverage *cov, uint16_t addr) {
+    uint16_t distance = addr - cov->pc;
+
+    Mark(cov, (distance != 0) + (distance >= cov->length), addr);
+}
+
+void CoverageWrite(Coverage *cov, uint16_t addr) {
+    Mark(cov, COVER_WRITE, addr);
+}
+
+uint8_t CoverageTest(const Coverage *cov, COVERAGE_KIND kind, uint32_t offset) {
+    return (cov->maps[kind][offset >> 3] >> (offset & 7)) & 1;
+}
+
+uint8_t CoverageSaveCdl(const Coverage *cov, const char *path) {
+    FILE *file = fopen(path, "wb");
+
+    if (!file) {
+        fprintf(stderr, "Couldn't create code/data log %s\n", path);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < cov->prgSize; ++i) {
+        uint8_t code = CoverageTest(cov, COVER_OPCODE, i) | CoverageTest(cov, COVER_OPERAND, i);
+        fputc(code | CoverageTest(cov, COVER_READ, i) << 1, file);
+    }
+
+    for (uint32_t i = 0; i < (uint32_t)cov->cart->chrBanks * CHR_BANK_SIZE; ++i)
+        fputc(0, file);
+
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Couldn't write code/data log %s\n", path);
+        return 0;
+    }
+
+    return 1;
+}
+
+uint8_t CoverageSaveImage(const Coverage *cov, const char *path) {
+    FILE *file = fopen(path, "wb");
+
+    if (!file) {
+        fprintf(stderr, "Couldn't create coverage image %s\n", path);
+        return 0;
+    }
+
+    fprintf(file, "P6\n%d %u\n255\n", IMAGE_WIDTH, (cov->prgSize + IMAGE_WIDTH - 1) / IMAGE_WIDTH);
+
+    for (uint32_t i = 0; i < cov->prgSize; ++i) {
+        uint8_t rgb[3] = {
+            CoverageTest(cov, COVER_WRITE, i) * 0xFF,
+            CoverageTest(cov, COVER_OPCODE, i) ? 0xFF : CoverageTest(cov, COVER_OPERAND, i) * 0x80,
+            CoverageTest(cov, COVER_READ, i) * 0xFF
+        };
+
+        fwrite(rgb, 1, sizeof(rgb), file);
+    }
+
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Couldn't write coverage image %s\n", path);
+        return 0;
+    }
+
+    return 1;
+}
@@ -0,0 +1,51 @@
+#ifndef COVERAGE_H_
+#define COVERAGE_H_
+
+#include <stdint.h>
+
+typedef struct _Cartridge Cartridge;
+
+typedef enum _COVERAGE_KIND {
+    COVER_OPCODE,  /* Fetched as the first byte of an instruction */
+    COVER_OPERAND, /* Fetched as one of its operand bytes */
+    COVER_READ,    /* Read as data */
+    COVER_WRITE,   /* Written, i.e. a mapper register */
+    COVERAGE_KINDS
+} COVERAGE_KIND;
+
+/* Which PRG ROM bytes ran and which were accessed as data, one bitmap per
+ * kind with a bit per byte of PRG, so the offset already tells the banks
+ * apart. While a Coverage is attached, MemoryMapPages leaves PRG off the
+ * direct page maps and the slow path reports each access here; detached,
+ * the fast path is exactly what it was. */
+typedef struct _Coverage {
+    Cartridge *cart;
+    uint32_t prgSize;
+    uint8_t *maps[COVERAGE_KINDS];
+
+    /* The instruction being fetched. Reads of its own bytes are operand
+     * fetches, anything else is data. */
+    uint16_t pc;
+    uint8_t length;
+} Coverage;
+
+/* Returns NULL when out of memory. */
+Coverage *CoverageCreate(Cartridge *cart);
+void CoverageDestroy(Coverage *cov);
+
+/* Starts an instruction at pc, CoverageSetLength once the opcode is known. */
+void CoverageFetch(Coverage *cov, uint16_t pc);
+void CoverageSetLength(Coverage *cov, uint8_t length);
+void CoverageRead(Coverage *cov, uint16_t addr);
+void CoverageWrite(Coverage *cov, uint16_t addr);
+
+uint8_t CoverageTest(const Coverage *cov, COVERAGE_KIND kind, uint32_t offset);
+
+/* FCEUX/Mesen code/data log: a byte per PRG byte with bit 0 for code and
+ * bit 1 for data, then a byte per CHR byte, left 0 as CHR isn't tracked. */
+uint8_t CoverageSaveCdl(const Coverage *cov, const char *path);
+/* Binary PPM with a pixel per PRG byte and a row per 256 bytes: green for
+ * opcodes, dark green for operands, blue for reads and red for writes. */
+uint8_t CoverageSaveImage(const Coverage *cov, const char *path);
+
+#endif
@@ -1,9 +1,10 @@
-#include <stdio.h>
 #include <stdlib.h>
-#include <assert.h>
 
 #include "cpu.h"
 #include "memory.h"
+#include "debugger.h"
+#include "coverage.h"
+#include "trace.h"
 
 #define RESET_INTERRUPT_VECTOR 0xFFFC
 #define NMI_INTERRUPT_VECTOR   0xFFFA
@@ -11,6 +12,8 @@
 #define STACK_START            0x100
 #define DEFAULT_STATUS_FLAG    0x20
 #define CYCLES_AFTER_INTERRUPT 7
+#define CPU_TRAP               0x100
+#define CACHE_LINE_SIZE        64
 
 #define INSTR(x) static void x(Cpu *cpu, uint16_t addr)
 
@@ -83,6 +86,8 @@ INSTR(Inc);
 INSTR(Inx);
 INSTR(Beq);
 INSTR(Sed);
+INSTR(Nop);
+INSTR(Illegal);
 
 static void IncDecImpl(Cpu *cpu, uint16_t addr, uint8_t change);
 static void CmpImpl(Cpu *cpu, uint16_t addr, uint8_t reg);
@@ -90,461 +95,453 @@ static void AdcImpl(Cpu *cpu, uint16_t addr, uint8_t ones_complement);
 static void Branch(Cpu *cpu, uint16_t addr, STATUS status,
            uint8_t value_needed);
 
-typedef struct _Instruction {
-    const char *mnemonic;
-    uint8_t opcode;
-    uint8_t cycles;
-    ADDRESSING_MODE adrMode;
-    void (*execute)(Cpu* cpu, uint16_t addr);
-} Instruction;
-
-typedef union _InstructionOrNothing {
-    const void *valid;
-    Instruction instr;
-} InstructionOrNothing;
-
-typedef union _AddrDecodeInfo {
-    struct {
-        uint16_t addr;
-    } absolute;
-
-    struct {
-        uint16_t AbsoluteAddr;
-        uint16_t addr;
-        uint8_t index;
-    } absoluteIndexed;
-
-    struct {
-        uint16_t addr;
-    } immediate;
-
-    struct {
-        uint8_t addr;
-    } zeropage;
-
-    struct {
-        uint8_t zpAddr;
-        uint8_t index;
-        uint16_t addr;
-    } zeropageIndexed;
-
-    struct {
-        uint16_t addr;
-    } relative;
-
-    struct {
-        uint16_t addr;
-        uint16_t iaddr;
-    } indirect;
-
-    struct {
-        uint16_t addr;
-        uint8_t zpAddr;
-        uint8_t zpXAddr;
-    } indexedIndirect;
-
-    struct {
-        uint16_t addr;
-        uint8_t zpAddr;
-        uint8_t y;
-    } indirectIndexed;
-} AddrDecodeInfo;
-
-static const InstructionOrNothing gInstructionTable[] = {
-    {.instr = {"BRK", 0x00, 7, IMPLICIT, Brk}},
-    {.instr = {"ORA", 0x01, 6, INDEXED_INDIRECT, Ora}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"ORA", 0x05, 3, INDEXED_INDIRECT, Ora}},
-    {.instr = {"ASL", 0x06, 5, ZEROPAGE, Asl}},
-    {NULL},
-    {.instr = {"PHP", 0x08, 3, IMPLICIT, Php}},
-    {.instr = {"ORA", 0x09, 2, IMMEDIATE, Ora}},
-    {.instr = {"ASL", 0x0A, 2, ACCUMULATOR, AslA}},
-    {NULL},
-    {NULL},
-    {.instr = {"ORA", 0x0D, 4, ABSOLUTE, Ora}},
-    {.instr = {"ASL", 0x0E, 6, ABSOLUTE, Asl}},
-    {NULL},
-    {.instr = {"BPL", 0x10, 2, RELATIVE, Bpl}},
-    {.instr = {"ORA", 0x11, 5, INDIRECT_INDEXED, Ora}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"ORA", 0x15, 4, ZEROPAGE_X, Ora}},
-    {.instr = {"ASL", 0x16, 6, ZEROPAGE_X, Asl}},
-    {NULL},
-    {.instr = {"CLC", 0x18, 2, IMPLICIT, Clc}},
-    {.instr = {"ORA", 0x19, 4, ABSOLUTE_Y, Ora}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"ORA", 0x1D, 4, ABSOLUTE_X, Ora}},
-    {.instr = {"ASL", 0x1E, 7, ABSOLUTE_X, Asl}},
-    {NULL},
-    {.instr = {"JSR", 0x20, 6, ABSOLUTE, Jsr}},
-    {.instr = {"AND", 0x21, 6, INDEXED_INDIRECT, And}},
-    {NULL},
-    {NULL},
-    {.instr = {"BIT", 0x24, 3, ZEROPAGE, Bit}},
-    {.instr = {"AND", 0x25, 3, ZEROPAGE, And}},
-    {.instr = {"ROL", 0x26, 5, ZEROPAGE, Rol}},
-    {NULL},
-    {.instr = {"PLP", 0x28, 4, IMPLICIT, Plp}},
-    {.instr = {"AND", 0x29, 2, IMMEDIATE, And}},
-    {.instr = {"ROL", 0x2A, 2, ACCUMULATOR, RolA}},
-    {NULL},
-    {.instr = {"BIT", 0x2C, 4, ABSOLUTE, Bit}},
-    {.instr = {"AND", 0x2D, 4, ABSOLUTE, And}},
-    {.instr = {"AND", 0x2E, 6, ABSOLUTE, Rol}},
-    {NULL},
-    {.instr = {"BMI", 0x30, 2, RELATIVE, Bmi}},
-    {.instr = {"AND", 0x31, 5, INDIRECT_INDEXED, And}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"AND", 0x35, 4, ZEROPAGE_X, And}},
-    {.instr = {"ROL", 0x36, 6, ZEROPAGE_X, Rol}},
-    {NULL},
-    {.instr = {"SEC", 0x38, 2, IMPLICIT, Sec}},
-    {.instr = {"AND", 0x39, 4, ABSOLUTE_Y, And}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"AND", 0x3D, 4, ABSOLUTE_X, And}},
-    {.instr = {"ROL", 0x3E, 7, ABSOLUTE_X, Rol}},
-    {NULL},
-    {.instr = {"RTI", 0x40, 6, IMPLICIT, Rti}},
-    {.instr = {"EOR", 0x41, 6, INDEXED_INDIRECT, Eor}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"EOR", 0x45, 3, ZEROPAGE, Eor}},
-    {.instr = {"LSR", 0x46, 5, ZEROPAGE, Lsr}},
-    {NULL},
-    {.instr = {"PHA", 0x48, 3, IMPLICIT, Pha}},
-    {.instr = {"EOR", 0x49, 2, IMMEDIATE, Eor}},
-    {.instr = {"LSR", 0x4A, 2, ACCUMULATOR, LsrA}},
-    {NULL},
-    {.instr = {"JMP", 0x4C, 3, ABSOLUTE, Jmp}},
-    {.instr = {"EOR", 0x4D, 4, ABSOLUTE, Eor}},
-    {.instr = {"LSR", 0x4E, 6, ABSOLUTE, Eor}},
-    {NULL},
-    {.instr = {"BVC", 0x50, 2, RELATIVE, Bvc}},
-    {.instr = {"EOR", 0x51, 5, INDIRECT_INDEXED, Eor}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"EOR", 0x55, 4, ZEROPAGE_X, Eor}},
-    {.instr = {"LSR", 0x56, 6, ZEROPAGE_X, Lsr}},
-    {NULL},
-    {.instr = {"CLI", 0x58, 6, IMPLICIT, Cli}},
-    {.instr = {"EOR", 0x59, 4, ABSOLUTE_Y, Eor}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"EOR", 0x5D, 4, ABSOLUTE_X, Eor}},
-    {.instr = {"LSR", 0x5E, 7, ABSOLUTE_X, Lsr}},
-    {NULL},
-    {.instr = {"RTS", 0x60, 6, IMPLICIT, Rts}},
-    {.instr = {"ADC", 0x61, 6, INDEXED_INDIRECT, Adc}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"ADC", 0x65, 3, ZEROPAGE, Adc}},
-    {.instr = {"ROR", 0x66, 5, ZEROPAGE, Ror}},
-    {NULL},
-    {.instr = {"PLA", 0x68, 4, IMPLICIT, Pla}},
-    {.instr = {"ADC", 0x69, 2, IMMEDIATE, Adc}},
-    {.instr = {"ROR", 0x6A, 2, ACCUMULATOR, RorA}},
-    {NULL},
-    {.instr = {"JMP", 0x6C, 5, INDIRECT, Jmp}},
-    {.instr = {"ADC", 0x6D, 4, ABSOLUTE, Adc}},
-    {.instr = {"ROR", 0x6E, 6, ABSOLUTE, Ror}},
-    {NULL},
-    {.instr = {"BVS", 0x70, 2, RELATIVE, Bvs}},
-    {.instr = {"ADC", 0x71, 5, INDIRECT_INDEXED, Adc}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"ADC", 0x75, 4, ZEROPAGE_X, Adc}},
-    {.instr = {"ROR", 0x76, 6, ZEROPAGE_X, Ror}},
-    {NULL},
-    {.instr = {"SEI", 0x78, 2, IMPLICIT, Sei}},
-    {.instr = {"ADC", 0x79, 3, ABSOLUTE_Y, Adc}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"ADC", 0x7D, 3, ABSOLUTE_X, Adc}},
-    {.instr = {"ROR", 0x7E, 7, ABSOLUTE_X, Ror}},
-    {NULL},
-    {NULL},
-    {.instr = {"STA", 0x81, 6, INDEXED_INDIRECT, Sta}},
-    {NULL},
-    {NULL},
-    {.instr = {"STY", 0x84, 3, ZEROPAGE, Sty}},
-    {.instr = {"STA", 0x85, 3, ZEROPAGE, Sta}},
-    {.instr = {"STX", 0x86, 3, ZEROPAGE, Stx}},
-    {NULL},
-    {.instr = {"DEY", 0x88, 2, IMPLICIT, Dey}},
-    {NULL},
-    {.instr = {"TXA", 0x8A, 2, IMPLICIT, Txa}},
-    {NULL},
-    {.instr = {"STY", 0x8C, 4, ABSOLUTE, Sty}},
-    {.instr = {"STA", 0x8D, 4, ABSOLUTE, Sta}},
-    {.instr = {"STX", 0x8E, 4, ABSOLUTE, Stx}},
-    {NULL},
-    {.instr = {"BCC", 0x90, 2, RELATIVE, Bcc}},
-    {.instr = {"STA", 0x91, 6, INDIRECT_INDEXED, Sta}},
-    {NULL},
-    {NULL},
-    {.instr = {"STY", 0x94, 4, ZEROPAGE_X, Sty}},
-    {.instr = {"STA", 0x95, 4, ZEROPAGE_X, Sta}},
-    {.instr = {"STX", 0x96, 4, ZEROPAGE_Y, Stx}},
-    {NULL},
-    {.instr = {"TYA", 0x98, 2, IMPLICIT, Tya}},
-    {.instr = {"STA", 0x99, 5, ABSOLUTE_Y, Sta}},
-    {.instr = {"TXS", 0x9A, 2, IMPLICIT, Txs}},
-    {NULL},
-    {NULL},
-    {.instr = {"STA", 0x9D, 5, ABSOLUTE_X, Sta}},
-    {NULL},
-    {NULL},
-    {.instr = {"LDY", 0xA0, 2, IMMEDIATE, Ldy}},
-    {.instr = {"LDA", 0xA1, 6, INDEXED_INDIRECT, Lda}},
-    {.instr = {"LDX", 0xA2, 2, IMMEDIATE, Ldx}},
-    {NULL},
-    {.instr = {"LDY", 0xA4, 2, ZEROPAGE, Ldy}},
-    {.instr = {"LDA", 0xA5, 3, ZEROPAGE, Lda}},
-    {.instr = {"LDA", 0xA6, 3, ZEROPAGE, Ldx}},
-    {NULL},
-    {.instr = {"TAY", 0xA8, 2, IMPLICIT, Tay}},
-    {.instr = {"LDA", 0xA9, 2, IMMEDIATE, Lda}},
-    {.instr = {"TAX", 0xAA, 2, IMPLICIT, Tax}},
-    {NULL},
-    {.instr = {"LDY", 0xAC, 4, ABSOLUTE, Ldy}},
-    {.instr = {"LDA", 0xAD, 4, ABSOLUTE, Lda}},
-    {.instr = {"LDX", 0xAE, 4, ABSOLUTE, Ldx}},
-    {NULL},
-    {.instr = {"BCS", 0xB0, 2, RELATIVE, Bcs}},
-    {.instr = {"LDA", 0xB1, 5, INDIRECT_INDEXED, Lda}},
-    {NULL},
-    {NULL},
-    {.instr = {"LDY", 0xB4, 4, ZEROPAGE_X, Ldy}},
-    {.instr = {"LDA", 0xB5, 4, ZEROPAGE_X, Lda}},
-    {.instr = {"LDX", 0xB6, 4, ZEROPAGE_Y, Ldx}},
-    {NULL},
-    {.instr = {"CLV", 0xB8, 2, IMPLICIT, Clv}},
-    {.instr = {"LDA", 0xB9, 4, ABSOLUTE_Y, Lda}},
-    {.instr = {"TSA", 0xBA, 2, IMPLICIT, Tsx}},
-    {NULL},
-    {.instr = {"LDY", 0xBC, 4, ABSOLUTE_X, Ldy}},
-    {.instr = {"LDA", 0xBD, 4, ABSOLUTE_X, Lda}},
-    {.instr = {"LDX", 0xBE, 4, ABSOLUTE_Y, Ldx}},
-    {NULL},
-    {.instr = {"CPY", 0xC0, 2, IMMEDIATE, Cpy}},
-    {.instr = {"CMP", 0xC1, 6, INDEXED_INDIRECT, Cmp}},
-    {NULL},
-    {NULL},
-    {.instr = {"CPY", 0xC4, 3, ZEROPAGE, Cpy}},
-    {.instr = {"CMP", 0xC5, 3, ZEROPAGE, Cmp}},
-    {.instr = {"DEC", 0xC6, 5, ZEROPAGE, Dec}},
-    {NULL},
-    {.instr = {"INY", 0xC8, 2, IMPLICIT, Iny}},
-    {.instr = {"CMP", 0xC9, 2, IMMEDIATE, Cmp}},
-    {.instr = {"DEX", 0xCA, 2, IMPLICIT, Dex}},
-    {NULL},
-    {.instr = {"CPY", 0xCC, 4, ABSOLUTE, Cpy}},
-    {.instr = {"CMP", 0xCD, 4, ABSOLUTE, Cmp}},
-    {.instr = {"DEC", 0xCE, 6, ABSOLUTE, Dec}},
-    {NULL},
-    {.instr = {"BNE", 0xD0, 2, RELATIVE, Bne}},
-    {.instr = {"CMP", 0xD1, 5, INDIRECT_INDEXED, Cmp}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"CMP", 0xD5, 4, ZEROPAGE_X, Cmp}},
-    {.instr = {"DEC", 0xD6,	6, ZEROPAGE_X, Dec}},
-    {NULL},
-    {.instr = {"CLD", 0xD8,	2, IMPLICIT, Cld}},
-    {.instr = {"CMP", 0xD9, 4, ABSOLUTE_Y, Cmp}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"CMP", 0xDD, 4, ABSOLUTE_X, Cmp}},
-    {.instr = {"DEC", 0xDE,	7, ABSOLUTE_X, Dec}},
-    {NULL},
-    {.instr = {"CPX", 0xE0, 2, IMMEDIATE, Cpx}},
-    {.instr = {"SBC", 0xE1, 6, INDEXED_INDIRECT, Sbc}},
-    {NULL},
-    {NULL},
-    {.instr = {"CPX", 0xE4, 3, ZEROPAGE, Cpx}},
-    {.instr = {"SBC", 0xE5, 3, ZEROPAGE, Sbc}},
-    {.instr = {"INC", 0xE6, 5, ZEROPAGE, Inc}},
-    {NULL},
-    {.instr = {"INX", 0xE8, 2, IMPLICIT, Inx}},
-    {.instr = {"SBC", 0xE9, 2, IMMEDIATE, Sbc}},
-    {.instr = {"NOP", 0xEA, 2, IMPLICIT, NULL}}, /* NOP */
-    {NULL},
-    {.instr = {"CPX", 0xEC, 4, ABSOLUTE, Cpx}},
-    {.instr = {"SBC", 0xED, 4, ABSOLUTE, Sbc}},
-    {.instr = {"INC", 0xEE, 6, ABSOLUTE, Inc}},
-    {NULL},
-    {.instr = {"BEQ", 0xF0, 2, RELATIVE, Beq}},
-    {.instr = {"SBC", 0xF1, 5, INDIRECT_INDEXED, Sbc}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"SBC", 0xF5, 5, ZEROPAGE_X, Sbc}},
-    {.instr = {"INC", 0xF6, 6, ZEROPAGE_X, Inc}},
-    {NULL},
-    {.instr = {"SED", 0xF8, 2, IMPLICIT, Sed}},
-    {.instr = {"SBC", 0xF9, 4, ABSOLUTE_Y, Sbc}},
-    {NULL},
-    {NULL},
-    {NULL},
-    {.instr = {"SBC", 0xFD, 4, ABSOLUTE_X, Sbc}},
-    {.instr = {"INC", 0xFE, 7, ABSOLUTE_X, Inc}},
-    {NULL}
+typedef void (*InstructionFn)(Cpu *cpu, uint16_t addr);
+
+/* Hot dispatch tables, indexed by opcode. They only hold what CpuEmulate
+ * needs, so a fetch touches a few cache lines and never branches on a
+ * missing entry: unofficial opcodes trap through Illegal. */
+static _Alignas(CACHE_LINE_SIZE) const InstructionFn gInstrExecute[256] = {
+    /* 00 */ Brk, Ora, Illegal, Illegal, Illegal, Ora, Asl, Illegal,
+    /* 08 */ Php, Ora, AslA, Illegal, Illegal, Ora, Asl, Illegal,
+    /* 10 */ Bpl, Ora, Illegal, Illegal, Illegal, Ora, Asl, Illegal,
+    /* 18 */ Clc, Ora, Illegal, Illegal, Illegal, Ora, Asl, Illegal,
+    /* 20 */ Jsr, And, Illegal, Illegal, Bit, And, Rol, Illegal,
+    /* 28 */ Plp, And, RolA, Illegal, Bit, And, Rol, Illegal,
+    /* 30 */ Bmi, And, Illegal, Illegal, Illegal, And, Rol, Illegal,
+    /* 38 */ Sec, And, Illegal, Illegal, Illegal, And, Rol, Illegal,
+    /* 40 */ Rti, Eor, Illegal, Illegal, Illegal, Eor, Lsr, Illegal,
+    /* 48 */ Pha, Eor, LsrA, Illegal, Jmp, Eor, Lsr, Illegal,
+    /* 50 */ Bvc, Eor, Illegal, Illegal, Illegal, Eor, Lsr, Illegal,
+    /* 58 */ Cli, Eor, Illegal, Illegal, Illegal, Eor, Lsr, Illegal,
+    /* 60 */ Rts, Adc, Illegal, Illegal, Illegal, Adc, Ror, Illegal,
+    /* 68 */ Pla, Adc, RorA, Illegal, Jmp, Adc, Ror, Illegal,
+    /* 70 */ Bvs, Adc, Illegal, Illegal, Illegal, Adc, Ror, Illegal,
+    /* 78 */ Sei, Adc, Illegal, Illegal, Illegal, Adc, Ror, Illegal,
+    /* 80 */ Illegal, Sta, Illegal, Illegal, Sty, Sta, Stx, Illegal,
+    /* 88 */ Dey, Illegal, Txa, Illegal, Sty, Sta, Stx, Illegal,
+    /* 90 */ Bcc, Sta, Illegal, Illegal, Sty, Sta, Stx, Illegal,
+    /* 98 */ Tya, Sta, Txs, Illegal, Illegal, Sta, Illegal, Illegal,
+    /* A0 */ Ldy, Lda, Ldx, Illegal, Ldy, Lda, Ldx, Illegal,
+    /* A8 */ Tay, Lda, Tax, Illegal, Ldy, Lda, Ldx, Illegal,
+    /* B0 */ Bcs, Lda, Illegal, Illegal, Ldy, Lda, Ldx, Illegal,
+    /* B8 */ Clv, Lda, Tsx, Illegal, Ldy, Lda, Ldx, Illegal,
+    /* C0 */ Cpy, Cmp, Illegal, Illegal, Cpy, Cmp, Dec, Illegal,
+    /* C8 */ Iny, Cmp, Dex, Illegal, Cpy, Cmp, Dec, Illegal,
+    /* D0 */ Bne, Cmp, Illegal, Illegal, Illegal, Cmp, Dec, Illegal,
+    /* D8 */ Cld, Cmp, Illegal, Illegal, Illegal, Cmp, Dec, Illegal,
+    /* E0 */ Cpx, Sbc, Illegal, Illegal, Cpx, Sbc, Inc, Illegal,
+    /* E8 */ Inx, Sbc, Nop, Illegal, Cpx, Sbc, Inc, Illegal,
+    /* F0 */ Beq, Sbc, Illegal, Illegal, Illegal, Sbc, Inc, Illegal,
+    /* F8 */ Sed, Sbc, Illegal, Illegal, Illegal, Sbc, Inc, Illegal
 };
 
-static AddrDecodeInfo gAddrDecodedInfo;
+static _Alignas(CACHE_LINE_SIZE) const uint8_t gInstrAdrMode[256] = {
+    /* 00 */ IMPLICIT, INDEXED_INDIRECT, IMPLICIT, IMPLICIT, IMPLICIT, ZEROPAGE, ZEROPAGE, IMPLICIT,
+    /* 08 */ IMPLICIT, IMMEDIATE, ACCUMULATOR, IMPLICIT, IMPLICIT, ABSOLUTE, ABSOLUTE, IMPLICIT,
+    /* 10 */ RELATIVE, INDIRECT_INDEXED, IMPLICIT, IMPLICIT, IMPLICIT, ZEROPAGE_X, ZEROPAGE_X, IMPLICIT,
+    /* 18 */ IMPLICIT, ABSOLUTE_Y, IMPLICIT, IMPLICIT, IMPLICIT, ABSOLUTE_X, ABSOLUTE_X, IMPLICIT,
+    /* 20 */ ABSOLUTE, INDEXED_INDIRECT, IMPLICIT, IMPLICIT, ZEROPAGE, ZEROPAGE, ZEROPAGE, IMPLICIT,
+    /* 28 */ IMPLICIT, IMMEDIATE, ACCUMULATOR, IMPLICIT, ABSOLUTE, ABSOLUTE, ABSOLUTE, IMPLICIT,
+    /* 30 */ RELATIVE, INDIRECT_INDEXED, IMPLICIT, IMPLICIT, IMPLICIT, ZEROPAGE_X, ZEROPAGE_X, IMPLICIT,
+    /* 38 */ IMPLICIT, ABSOLUTE_Y, IMPLICIT, IMPLICIT, IMPLICIT, ABSOLUTE_X, ABSOLUTE_X, IMPLICIT,
+    /* 40 */ IMPLICIT, INDEXED_INDIRECT, IMPLICIT, IMPLICIT, IMPLICIT, ZEROPAGE, ZEROPAGE, IMPLICIT,
+    /* 48 */ IMPLICIT, IMMEDIATE, ACCUMULATOR, IMPLICIT, ABSOLUTE, ABSOLUTE, ABSOLUTE, IMPLICIT,
+    /* 50 */ RELATIVE, INDIRECT_INDEXED, IMPLICIT, IMPLICIT, IMPLICIT, ZEROPAGE_X, ZEROPAGE_X, IMPLICIT,
+    /* 58 */ IMPLICIT, ABSOLUTE_Y, IMPLICIT, IMPLICIT, IMPLICIT, ABSOLUTE_X, ABSOLUTE_X, IMPLICIT,
+    /* 60 */ IMPLICIT, INDEXED_INDIRECT, IMPLICIT, IMPLICIT, IMPLICIT, ZEROPAGE, ZEROPAGE, IMPLICIT,
+    /* 68 */ IMPLICIT, IMMEDIATE, ACCUMULATOR, IMPLICIT, INDIRECT, ABSOLUTE, ABSOLUTE, IMPLICIT,
+    /* 70 */ RELATIVE, INDIRECT_INDEXED, IMPLICIT, IMPLICIT, IMPLICIT, ZEROPAGE_X, ZEROPAGE_X, IMPLICIT,
+    /* 78 */ IMPLICIT, ABSOLUTE_Y, IMPLICIT, IMPLICIT, IMPLICIT, ABSOLUTE_X, ABSOLUTE_X, IMPLICIT,
+    /* 80 */ IMPLICIT, INDEXED_INDIRECT, IMPLICIT, IMPLICIT, ZEROPAGE, ZEROPAGE, ZEROPAGE, IMPLICIT,
+    /* 88 */ IMPLICIT, IMPLICIT, IMPLICIT, IMPLICIT, ABSOLUTE, ABSOLUTE, ABSOLUTE, IMPLICIT,
+    /* 90 */ RELATIVE, INDIRECT_INDEXED, IMPLICIT, IMPLICIT, ZEROPAGE_X, ZEROPAGE_X, ZEROPAGE_Y, IMPLICIT,
+    /* 98 */ IMPLICIT, ABSOLUTE_Y, IMPLICIT, IMPLICIT, IMPLICIT, ABSOLUTE_X, IMPLICIT, IMPLICIT,
+    /* A0 */ IMMEDIATE, INDEXED_INDIRECT, IMMEDIATE, IMPLICIT, ZEROPAGE, ZEROPAGE, ZEROPAGE, IMPLICIT,
+    /* A8 */ IMPLICIT, IMMEDIATE, IMPLICIT, IMPLICIT, ABSOLUTE, ABSOLUTE, ABSOLUTE, IMPLICIT,
+    /* B0 */ RELATIVE, INDIRECT_INDEXED, IMPLICIT, IMPLICIT, ZEROPAGE_X, ZEROPAGE_X, ZEROPAGE_Y, IMPLICIT,
+    /* B8 */ IMPLICIT, ABSOLUTE_Y, IMPLICIT, IMPLICIT, ABSOLUTE_X, ABSOLUTE_X, ABSOLUTE_Y, IMPLICIT,
+    /* C0 */ IMMEDIATE, INDEXED_INDIRECT, IMPLICIT, IMPLICIT, ZEROPAGE, ZEROPAGE, ZEROPAGE, IMPLICIT,
+    /* C8 */ IMPLICIT, IMMEDIATE, IMPLICIT, IMPLICIT, ABSOLUTE, ABSOLUTE, ABSOLUTE, IMPLICIT,
+    /* D0 */ RELATIVE, INDIRECT_INDEXED, IMPLICIT, IMPLICIT, IMPLICIT, ZEROPAGE_X, ZEROPAGE_X, IMPLICIT,
+    /* D8 */ IMPLICIT, ABSOLUTE_Y, IMPLICIT, IMPLICIT, IMPLICIT, ABSOLUTE_X, ABSOLUTE_X, IMPLICIT,
+    /* E0 */ IMMEDIATE, INDEXED_INDIRECT, IMPLICIT, IMPLICIT, ZEROPAGE, ZEROPAGE, ZEROPAGE, IMPLICIT,
+    /* E8 */ IMPLICIT, IMMEDIATE, IMPLICIT, IMPLICIT, ABSOLUTE, ABSOLUTE, ABSOLUTE, IMPLICIT,
+    /* F0 */ RELATIVE, INDIRECT_INDEXED, IMPLICIT, IMPLICIT, IMPLICIT, ZEROPAGE_X, ZEROPAGE_X, IMPLICIT,
+    /* F8 */ IMPLICIT, ABSOLUTE_Y, IMPLICIT, IMPLICIT, IMPLICIT, ABSOLUTE_X, ABSOLUTE_X, IMPLICIT
+};
 
-static void DebugInstruction(Memory *mem,
-                  uint16_t oldPc,
-                  uint8_t opcode,
-                  uint8_t op1,
-                  uint8_t op2,
-                  const Instruction *instr) {
-    printf("%04X %02X ", oldPc, opcode);
-    
-    // Save Memory Read Flags because we might change their values
-    uint8_t ppustatusRead = mem->ppustatusRead;
-
-    switch (instr->adrMode) {
-    case IMMEDIATE:
-        printf("%s #$%02X",
-            instr->mnemonic,
-             ReadCpuByte(mem,
-                gAddrDecodedInfo.immediate.addr));
-        break;
-    case ZEROPAGE:
-        printf("%02X %s $%02X = %02X",
-            op1,
-            instr->mnemonic,
-            gAddrDecodedInfo.zeropage.addr,
-             ReadCpuByte(mem,
-                gAddrDecodedInfo.zeropage.addr));
-        break;
-    case ZEROPAGE_X:
-        printf("%02X %s $%02X,X @ %02X = %02X",
-            op1,
-            instr->mnemonic,
-            gAddrDecodedInfo.zeropageIndexed.zpAddr,
-            (uint8_t)gAddrDecodedInfo.zeropageIndexed.addr,
-            ReadCpuByte(mem,
-                gAddrDecodedInfo.zeropageIndexed.addr));
-        break;
-    case ZEROPAGE_Y:
-    printf("%02X %s $%02X,Y @ %02X = %02X",
-            op1,
-            instr->mnemonic,
-            gAddrDecodedInfo.zeropageIndexed.zpAddr,
-            (uint8_t)gAddrDecodedInfo.zeropageIndexed.addr,
-            ReadCpuByte(mem,
-                gAddrDecodedInfo.zeropageIndexed.addr));
-        break;
-    case RELATIVE: {
-        uint8_t displacement = ReadCpuByte(mem,
-                    gAddrDecodedInfo.relative.addr);
-        // Probably need adjustements for "negative" displacements.
-        printf("%02X %s $%04X",
-            op1,
-            instr->mnemonic,
-            oldPc + 2 + displacement);
-        }
-        break;
-    case ABSOLUTE:
-        printf("%02X %02X %s $%04X",
-            op1,
-            op2,
-            instr->mnemonic,
-            gAddrDecodedInfo.absolute.addr);
-        break;
-    case ABSOLUTE_X:
-    printf("%02X %02X %s $%04X,X @ %04X = %02X",
-            op1,
-            op2,
-            instr->mnemonic,
-            gAddrDecodedInfo.absoluteIndexed.AbsoluteAddr,
-            gAddrDecodedInfo.absoluteIndexed.addr,
-            ReadCpuByte(mem,
-                gAddrDecodedInfo.absoluteIndexed.addr));
-        break;
-    case ABSOLUTE_Y:
-        printf("%02X %02X %s $%04X,Y @ %04X = %02X",
-            op1,
-            op2,
-            instr->mnemonic,
-            gAddrDecodedInfo.absoluteIndexed.AbsoluteAddr,
-            gAddrDecodedInfo.absoluteIndexed.addr,
-            ReadCpuByte(mem,
-                gAddrDecodedInfo.absoluteIndexed.addr));
-        break;
-    case INDIRECT:
-        printf("%02X %02X %s ($%04X) = %04X",
-            op1,
-            op2,
-            instr->mnemonic,
-            gAddrDecodedInfo.indirect.addr,
-            gAddrDecodedInfo.indirect.iaddr);
-        break;
-    case INDEXED_INDIRECT:
-        printf("%02X %s ($%02X,X) @ %02X = %04X = %02X",
-            op1,
-            instr->mnemonic,
-            gAddrDecodedInfo.indexedIndirect.zpAddr,
-            gAddrDecodedInfo.indexedIndirect.zpXAddr,
-            gAddrDecodedInfo.indexedIndirect.addr,
-            ReadCpuByte(mem,
-                gAddrDecodedInfo.indexedIndirect.addr));
-        break;
-    case INDIRECT_INDEXED:
-        /*printf("%02X %s ($02X),Y = %04X @ %04X = %02X",
-            op1,
-            instr->mnemonic,
-            g_addr_decoded_info.IndirectIndexed.zp_addr,
-            g_addr_decoded_info.IndirectIndexed.);*/
-        break;
-    default:
-        printf("%s", instr->mnemonic);
-    }
+static _Alignas(CACHE_LINE_SIZE) const uint8_t gInstrCycles[256] = {
+    /* 00 */ 7, 6, 2, 2, 2, 3, 5, 2,
+    /* 08 */ 3, 2, 2, 2, 2, 4, 6, 2,
+    /* 10 */ 2, 5, 2, 2, 2, 4, 6, 2,
+    /* 18 */ 2, 4, 2, 2, 2, 4, 7, 2,
+    /* 20 */ 6, 6, 2, 2, 3, 3, 5, 2,
+    /* 28 */ 4, 2, 2, 2, 4, 4, 6, 2,
+    /* 30 */ 2, 5, 2, 2, 2, 4, 6, 2,
+    /* 38 */ 2, 4, 2, 2, 2, 4, 7, 2,
+    /* 40 */ 6, 6, 2, 2, 2, 3, 5, 2,
+    /* 48 */ 3, 2, 2, 2, 3, 4, 6, 2,
+    /* 50 */ 2, 5, 2, 2, 2, 4, 6, 2,
+    /* 58 */ 2, 4, 2, 2, 2, 4, 7, 2,
+    /* 60 */ 6, 6, 2, 2, 2, 3, 5, 2,
+    /* 68 */ 4, 2, 2, 2, 5, 4, 6, 2,
+    /* 70 */ 2, 5, 2, 2, 2, 4, 6, 2,
+    /* 78 */ 2, 4, 2, 2, 2, 4, 7, 2,
+    /* 80 */ 2, 6, 2, 2, 3, 3, 3, 2,
+    /* 88 */ 2, 2, 2, 2, 4, 4, 4, 2,
+    /* 90 */ 2, 6, 2, 2, 4, 4, 4, 2,
+    /* 98 */ 2, 5, 2, 2, 2, 5, 2, 2,
+    /* A0 */ 2, 6, 2, 2, 3, 3, 3, 2,
+    /* A8 */ 2, 2, 2, 2, 4, 4, 4, 2,
+    /* B0 */ 2, 5, 2, 2, 4, 4, 4, 2,
+    /* B8 */ 2, 4, 2, 2, 4, 4, 4, 2,
+    /* C0 */ 2, 6, 2, 2, 3, 3, 5, 2,
+    /* C8 */ 2, 2, 2, 2, 4, 4, 6, 2,
+    /* D0 */ 2, 5, 2, 2, 2, 4, 6, 2,
+    /* D8 */ 2, 4, 2, 2, 2, 4, 7, 2,
+    /* E0 */ 2, 6, 2, 2, 3, 3, 5, 2,
+    /* E8 */ 2, 2, 2, 2, 4, 4, 6, 2,
+    /* F0 */ 2, 5, 2, 2, 2, 4, 6, 2,
+    /* F8 */ 2, 4, 2, 2, 2, 4, 7, 2
+};
 
-    printf("\t");
+/* Cold metadata for the disassembler and tracer. */
+static const InstructionInfo gInstructionInfo[256] = {
+    /* 00 */ {"BRK", IMPLICIT},
+    /* 01 */ {"ORA", INDEXED_INDIRECT},
+    /* 02 */ {"???", IMPLICIT},
+    /* 03 */ {"???", IMPLICIT},
+    /* 04 */ {"???", IMPLICIT},
+    /* 05 */ {"ORA", ZEROPAGE},
+    /* 06 */ {"ASL", ZEROPAGE},
+    /* 07 */ {"???", IMPLICIT},
+    /* 08 */ {"PHP", IMPLICIT},
+    /* 09 */ {"ORA", IMMEDIATE},
+    /* 0A */ {"ASL", ACCUMULATOR},
+    /* 0B */ {"???", IMPLICIT},
+    /* 0C */ {"???", IMPLICIT},
+    /* 0D */ {"ORA", ABSOLUTE},
+    /* 0E */ {"ASL", ABSOLUTE},
+    /* 0F */ {"???", IMPLICIT},
+    /* 10 */ {"BPL", RELATIVE},
+    /* 11 */ {"ORA", INDIRECT_INDEXED},
+    /* 12 */ {"???", IMPLICIT},
+    /* 13 */ {"???", IMPLICIT},
+    /* 14 */ {"???", IMPLICIT},
+    /* 15 */ {"ORA", ZEROPAGE_X},
+    /* 16 */ {"ASL", ZEROPAGE_X},
+    /* 17 */ {"???", IMPLICIT},
+    /* 18 */ {"CLC", IMPLICIT},
+    /* 19 */ {"ORA", ABSOLUTE_Y},
+    /* 1A */ {"???", IMPLICIT},
+    /* 1B */ {"???", IMPLICIT},
+    /* 1C */ {"???", IMPLICIT},
+    /* 1D */ {"ORA", ABSOLUTE_X},
+    /* 1E */ {"ASL", ABSOLUTE_X},
+    /* 1F */ {"???", IMPLICIT},
+    /* 20 */ {"JSR", ABSOLUTE},
+    /* 21 */ {"AND", INDEXED_INDIRECT},
+    /* 22 */ {"???", IMPLICIT},
+    /* 23 */ {"???", IMPLICIT},
+    /* 24 */ {"BIT", ZEROPAGE},
+    /* 25 */ {"AND", ZEROPAGE},
+    /* 26 */ {"ROL", ZEROPAGE},
+    /* 27 */ {"???", IMPLICIT},
+    /* 28 */ {"PLP", IMPLICIT},
+    /* 29 */ {"AND", IMMEDIATE},
+    /* 2A */ {"ROL", ACCUMULATOR},
+    /* 2B */ {"???", IMPLICIT},
+    /* 2C */ {"BIT", ABSOLUTE},
+    /* 2D */ {"AND", ABSOLUTE},
+    /* 2E */ {"ROL", ABSOLUTE},
+    /* 2F */ {"???", IMPLICIT},
+    /* 30 */ {"BMI", RELATIVE},
+    /* 31 */ {"AND", INDIRECT_INDEXED},
+    /* 32 */ {"???", IMPLICIT},
+    /* 33 */ {"???", IMPLICIT},
+    /* 34 */ {"???", IMPLICIT},
+    /* 35 */ {"AND", ZEROPAGE_X},
+    /* 36 */ {"ROL", ZEROPAGE_X},
+    /* 37 */ {"???", IMPLICIT},
+    /* 38 */ {"SEC", IMPLICIT},
+    /* 39 */ {"AND", ABSOLUTE_Y},
+    /* 3A */ {"???", IMPLICIT},
+    /* 3B */ {"???", IMPLICIT},
+    /* 3C */ {"???", IMPLICIT},
+    /* 3D */ {"AND", ABSOLUTE_X},
+    /* 3E */ {"ROL", ABSOLUTE_X},
+    /* 3F */ {"???", IMPLICIT},
+    /* 40 */ {"RTI", IMPLICIT},
+    /* 41 */ {"EOR", INDEXED_INDIRECT},
+    /* 42 */ {"???", IMPLICIT},
+    /* 43 */ {"???", IMPLICIT},
+    /* 44 */ {"???", IMPLICIT},
+    /* 45 */ {"EOR", ZEROPAGE},
+    /* 46 */ {"LSR", ZEROPAGE},
+    /* 47 */ {"???", IMPLICIT},
+    /* 48 */ {"PHA", IMPLICIT},
+    /* 49 */ {"EOR", IMMEDIATE},
+    /* 4A */ {"LSR", ACCUMULATOR},
+    /* 4B */ {"???", IMPLICIT},
+    /* 4C */ {"JMP", ABSOLUTE},
+    /* 4D */ {"EOR", ABSOLUTE},
+    /* 4E */ {"LSR", ABSOLUTE},
+    /* 4F */ {"???", IMPLICIT},
+    /* 50 */ {"BVC", RELATIVE},
+    /* 51 */ {"EOR", INDIRECT_INDEXED},
+    /* 52 */ {"???", IMPLICIT},
+    /* 53 */ {"???", IMPLICIT},
+    /* 54 */ {"???", IMPLICIT},
+    /* 55 */ {"EOR", ZEROPAGE_X},
+    /* 56 */ {"LSR", ZEROPAGE_X},
+    /* 57 */ {"???", IMPLICIT},
+    /* 58 */ {"CLI", IMPLICIT},
+    /* 59 */ {"EOR", ABSOLUTE_Y},
+    /* 5A */ {"???", IMPLICIT},
+    /* 5B */ {"???", IMPLICIT},
+    /* 5C */ {"???", IMPLICIT},
+    /* 5D */ {"EOR", ABSOLUTE_X},
+    /* 5E */ {"LSR", ABSOLUTE_X},
+    /* 5F */ {"???", IMPLICIT},
+    /* 60 */ {"RTS", IMPLICIT},
+    /* 61 */ {"ADC", INDEXED_INDIRECT},
+    /* 62 */ {"???", IMPLICIT},
+    /* 63 */ {"???", IMPLICIT},
+    /* 64 */ {"???", IMPLICIT},
+    /* 65 */ {"ADC", ZEROPAGE},
+    /* 66 */ {"ROR", ZEROPAGE},
+    /* 67 */ {"???", IMPLICIT},
+    /* 68 */ {"PLA", IMPLICIT},
+    /* 69 */ {"ADC", IMMEDIATE},
+    /* 6A */ {"ROR", ACCUMULATOR},
+    /* 6B */ {"???", IMPLICIT},
+    /* 6C */ {"JMP", INDIRECT},
+    /* 6D */ {"ADC", ABSOLUTE},
+    /* 6E */ {"ROR", ABSOLUTE},
+    /* 6F */ {"???", IMPLICIT},
+    /* 70 */ {"BVS", RELATIVE},
+    /* 71 */ {"ADC", INDIRECT_INDEXED},
+    /* 72 */ {"???", IMPLICIT},
+    /* 73 */ {"???", IMPLICIT},
+    /* 74 */ {"???", IMPLICIT},
+    /* 75 */ {"ADC", ZEROPAGE_X},
+    /* 76 */ {"ROR", ZEROPAGE_X},
+    /* 77 */ {"???", IMPLICIT},
+    /* 78 */ {"SEI", IMPLICIT},
+    /* 79 */ {"ADC", ABSOLUTE_Y},
+    /* 7A */ {"???", IMPLICIT},
+    /* 7B */ {"???", IMPLICIT},
+    /* 7C */ {"???", IMPLICIT},
+    /* 7D */ {"ADC", ABSOLUTE_X},
+    /* 7E */ {"ROR", ABSOLUTE_X},
+    /* 7F */ {"???", IMPLICIT},
+    /* 80 */ {"???", IMPLICIT},
+    /* 81 */ {"STA", INDEXED_INDIRECT},
+    /* 82 */ {"???", IMPLICIT},
+    /* 83 */ {"???", IMPLICIT},
+    /* 84 */ {"STY", ZEROPAGE},
+    /* 85 */ {"STA", ZEROPAGE},
+    /* 86 */ {"STX", ZEROPAGE},
+    /* 87 */ {"???", IMPLICIT},
+    /* 88 */ {"DEY", IMPLICIT},
+    /* 89 */ {"???", IMPLICIT},
+    /* 8A */ {"TXA", IMPLICIT},
+    /* 8B */ {"???", IMPLICIT},
+    /* 8C */ {"STY", ABSOLUTE},
+    /* 8D */ {"STA", ABSOLUTE},
+    /* 8E */ {"STX", ABSOLUTE},
+    /* 8F */ {"???", IMPLICIT},
+    /* 90 */ {"BCC", RELATIVE},
+    /* 91 */ {"STA", INDIRECT_INDEXED},
+    /* 92 */ {"???", IMPLICIT},
+    /* 93 */ {"???", IMPLICIT},
+    /* 94 */ {"STY", ZEROPAGE_X},
+    /* 95 */ {"STA", ZEROPAGE_X},
+    /* 96 */ {"STX", ZEROPAGE_Y},
+    /* 97 */ {"???", IMPLICIT},
+    /* 98 */ {"TYA", IMPLICIT},
+    /* 99 */ {"STA", ABSOLUTE_Y},
+    /* 9A */ {"TXS", IMPLICIT},
+    /* 9B */ {"???", IMPLICIT},
+    /* 9C */ {"???", IMPLICIT},
+    /* 9D */ {"STA", ABSOLUTE_X},
+    /* 9E */ {"???", IMPLICIT},
+    /* 9F */ {"???", IMPLICIT},
+    /* A0 */ {"LDY", IMMEDIATE},
+    /* A1 */ {"LDA", INDEXED_INDIRECT},
+    /* A2 */ {"LDX", IMMEDIATE},
+    /* A3 */ {"???", IMPLICIT},
+    /* A4 */ {"LDY", ZEROPAGE},
+    /* A5 */ {"LDA", ZEROPAGE},
+    /* A6 */ {"LDX", ZEROPAGE},
+    /* A7 */ {"???", IMPLICIT},
+    /* A8 */ {"TAY", IMPLICIT},
+    /* A9 */ {"LDA", IMMEDIATE},
+    /* AA */ {"TAX", IMPLICIT},
+    /* AB */ {"???", IMPLICIT},
+    /* AC */ {"LDY", ABSOLUTE},
+    /* AD */ {"LDA", ABSOLUTE},
+    /* AE */ {"LDX", ABSOLUTE},
+    /* AF */ {"???", IMPLICIT},
+    /* B0 */ {"BCS", RELATIVE},
+    /* B1 */ {"LDA", INDIRECT_INDEXED},
+    /* B2 */ {"???", IMPLICIT},
+    /* B3 */ {"???", IMPLICIT},
+    /* B4 */ {"LDY", ZEROPAGE_X},
+    /* B5 */ {"LDA", ZEROPAGE_X},
+    /* B6 */ {"LDX", ZEROPAGE_Y},
+    /* B7 */ {"???", IMPLICIT},
+    /* B8 */ {"CLV", IMPLICIT},
+    /* B9 */ {"LDA", ABSOLUTE_Y},
+    /* BA */ {"TSX", IMPLICIT},
+    /* BB */ {"???", IMPLICIT},
+    /* BC */ {"LDY", ABSOLUTE_X},
+    /* BD */ {"LDA", ABSOLUTE_X},
+    /* BE */ {"LDX", ABSOLUTE_Y},
+    /* BF */ {"???", IMPLICIT},
+    /* C0 */ {"CPY", IMMEDIATE},
+    /* C1 */ {"CMP", INDEXED_INDIRECT},
+    /* C2 */ {"???", IMPLICIT},
+    /* C3 */ {"???", IMPLICIT},
+    /* C4 */ {"CPY", ZEROPAGE},
+    /* C5 */ {"CMP", ZEROPAGE},
+    /* C6 */ {"DEC", ZEROPAGE},
+    /* C7 */ {"???", IMPLICIT},
+    /* C8 */ {"INY", IMPLICIT},
+    /* C9 */ {"CMP", IMMEDIATE},
+    /* CA */ {"DEX", IMPLICIT},
+    /* CB */ {"???", IMPLICIT},
+    /* CC */ {"CPY", ABSOLUTE},
+    /* CD */ {"CMP", ABSOLUTE},
+    /* CE */ {"DEC", ABSOLUTE},
+    /* CF */ {"???", IMPLICIT},
+    /* D0 */ {"BNE", RELATIVE},
+    /* D1 */ {"CMP", INDIRECT_INDEXED},
+    /* D2 */ {"???", IMPLICIT},
+    /* D3 */ {"???", IMPLICIT},
+    /* D4 */ {"???", IMPLICIT},
+    /* D5 */ {"CMP", ZEROPAGE_X},
+    /* D6 */ {"DEC", ZEROPAGE_X},
+    /* D7 */ {"???", IMPLICIT},
+    /* D8 */ {"CLD", IMPLICIT},
+    /* D9 */ {"CMP", ABSOLUTE_Y},
+    /* DA */ {"???", IMPLICIT},
+    /* DB */ {"???", IMPLICIT},
+    /* DC */ {"???", IMPLICIT},
+    /* DD */ {"CMP", ABSOLUTE_X},
+    /* DE */ {"DEC", ABSOLUTE_X},
+    /* DF */ {"???", IMPLICIT},
+    /* E0 */ {"CPX", IMMEDIATE},
+    /* E1 */ {"SBC", INDEXED_INDIRECT},
+    /* E2 */ {"???", IMPLICIT},
+    /* E3 */ {"???", IMPLICIT},
+    /* E4 */ {"CPX", ZEROPAGE},
+    /* E5 */ {"SBC", ZEROPAGE},
+    /* E6 */ {"INC", ZEROPAGE},
+    /* E7 */ {"???", IMPLICIT},
+    /* E8 */ {"INX", IMPLICIT},
+    /* E9 */ {"SBC", IMMEDIATE},
+    /* EA */ {"NOP", IMPLICIT},
+    /* EB */ {"???", IMPLICIT},
+    /* EC */ {"CPX", ABSOLUTE},
+    /* ED */ {"SBC", ABSOLUTE},
+    /* EE */ {"INC", ABSOLUTE},
+    /* EF */ {"???", IMPLICIT},
+    /* F0 */ {"BEQ", RELATIVE},
+    /* F1 */ {"SBC", INDIRECT_INDEXED},
+    /* F2 */ {"???", IMPLICIT},
+    /* F3 */ {"???", IMPLICIT},
+    /* F4 */ {"???", IMPLICIT},
+    /* F5 */ {"SBC", ZEROPAGE_X},
+    /* F6 */ {"INC", ZEROPAGE_X},
+    /* F7 */ {"???", IMPLICIT},
+    /* F8 */ {"SED", IMPLICIT},
+    /* F9 */ {"SBC", ABSOLUTE_Y},
+    /* FA */ {"???", IMPLICIT},
+    /* FB */ {"???", IMPLICIT},
+    /* FC */ {"???", IMPLICIT},
+    /* FD */ {"SBC", ABSOLUTE_X},
+    /* FE */ {"INC", ABSOLUTE_X},
+    /* FF */ {"???", IMPLICIT}
+};
 
-    // Set original read flags values back.
-    mem->ppustatusRead = ppustatusRead;
+const InstructionInfo *CpuInstructionInfo(uint8_t opcode) {
+    return &gInstructionInfo[opcode];
 }
 
-static void PrintStack(const Cpu *cpu) {
-    printf("---STACK---");
-    for (uint16_t i = 0xFF; i != cpu->regs.sp; --i) {
-        if ((i + 1) % 16 == 0) {
-            printf("\n%02X: ", i);
-        }
+uint8_t CpuInstructionLength(uint8_t opcode) {
+    switch (gInstructionInfo[opcode].adrMode) {
+        case IMPLICIT:
+        case ACCUMULATOR:
+            return 1;
+        case ABSOLUTE:
+        case ABSOLUTE_X:
+        case ABSOLUTE_Y:
+        case INDIRECT:
+            return 3;
+        default:
+            return 2;
+    }
+}
 
-        uint8_t byte = ReadCpuByte(cpu->mem, STACK_START + i);
-        printf("%02X ", byte);
+/* Immediate operations that only look at the register the load just set. */
+static uint8_t IsIdleCompare(uint8_t load, uint8_t op) {
+    switch (load) {
+        case 0xA5: case 0xAD: /* LDA */
+            return op == 0x29 || op == 0x09 || op == 0x49 || op == 0xC9;
+        case 0xA6: case 0xAE: /* LDX */
+            return op == 0xE0;
+        case 0xA4: case 0xAC: /* LDY */
+            return op == 0xC0;
+        default:
+            return 0;
     }
-    puts("\n-----------");
 }
 
-static void PrintRegisters(const Registers *regs) {
-    printf("pc: %04X sp: %02X s: %02X "
-        "x: %02X y: %02X a: %02x ",
-        regs->pc, regs->sp, regs->s,
-        regs->x, regs->y, regs->a);
+/* Matches "JMP *" and "load; [immediate compare;] branch back to the load"
+ * without touching the bus. The loop changes nothing but registers that each
+ * pass sets again from the one byte it reads, so until that byte changes
+ * every pass is the same as the last. */
+IDLE_LOOP CpuIdleLoop(const Cpu *cpu, uint16_t pc, uint8_t *length) {
+    const Memory *mem = cpu->mem;
+    uint8_t load = PeekCpuByte(mem, pc);
+    uint16_t addr = PeekCpuByte(mem, pc + 1);
+    uint16_t next = pc + 2;
+
+    *length = 1;
+    if (load == 0x4C)
+        return (addr | PeekCpuByte(mem, pc + 2) << 8) == pc ? IDLE_SPIN : IDLE_NONE;
+
+    switch (load) {
+        case 0xA5: case 0xA6: case 0xA4: case 0x24: /* LDA, LDX, LDY, BIT zp */
+            break;
+        case 0xAD: case 0xAE: case 0xAC: case 0x2C: /* abs */
+            addr |= PeekCpuByte(mem, pc + 2) << 8;
+            ++next;
+            break;
+        default:
+            return IDLE_NONE;
+    }
+
+    *length = 2;
+    if (IsIdleCompare(load, PeekCpuByte(mem, next))) {
+        next += 2;
+        ++*length;
+    }
+
+    uint8_t branch = PeekCpuByte(mem, next);
+    int8_t displacement = PeekCpuByte(mem, next + 1);
+
+    /* Every branch opcode is xxx10000. */
+    if ((branch & 0x1F) != 0x10 || (uint16_t)(next + 2 + displacement) != pc)
+        return IDLE_NONE;
+
+    if (addr < 0x2000)
+        return IDLE_RAM;
+    if (addr < 0x4000 && (addr & 7) == (PPUSTATUS & 7))
+        return IDLE_PPUSTATUS;
+
+    return IDLE_NONE;
 }
 
 static void PushStack(Cpu *cpu, uint8_t byte) {
@@ -574,6 +571,9 @@ static void SetZnFlags(Cpu *cpu, uint8_t value) {
 }
 
 void CpuRequestInterrupt(Cpu *cpu, INTERRUPT i) {
+    if (cpu->mem->trace && i != RESET)
+        TraceLog(cpu->mem->trace, i == NMI ? TRACE_NMI : TRACE_IRQ, 0, 0);
+
     if (i == NMI || !CheckStatus(cpu, INTERRUPT_DISABLE))
         cpu->interrupt |= i;
 }
@@ -584,10 +584,11 @@ static void HandleInterrupt(Cpu *cpu) {
     if ((cpu->interrupt & RESET) != 0) {
         handler = RESET_INTERRUPT_VECTOR;
         cpu->interrupt &= ~RESET;
+        cpu->jammed = 0;
     } else if ((cpu->interrupt & NMI) != 0) {
         handler = NMI_INTERRUPT_VECTOR;
         cpu->interrupt &= ~NMI;
-    } else if ((cpu->interrupt & IRQ) != 0) {
+    } else {
         handler = IRQ_INTERRUPT_VECTOR;
         cpu->interrupt &= ~IRQ;
     }
@@ -610,8 +611,6 @@ static uint16_t Absolute(Cpu *cpu) {
     uint8_t hi = ReadCpuByte(cpu->mem, cpu->regs.pc++);
     uint16_t addr = ((uint16_t)hi << 8) | (uint16_t)lo;
 
-    gAddrDecodedInfo.absolute.addr = addr;
-
     return addr;
 }
 
@@ -620,45 +619,28 @@ static uint16_t AbsoluteIndexed(Cpu *cpu, uint8_t index) {
     uint8_t hi = ReadCpuByte(cpu->mem, cpu->regs.pc++);
     uint16_t absolute = ((uint16_t)hi << 8) | (uint16_t)lo;
     uint16_t addr = absolute + (uint16_t)index;
-    
-    if ((uint16_t)lo > (addr & 0xFF))
-        printf("\npage crossed\n");
-
-    gAddrDecodedInfo.absoluteIndexed.AbsoluteAddr = absolute;
-    gAddrDecodedInfo.absoluteIndexed.index = index;
-    gAddrDecodedInfo.absoluteIndexed.addr = addr;
 
     return addr;
 }
 
 static uint16_t Immediate(Cpu *cpu) {
-    gAddrDecodedInfo.immediate.addr = cpu->regs.pc;
-
     return cpu->regs.pc++;
 }
 
 static uint16_t Zeropage(Cpu *cpu) {
     uint8_t addr = ReadCpuByte(cpu->mem, cpu->regs.pc++);
 
-    gAddrDecodedInfo.zeropage.addr = addr;
-
     return (uint16_t)addr;
 }
 
 static uint16_t ZeropageIndexed(Cpu *cpu, uint8_t index) {
     uint8_t byte = ReadCpuByte(cpu->mem, cpu->regs.pc++);
     uint16_t addr = (byte + index) % 0xFF;
-    
-    gAddrDecodedInfo.zeropageIndexed.zpAddr = byte;
-    gAddrDecodedInfo.zeropageIndexed.addr = addr;
-    gAddrDecodedInfo.zeropageIndexed.index = index;
 
     return addr;
 }
 
 static uint16_t Relative(Cpu *cpu) {
-    gAddrDecodedInfo.relative.addr = cpu->regs.pc;
-
     return cpu->regs.pc++;
 }
 
@@ -671,9 +653,6 @@ static uint16_t Indirect(Cpu *cpu) {
     hi = ReadCpuByte(cpu->mem, addr + 1);
     uint16_t iaddr = ((uint16_t)hi << 8) | (uint16_t)lo;
 
-    gAddrDecodedInfo.indirect.addr = addr;
-    gAddrDecodedInfo.indirect.iaddr = iaddr;
-
     return iaddr;
 }
 
@@ -685,10 +664,6 @@ static uint16_t IndexedIndirect(Cpu *cpu) {
     uint8_t hi = ReadCpuByte(cpu->mem, zp_x_addr + 1);
     uint16_t addr = ((uint16_t)hi << 8) | (uint16_t)lo;
 
-    gAddrDecodedInfo.indexedIndirect.zpAddr = zp_addr;
-    gAddrDecodedInfo.indexedIndirect.zpXAddr = zp_x_addr;
-    gAddrDecodedInfo.indexedIndirect.addr = addr;
-    
     return addr;
 }
 
@@ -699,13 +674,6 @@ static uint16_t IndirectIndexed(Cpu *cpu) {
     uint8_t lo = ReadCpuByte(cpu->mem, zp_addr);
     uint8_t hi = ReadCpuByte(cpu->mem, zp_addr + 1);
     uint16_t addr = (((uint16_t)hi << 8) | (uint16_t)lo) + (uint16_t)cpu->regs.y;
-    
-    if ((uint16_t)lo > (addr & 0xFF))
-        printf("\npage crossed\n0");
-
-    gAddrDecodedInfo.indirectIndexed.y = cpu->regs.y;
-    gAddrDecodedInfo.indirectIndexed.zpAddr = zp_addr;
-    gAddrDecodedInfo.indirectIndexed.addr = addr;
 
     return addr;
 }
@@ -713,6 +681,26 @@ static uint16_t IndirectIndexed(Cpu *cpu) {
 /* TODO: Unnoficial opcodes need to be implemented... for now let's try to work with this and try to get the ppu a start as well.
  * Work on a better way to print instructions on the screen. 
  */
+/* Opcode fetches from pages without a direct pointer: those with a
+ * breakpoint, all of them while tracing and PRG while coverage is on. */
+static uint16_t FetchOpcodeSlow(Cpu *cpu) {
+    Coverage *cov = cpu->mem->coverage;
+
+    if (cov)
+        CoverageFetch(cov, cpu->regs.pc);
+
+    uint8_t opcode = ReadCpuByte(cpu->mem, cpu->regs.pc);
+    Debugger *dbg = cpu->mem->debugger;
+
+    if (cov)
+        CoverageSetLength(cov, CpuInstructionLength(opcode));
+
+    if (dbg && DebuggerFetch(dbg, cpu, opcode))
+        return CPU_TRAP;
+
+    return opcode;
+}
+
 uint8_t CpuEmulate(Cpu *cpu) {
     /* Is the current instruction in execution? */
     if (cpu->currentCycle < cpu->cycles) {
@@ -728,25 +716,28 @@ uint8_t CpuEmulate(Cpu *cpu) {
     cpu->cycles = 0;
     cpu->currentCycle = 0;
     
-    uint16_t oldPc = cpu->regs.pc;
-    uint8_t opcode = ReadCpuByte(cpu->mem, cpu->regs.pc);
-    uint8_t op1 = ReadCpuByte(cpu->mem, cpu->regs.pc + 1);
-    uint8_t op2 = ReadCpuByte(cpu->mem, cpu->regs.pc + 2);
+    uint16_t pc = cpu->regs.pc;
+    const uint8_t *page = cpu->mem->execPages[pc >> 8];
+    uint8_t opcode;
 
-    const InstructionOrNothing *possibleInstr = &gInstructionTable[opcode];
+    cpu->opcodeAddr = pc;
 
-    if (!possibleInstr->valid) {
-        fprintf(stderr, "Invalid opcode %02x found\n", opcode);
-        return 0;
-    }
+    if (page) {
+        opcode = page[pc & 0xFF];
+    } else {
+        uint16_t fetched = FetchOpcodeSlow(cpu);
 
-    const Instruction *instr = &possibleInstr->instr;
-    assert(instr->opcode == opcode);
+        /* Stopped at a breakpoint, the instruction runs after resuming. */
+        if (fetched == CPU_TRAP)
+            return CPU_STOPPED;
+
+        opcode = fetched;
+    }
 
     ++cpu->regs.pc;
 
     uint16_t addr;
-    switch (instr->adrMode) {
+    switch (gInstrAdrMode[opcode]) {
         case IMMEDIATE:
             addr = Immediate(cpu);
             break;
@@ -784,13 +775,14 @@ uint8_t CpuEmulate(Cpu *cpu) {
             addr = 0;
     }
 
-    DebugInstruction(cpu->mem, oldPc, opcode, op1, op2, instr);
-    
-    cpu->cycles = instr->cycles;
-    if (instr->execute)
-        instr->execute(cpu, addr);
+    cpu->cycles = gInstrCycles[opcode];
+    gInstrExecute[opcode](cpu, addr);
 
-    PrintRegisters(&cpu->regs);
+    /* The copy already happened, the CPU just sits out the DMA's cycles. */
+    if (cpu->mem->oamDmaPending) {
+        cpu->cycles += OAM_DMA_CYCLES + ((*cpu->totalCycles + cpu->cycles) & 1);
+        cpu->mem->oamDmaPending = 0;
+    }
 
     /* Finished an instruction. */
     *(cpu->totalCycles) += cpu->cycles;
@@ -810,8 +802,10 @@ void CpuInit(Cpu *cpu, Memory *mem, uint64_t *totalCycles) {
     cpu->regs = regs;
     cpu->mem = mem;
     cpu->interrupt = RESET;
+    cpu->jammed = 0;
     cpu->cycles = 0;
     cpu->currentCycle = 0;
+    cpu->opcodeAddr = 0;
     cpu->totalCycles = totalCycles;
 }
 
@@ -1186,6 +1180,20 @@ INSTR(Sed) {
     SetStatus(cpu, DECIMAL, 1);
 }
 
+INSTR(Nop) {
+    (void)cpu;
+    (void)addr;
+}
+
+/* Unofficial opcodes aren't implemented yet, so jam on them like KIL does.
+ * Clients find out through cpu->jammed, the core doesn't print. */
+INSTR(Illegal) {
+    (void)addr;
+
+    --cpu->regs.pc;
+    cpu->jammed = 1;
+}
+
 static void IncDecImpl(Cpu *cpu, uint16_t addr, uint8_t change) {
     uint8_t byte = ReadCpuByte(cpu->mem, addr) + change;
     
@@ -37,6 +37,18 @@ typedef enum _ADDRESSING_MODE {
     INDIRECT_INDEXED
 } ADDRESSING_MODE;
 
+typedef struct _InstructionInfo {
+    const char *mnemonic;
+    ADDRESSING_MODE adrMode;
+} InstructionInfo;
+
+typedef enum _IDLE_LOOP {
+    IDLE_NONE,
+    IDLE_SPIN,      /* JMP to itself, only an interrupt gets out */
+    IDLE_RAM,       /* Polls RAM, which only an interrupt handler can change */
+    IDLE_PPUSTATUS  /* Polls PPUSTATUS, which changes on PPU events */
+} IDLE_LOOP;
+
 typedef struct _Registers {
     uint16_t pc; // Program Counter
     uint8_t  sp; // Stack Pointer
@@ -51,14 +63,34 @@ typedef struct _Cpu {
     Memory *mem;
 
     uint8_t interrupt;
-    uint8_t cycles;
-    uint8_t currentCycle;
+    /* Set when an opcode that isn't implemented stops the CPU at pc. Only
+     * a reset gets it going again. */
+    uint8_t jammed;
+    /* Wide enough to hold an OAM DMA stall. */
+    uint16_t cycles;
+    uint16_t currentCycle;
+    /* Where the instruction last run started, for the debugger's reports. */
+    uint16_t opcodeAddr;
 
     uint64_t *totalCycles;
 } Cpu;
 
+/* CpuEmulate's return when a breakpoint stopped the CPU before a fetch.
+ * No cycle passed, so the step has to be taken again after resuming. */
+#define CPU_STOPPED 2
+
 void CpuInit(Cpu *cpu, Memory *mem, uint64_t *totalCycles);
+/* Runs a cycle. Returns 1 when an instruction ran in it, 0 otherwise, or
+ * CPU_STOPPED. */
 uint8_t CpuEmulate(Cpu *cpu);
 void CpuRequestInterrupt(Cpu *cpu, INTERRUPT i);
 
+const InstructionInfo *CpuInstructionInfo(uint8_t opcode);
+/* Opcode and operand bytes. */
+uint8_t CpuInstructionLength(uint8_t opcode);
+
+/* Whether the code at pc is a polling loop with no side effects, and how
+ * many instructions one pass of it runs. */
+IDLE_LOOP CpuIdleLoop(const Cpu *cpu, uint16_t pc, uint8_t *length);
+
 #endif
@@ -0,0 +1,189 @@
+#include "debugger.h"
+#include "disasm.h"
+
+void DebuggerInit(Debugger *dbg, Memory *mem, Ppu *ppu) {
+    dbg->mem = mem;
+    dbg->ppu = ppu;
+    dbg->stop = &ppu->frameComplete;
+    dbg->traceOut = NULL;
+
+    dbg->breakpointCount = 0;
+    dbg->watchpointCount = 0;
+    dbg->traceNext = 0;
+    dbg->traceCount = 0;
+
+    dbg->hit = 0;
+    dbg->reason = BREAK_NONE;
+    dbg->hitAddr = 0;
+    dbg->resuming = 0;
+}
+
+static void Arm(Debugger *dbg) {
+    uint8_t armed = dbg->breakpointCount || dbg->watchpointCount || dbg->traceOut;
+
+    dbg->mem->debugger = armed ? dbg : NULL;
+    MemoryMapPages(dbg->mem);
+}
+
+uint8_t DebuggerAddBreakpoint(Debugger *dbg, uint16_t pc) {
+    if (dbg->breakpointCount == DEBUGGER_MAX_BREAKPOINTS) {
+        fprintf(stderr, "Too many breakpoints, at most %d\n", DEBUGGER_MAX_BREAKPOINTS);
+        return 0;
+    }
+
+    dbg->breakpoints[dbg->breakpointCount++] = pc;
+    Arm(dbg);
+    return 1;
+}
+
+uint8_t DebuggerAddWatchpoint(Debugger *dbg, uint16_t begin, uint16_t end, uint8_t type) {
+    if (dbg->watchpointCount == DEBUGGER_MAX_WATCHPOINTS) {
+        fprintf(stderr, "Too many watchpoints, at most %d\n", DEBUGGER_MAX_WATCHPOINTS);
+        return 0;
+    }
+
+    Watchpoint *watch = &dbg->watchpoints[dbg->watchpointCount++];
+    watch->begin = begin < end ? begin : end;
+    watch->end = begin < end ? end : begin;
+    watch->type = type;
+
+    Arm(dbg);
+    return 1;
+}
+
+void DebuggerSetTrace(Debugger *dbg, FILE *out) {
+    dbg->traceOut = out;
+    Arm(dbg);
+}
+
+void DebuggerClear(Debugger *dbg) {
+    dbg->breakpointCount = 0;
+    dbg->watchpointCount = 0;
+    DebuggerResume(dbg);
+    Arm(dbg);
+}
+
+void DebuggerResume(Debugger *dbg) {
+    dbg->resuming = dbg->reason == BREAK_PC;
+    dbg->hit = 0;
+    dbg->reason = BREAK_NONE;
+}
+
+static void PrintRegisters(const Registers *regs, FILE *out) {
+    fprintf(out, "A:%02X X:%02X Y:%02X P:%02X SP:%02X",
+            regs->a, regs->x, regs->y, regs->s, regs->sp);
+}
+
+static void TraceInstruction(const Debugger *dbg, const Cpu *cpu) {
+    char line[DISASM_LINE_SIZE];
+
+    DisasmInstruction(dbg->mem, &cpu->regs, cpu->regs.pc, line, sizeof(line));
+    fprintf(dbg->traceOut, "%-47s ", line);
+    PrintRegisters(&cpu->regs, dbg->traceOut);
+    fprintf(dbg->traceOut, " PPU:%3u,%3u CYC:%lu\n",
+            dbg->ppu->scanline, dbg->ppu->cycle, *cpu->totalCycles);
+}
+
+static void Hit(Debugger *dbg, BREAK_REASON reason, uint16_t addr) {
+    if (dbg->hit)
+        return;
+
+    dbg->hit = 1;
+    dbg->reason = reason;
+    dbg->hitAddr = addr;
+    *dbg->stop = 1;
+}
+
+uint8_t DebuggerWatchesPage(const Debugger *dbg, uint8_t page, uint8_t type) {
+    for (uint8_t i = 0; i < dbg->watchpointCount; ++i) {
+        const Watchpoint *watch = &dbg->watchpoints[i];
+
+        if ((watch->type & type) && page >= watch->begin >> 8 && page <= watch->end >> 8)
+            return 1;
+    }
+
+    return 0;
+}
+
+uint8_t DebuggerBreaksOnPage(const Debugger *dbg, uint8_t page) {
+    for (uint8_t i = 0; i < dbg->breakpointCount; ++i) {
+        if (dbg->breakpoints[i] >> 8 == page)
+            return 1;
+    }
+
+    return 0;
+}
+
+uint8_t DebuggerFetch(Debugger *dbg, const Cpu *cpu, uint8_t opcode) {
+    uint16_t pc = cpu->regs.pc;
+
+    if (dbg->resuming && pc == dbg->hitAddr) {
+        dbg->resuming = 0;
+    } else {
+        for (uint8_t i = 0; i < dbg->breakpointCount; ++i) {
+            if (dbg->breakpoints[i] == pc) {
+                Hit(dbg, BREAK_PC, pc);
+                return 1;
+            }
+        }
+    }
+
+    TraceRecord *record = &dbg->trace[dbg->traceNext];
+    record->regs = cpu->regs;
+    record->opcode = opcode;
+    record->cycle = *cpu->totalCycles;
+
+    dbg->traceNext = (dbg->traceNext + 1) % DEBUGGER_TRACE_SIZE;
+    if (dbg->traceCount < DEBUGGER_TRACE_SIZE)
+        ++dbg->traceCount;
+
+    if (dbg->traceOut)
+        TraceInstruction(dbg, cpu);
+
+    return 0;
+}
+
+void DebuggerAccess(Debugger *dbg, uint16_t addr, uint8_t type) {
+    for (uint8_t i = 0; i < dbg->watchpointCount; ++i) {
+        const Watchpoint *watch = &dbg->watchpoints[i];
+
+        if ((watch->type & type) && addr >= watch->begin && addr <= watch->end) {
+            Hit(dbg, type == WATCH_READ ? BREAK_READ : BREAK_WRITE, addr);
+            return;
+        }
+    }
+}
+
+void DebuggerReport(const Debugger *dbg, const Cpu *cpu, FILE *out) {
+    switch (dbg->reason) {
+        case BREAK_PC:
+            fprintf(out, "Breakpoint at $%04X\n", dbg->hitAddr);
+            break;
+        case BREAK_READ:
+        case BREAK_WRITE:
+            fprintf(out, "%s of $%04X by the instruction at $%04X\n",
+                    dbg->reason == BREAK_READ ? "Read" : "Write", dbg->hitAddr, cpu->opcodeAddr);
+            break;
+        default:
+            return;
+    }
+
+    fprintf(out, "PC:%04X ", cpu->regs.pc);
+    PrintRegisters(&cpu->regs, out);
+    fprintf(out, " CYC:%lu\n", *cpu->totalCycles);
+
+    if (!dbg->traceCount)
+        return;
+
+    fprintf(out, "Last %u instructions:\n", dbg->traceCount);
+    for (uint32_t i = 0; i < dbg->traceCount; ++i) {
+        uint32_t index = (dbg->traceNext + DEBUGGER_TRACE_SIZE - dbg->traceCount + i) % DEBUGGER_TRACE_SIZE;
+        const TraceRecord *record = &dbg->trace[index];
+        char line[DISASM_LINE_SIZE];
+
+        DisasmInstruction(dbg->mem, NULL, record->regs.pc, line, sizeof(line));
+        fprintf(out, "  %-32s ", line);
+        PrintRegisters(&record->regs, out);
+        fprintf(out, " CYC:%lu\n", record->cycle);
+    }
+}
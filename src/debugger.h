@@ -0,0 +1,90 @@
+#ifndef DEBUGGER_H_
+#define DEBUGGER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "cpu.h"
+#include "memory.h"
+#include "ppu.h"
+
+#define DEBUGGER_MAX_BREAKPOINTS 16
+#define DEBUGGER_MAX_WATCHPOINTS 16
+#define DEBUGGER_TRACE_SIZE      64
+
+typedef enum _WATCH_TYPE {
+    WATCH_READ  = 0x01,
+    WATCH_WRITE = 0x02
+} WATCH_TYPE;
+
+typedef enum _BREAK_REASON {
+    BREAK_NONE,
+    BREAK_PC,
+    BREAK_READ,
+    BREAK_WRITE
+} BREAK_REASON;
+
+typedef struct _Watchpoint {
+    uint16_t begin;
+    uint16_t end;
+    uint8_t type;
+} Watchpoint;
+
+typedef struct _TraceRecord {
+    Registers regs;
+    uint8_t opcode;
+    uint64_t cycle;
+} TraceRecord;
+
+/* Breakpoints and watchpoints cost nothing until one is set: arming the
+ * debugger takes the direct pointers away from the code pages with a
+ * breakpoint (all of them while tracing) and from the watched data pages,
+ * so only those accesses reach the hooks below. */
+typedef struct _Debugger {
+    Memory *mem;
+    const Ppu *ppu;
+
+    uint16_t breakpoints[DEBUGGER_MAX_BREAKPOINTS];
+    uint8_t breakpointCount;
+    Watchpoint watchpoints[DEBUGGER_MAX_WATCHPOINTS];
+    uint8_t watchpointCount;
+
+    /* The last instructions fetched through DebuggerFetch, oldest first from
+     * traceNext. */
+    TraceRecord trace[DEBUGGER_TRACE_SIZE];
+    uint32_t traceNext;
+    uint32_t traceCount;
+
+    /* Every instruction in nestest.log format when set. */
+    FILE *traceOut;
+
+    /* Set on a hit along with *stop, which ends the frame being run. */
+    uint8_t hit;
+    BREAK_REASON reason;
+    uint16_t hitAddr;
+    uint8_t *stop;
+
+    /* Lets the instruction at a breakpoint run once after resuming. */
+    uint8_t resuming;
+} Debugger;
+
+/* A hit raises ppu->frameComplete to end the frame being run. */
+void DebuggerInit(Debugger *dbg, Memory *mem, Ppu *ppu);
+uint8_t DebuggerAddBreakpoint(Debugger *dbg, uint16_t pc);
+uint8_t DebuggerAddWatchpoint(Debugger *dbg, uint16_t begin, uint16_t end, uint8_t type);
+void DebuggerSetTrace(Debugger *dbg, FILE *out);
+void DebuggerClear(Debugger *dbg);
+void DebuggerResume(Debugger *dbg);
+void DebuggerReport(const Debugger *dbg, const Cpu *cpu, FILE *out);
+
+/* Whether accesses of type to the page must take the memory slow path. */
+uint8_t DebuggerWatchesPage(const Debugger *dbg, uint8_t page, uint8_t type);
+/* Whether opcode fetches from the page must reach DebuggerFetch. */
+uint8_t DebuggerBreaksOnPage(const Debugger *dbg, uint8_t page);
+
+/* Called for opcode fetches from the pages above. Returns 1 to stop before
+ * the instruction runs. */
+uint8_t DebuggerFetch(Debugger *dbg, const Cpu *cpu, uint8_t opcode);
+void DebuggerAccess(Debugger *dbg, uint16_t addr, uint8_t type);
+
+#endif
@@ -0,0 +1,119 @@
+#include "disasm.h"
+
+static uint16_t PeekWord(const Memory *mem, uint16_t lo, uint16_t hi) {
+    return PeekCpuByte(mem, lo) | (uint16_t)PeekCpuByte(mem, hi) << 8;
+}
+
+/* Writes "MNE operand" and, with regs, where the operand really points. */
+static void FormatOperand(const Memory *mem, const Registers *regs, uint16_t pc,
+                          const InstructionInfo *info, char *out, size_t size) {
+    uint8_t op1 = PeekCpuByte(mem, pc + 1);
+    uint16_t word = PeekWord(mem, pc + 1, pc + 2);
+    const char *mne = info->mnemonic;
+
+    switch (info->adrMode) {
+        case ACCUMULATOR:
+            snprintf(out, size, "%s A", mne);
+            break;
+        case IMMEDIATE:
+            snprintf(out, size, "%s #$%02X", mne, op1);
+            break;
+        case RELATIVE:
+            snprintf(out, size, "%s $%04X", mne, (uint16_t)(pc + 2 + (int8_t)op1));
+            break;
+        case ZEROPAGE:
+            if (regs)
+                snprintf(out, size, "%s $%02X = %02X", mne, op1, PeekCpuByte(mem, op1));
+            else
+                snprintf(out, size, "%s $%02X", mne, op1);
+            break;
+        case ZEROPAGE_X:
+        case ZEROPAGE_Y: {
+            char index = info->adrMode == ZEROPAGE_X ? 'X' : 'Y';
+
+            if (regs) {
+                uint8_t addr = op1 + (index == 'X' ? regs->x : regs->y);
+                snprintf(out, size, "%s $%02X,%c @ %02X = %02X", mne, op1, index, addr,
+                         PeekCpuByte(mem, addr));
+            } else {
+                snprintf(out, size, "%s $%02X,%c", mne, op1, index);
+            }
+            break;
+        }
+        case ABSOLUTE:
+            /* Jumps don't access their operand. */
+            if (regs && mne[0] != 'J')
+                snprintf(out, size, "%s $%04X = %02X", mne, word, PeekCpuByte(mem, word));
+            else
+                snprintf(out, size, "%s $%04X", mne, word);
+            break;
+        case ABSOLUTE_X:
+        case ABSOLUTE_Y: {
+            char index = info->adrMode == ABSOLUTE_X ? 'X' : 'Y';
+
+            if (regs) {
+                uint16_t addr = word + (index == 'X' ? regs->x : regs->y);
+                snprintf(out, size, "%s $%04X,%c @ %04X = %02X", mne, word, index, addr,
+                         PeekCpuByte(mem, addr));
+            } else {
+                snprintf(out, size, "%s $%04X,%c", mne, word, index);
+            }
+            break;
+        }
+        case INDIRECT:
+            if (regs)
+                snprintf(out, size, "%s ($%04X) = %04X", mne, word, PeekWord(mem, word, word + 1));
+            else
+                snprintf(out, size, "%s ($%04X)", mne, word);
+            break;
+        case INDEXED_INDIRECT:
+            if (regs) {
+                uint8_t zp = op1 + regs->x;
+                uint16_t addr = PeekWord(mem, zp, (uint8_t)(zp + 1));
+                snprintf(out, size, "%s ($%02X,X) @ %02X = %04X = %02X", mne, op1, zp, addr,
+                         PeekCpuByte(mem, addr));
+            } else {
+                snprintf(out, size, "%s ($%02X,X)", mne, op1);
+            }
+            break;
+        case INDIRECT_INDEXED:
+            if (regs) {
+                uint16_t base = PeekWord(mem, op1, (uint8_t)(op1 + 1));
+                uint16_t addr = base + regs->y;
+                snprintf(out, size, "%s ($%02X),Y = %04X @ %04X = %02X", mne, op1, base, addr,
+                         PeekCpuByte(mem, addr));
+            } else {
+                snprintf(out, size, "%s ($%02X),Y", mne, op1);
+            }
+            break;
+        default:
+            snprintf(out, size, "%s", mne);
+    }
+}
+
+uint8_t DisasmInstruction(const Memory *mem, const Registers *regs, uint16_t pc,
+                          char *out, size_t size) {
+    uint8_t opcode = PeekCpuByte(mem, pc);
+    const InstructionInfo *info = CpuInstructionInfo(opcode);
+    uint8_t length = CpuInstructionLength(opcode);
+    char bytes[12] = "";
+    char operand[DISASM_LINE_SIZE];
+
+    for (uint8_t i = 0; i < length; ++i)
+        snprintf(bytes + i * 3, sizeof(bytes) - i * 3, "%02X ", PeekCpuByte(mem, pc + i));
+
+    FormatOperand(mem, regs, pc, info, operand, sizeof(operand));
+    snprintf(out, size, "%04X  %-9s %s", pc, bytes, operand);
+
+    return length;
+}
+
+void DisasmRange(const Memory *mem, uint16_t begin, uint16_t end, FILE *out) {
+    char line[DISASM_LINE_SIZE];
+    uint32_t pc = begin;
+
+    while (pc <= end) {
+        pc += DisasmInstruction(mem, NULL, pc, line, sizeof(line));
+        fprintf(out, "%s\n", line);
+    }
+}
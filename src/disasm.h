@@ -0,0 +1,23 @@
+#ifndef DISASM_H_
+#define DISASM_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cpu.h"
+#include "memory.h"
+
+/* Enough for the longest nestest.log style line. */
+#define DISASM_LINE_SIZE 64
+
+/* Formats the instruction at pc into out and returns its length in bytes.
+ * With regs, operands also show the effective address and the value there,
+ * as in nestest.log. Memory is only peeked. */
+uint8_t DisasmInstruction(const Memory *mem, const Registers *regs, uint16_t pc,
+                          char *out, size_t size);
+
+/* One line per instruction starting in [begin, end]. */
+void DisasmRange(const Memory *mem, uint16_t begin, uint16_t end, FILE *out);
+
+#endif
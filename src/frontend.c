@@ -0,0 +1,488 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frontend.h"
+
+static const char *gPhaseNames[FRAME_PHASE_NUM] = {"emulate", "present"};
+
+static const char *gDefaultFonts[] = {
+    "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+    "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+    "/usr/share/fonts/dejavu/DejaVuSansMono.ttf",
+    "/usr/local/share/fonts/DejaVuSansMono.ttf"
+};
+
+uint8_t FrontendInit(Frontend *fe, const char *romPath) {
+    fe->paused = 0;
+    fe->running = 1;
+    fe->headless = 1;
+
+    fe->fastForward = 0;
+    fe->frameSkip = DEFAULT_FRAME_SKIP;
+
+    fe->inputSource = INPUT_KEYBOARD;
+    fe->movie.file = NULL;
+    fe->movie.frames = NULL;
+    fe->record.file = NULL;
+    fe->record.frames = NULL;
+    fe->hashLog = NULL;
+    fe->videoDump.fd = -1;
+    fe->perfOn = 0;
+    fe->perfLog = NULL;
+    fe->perfFrames = 0;
+    memset(fe->perfTotal, 0, sizeof(fe->perfTotal));
+    memset(&fe->perfSamples, 0, sizeof(fe->perfSamples));
+    fe->perfCpuNs = 0;
+    fe->perfTotalCpuNs = 0;
+    fe->hud.font = NULL;
+    fe->hudShown = 0;
+    PacerInit(&fe->pacer, NTSC_FRAME_RATE);
+
+    return NesInitFile(&fe->nes, romPath);
+}
+
+static void KeyboardButtons(uint8_t buttons[CONTROLLER_NUM]) {
+    const uint8_t *keys = SDL_GetKeyboardState(NULL);
+
+    buttons[0] = (keys[SDL_SCANCODE_X]      ? BUTTON_A      : 0) |
+                 (keys[SDL_SCANCODE_Z]      ? BUTTON_B      : 0) |
+                 (keys[SDL_SCANCODE_RSHIFT] ? BUTTON_SELECT : 0) |
+                 (keys[SDL_SCANCODE_RETURN] ? BUTTON_START  : 0) |
+                 (keys[SDL_SCANCODE_UP]     ? BUTTON_UP     : 0) |
+                 (keys[SDL_SCANCODE_DOWN]   ? BUTTON_DOWN   : 0) |
+                 (keys[SDL_SCANCODE_LEFT]   ? BUTTON_LEFT   : 0) |
+                 (keys[SDL_SCANCODE_RIGHT]  ? BUTTON_RIGHT  : 0);
+    buttons[1] = 0;
+}
+
+/* Latches this frame's buttons. Returns 0 when a replayed movie is over. */
+static uint8_t FrontendPollInput(Frontend *fe) {
+    uint8_t buttons[CONTROLLER_NUM] = {0};
+
+    if (fe->inputSource == INPUT_MOVIE) {
+        if (!MovieNextFrame(&fe->movie, buttons))
+            return 0;
+    } else if (!fe->headless) {
+        KeyboardButtons(buttons);
+    }
+
+    if (fe->record.recording)
+        MovieRecordFrame(&fe->record, buttons);
+
+    NesSetButtons(&fe->nes, buttons);
+    return 1;
+}
+
+/* Charges the counts since the last mark to phase of this frame. */
+static void PerfPhaseDone(Frontend *fe, FRAME_PHASE phase) {
+    PerfSample now;
+
+    if (!fe->perfOn)
+        return;
+
+    PerfCountersRead(&fe->perf, &now);
+    PerfSampleAdd(&fe->perfFrame[phase], &fe->perfMark, &now);
+    fe->perfMark = now;
+}
+
+/* The split of the emulate phase, from the samples taken this frame. */
+static void PerfSplitFrame(Frontend *fe) {
+    const StepSamples *samples = &fe->nes.samples;
+    uint64_t emulateNs = fe->perfFrame[FRAME_EMULATE].nanoseconds;
+    uint64_t cpu = samples->cpuNs - fe->perfSamples.cpuNs;
+    uint64_t ppu = samples->ppuNs - fe->perfSamples.ppuNs;
+
+    fe->perfCpuNs = cpu + ppu ? emulateNs * cpu / (cpu + ppu) : emulateNs;
+    fe->perfTotalCpuNs += fe->perfCpuNs;
+    fe->perfSamples = *samples;
+}
+
+static void PerfFrameDone(Frontend *fe) {
+    if (!fe->perfOn)
+        return;
+
+    PerfSplitFrame(fe);
+
+    if (fe->perfLog)
+        fprintf(fe->perfLog, "%lu", fe->perfFrames);
+
+    for (uint8_t i = 0; i < FRAME_PHASE_NUM; ++i) {
+        const PerfSample *frame = &fe->perfFrame[i];
+        PerfSample zero = {{0}, 0};
+
+        PerfSampleAdd(&fe->perfTotal[i], &zero, frame);
+
+        if (!fe->perfLog)
+            continue;
+
+        fprintf(fe->perfLog, "\t%lu", frame->nanoseconds);
+        for (uint8_t c = 0; c < PERF_COUNTER_NUM; ++c) {
+            if (fe->perf.fds[c] >= 0)
+                fprintf(fe->perfLog, "\t%lu", frame->counts[c]);
+            else
+                fputs("\t-", fe->perfLog);
+        }
+    }
+
+    if (fe->perfLog)
+        fprintf(fe->perfLog, "\t%lu\t%lu\n", fe->perfCpuNs,
+                fe->perfFrame[FRAME_EMULATE].nanoseconds - fe->perfCpuNs);
+
+    ++fe->perfFrames;
+}
+
+/* NesRunFrame plus the hash log and video dump. */
+static uint8_t FrontendRunFrame(Frontend *fe) {
+    const Cpu *cpu = &fe->nes.cpu;
+    uint8_t jammed = cpu->jammed;
+
+    if (fe->perfOn) {
+        memset(fe->perfFrame, 0, sizeof(fe->perfFrame));
+        PerfCountersRead(&fe->perf, &fe->perfMark);
+    }
+
+    if (!NesRunFrame(&fe->nes))
+        return 0;
+
+    if (cpu->jammed && !jammed)
+        fprintf(stderr, "CPU jammed on opcode %02x at $%04x\n",
+                PeekCpuByte(&fe->nes.mem, cpu->regs.pc), cpu->regs.pc);
+
+    PerfPhaseDone(fe, FRAME_EMULATE);
+
+    if (fe->hashLog)
+        fprintf(fe->hashLog, "%08x\n", NesFrameHash(&fe->nes));
+
+    if (fe->videoDump.fd >= 0)
+        VideoDumpFrame(&fe->videoDump, fe->nes.ppu.frameBuffer, fe->nes.ppu.emphasis);
+
+    PerfPhaseDone(fe, FRAME_PRESENT);
+    return 1;
+}
+
+static double Seconds(void) {
+    return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
+static void SetFastForward(Frontend *fe, uint8_t enabled, uint64_t *ffFrames, double *ffStart) {
+    double now = Seconds();
+
+    if (fe->fastForward && !enabled && now > *ffStart) {
+        double speed = *ffFrames / (now - *ffStart) / NTSC_FRAME_RATE;
+        printf("Fast-forward: %lu frames at %.2fx speed\n", *ffFrames, speed);
+    }
+
+    fe->fastForward = enabled;
+    *ffFrames = 0;
+    *ffStart = now;
+}
+
+void FrontendEmulate(Frontend *fe) {
+    Nes *nes = &fe->nes;
+
+    PacerReset(&fe->pacer);
+    double statsStart = Seconds();
+    uint64_t statsFrames = 0;
+    uint64_t ffFrames = 0;
+    double ffStart = statsStart;
+    PerfSample statsMark = fe->perfTotal[FRAME_EMULATE];
+    uint64_t statsCpuMark = fe->perfTotalCpuNs;
+
+    while (fe->running) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                fe->running = 0;
+            } else if (event.type == SDL_KEYDOWN) {
+                if (event.key.keysym.sym == SDLK_p) {
+                    fe->paused = !fe->paused;
+                    if (!fe->paused)
+                        DebuggerResume(&nes->debugger);
+                } else if (event.key.keysym.sym == SDLK_f) {
+                    SetFastForward(fe, !fe->fastForward, &ffFrames, &ffStart);
+                } else if (event.key.keysym.sym == SDLK_h && fe->hud.font) {
+                    fe->hudShown = !fe->hudShown;
+                }
+            }
+        }
+
+        if (fe->paused) {
+            SDL_Delay(16);
+            PacerReset(&fe->pacer);
+            continue;
+        }
+
+        if (!nes->midFrame && !FrontendPollInput(fe)) {
+            fe->running = 0;
+            break;
+        }
+
+        uint8_t present = !fe->fastForward || nes->ppu.frame % fe->frameSkip == 0;
+        /* The video dump and the hash log want every frame. */
+        nes->ppu.renderPixels = present || fe->videoDump.fd >= 0 || fe->hashLog;
+
+        if (!FrontendRunFrame(fe)) {
+            DebuggerReport(&nes->debugger, &nes->cpu, stderr);
+            fprintf(stderr, "Paused, P resumes\n");
+            fe->paused = 1;
+            continue;
+        }
+
+        ++statsFrames;
+        ++ffFrames;
+
+        if (present)
+            NesWindowPresent(&fe->nesWindow, nes, fe->hudShown ? &fe->hud : NULL);
+
+        PerfPhaseDone(fe, FRAME_PRESENT);
+        PerfFrameDone(fe);
+
+        if (fe->hudShown)
+            HudAddFrame(&fe->hud, fe->perfCpuNs,
+                        fe->perfFrame[FRAME_EMULATE].nanoseconds - fe->perfCpuNs,
+                        fe->perfFrame[FRAME_PRESENT].nanoseconds);
+
+        double now = Seconds();
+        if (now - statsStart >= 1.0) {
+            char title[256];
+            double fps = statsFrames / (now - statsStart);
+            int32_t len = snprintf(title, sizeof(title), "NES - %.0f fps (%.0f%%)%s",
+                                   fps, fps / NTSC_FRAME_RATE * 100.0, fe->fastForward ? " >>" : "");
+
+            /* Emulation cost per frame over the last second, the split
+             * first so a long line of counters can't cut it off. */
+            if (fe->perfOn) {
+                PerfSample interval = {{0}, 0};
+                double cpuUs = (double)(fe->perfTotalCpuNs - statsCpuMark) / statsFrames / 1000;
+
+                PerfSampleAdd(&interval, &statsMark, &fe->perfTotal[FRAME_EMULATE]);
+                statsMark = fe->perfTotal[FRAME_EMULATE];
+                statsCpuMark = fe->perfTotalCpuNs;
+
+                len += snprintf(title + len, sizeof(title) - len,
+                                " | CPU %.1f us, PPU %.1f us | emulate ", cpuUs,
+                                (double)interval.nanoseconds / statsFrames / 1000 - cpuUs);
+                if ((size_t)len < sizeof(title))
+                    PerfCountersFormat(&fe->perf, &interval, statsFrames, title + len,
+                                       sizeof(title) - len);
+            }
+
+            SDL_SetWindowTitle(fe->nesWindow.window, title);
+
+            if (fe->hudShown)
+                HudUpdate(&fe->hud, fps);
+
+            statsStart = now;
+            statsFrames = 0;
+        }
+
+        if (fe->fastForward) {
+            PacerReset(&fe->pacer);
+            continue;
+        }
+
+        PacerWait(&fe->pacer);
+    }
+
+    SetFastForward(fe, 0, &ffFrames, &ffStart);
+}
+
+/* Runs unpaced and without a window until the movie or maxFrames runs out. */
+void FrontendRunHeadless(Frontend *fe, uint64_t maxFrames) {
+    Nes *nes = &fe->nes;
+    uint64_t frames = 0;
+    double start = Seconds();
+
+    while (frames < maxFrames && FrontendPollInput(fe)) {
+        if (!FrontendRunFrame(fe)) {
+            DebuggerReport(&nes->debugger, &nes->cpu, stderr);
+            break;
+        }
+
+        PerfFrameDone(fe);
+        ++frames;
+    }
+
+    double elapsed = Seconds() - start;
+
+    printf("Ran %lu frames in %.3fs (%.1f fps), state hash %08x\n",
+           frames, elapsed, elapsed > 0 ? frames / elapsed : 0, NesStateHash(nes));
+}
+
+void FrontendDestroy(Frontend *fe) {
+    if (fe->hud.font)
+        HudDestroy(&fe->hud);
+
+    if (!fe->headless)
+        NesWindowDestroy(&fe->nesWindow);
+
+    MovieClose(&fe->movie);
+    MovieClose(&fe->record);
+
+    if (fe->hashLog) {
+        fprintf(fe->hashLog, "state %08x\n", NesStateHash(&fe->nes));
+        fclose(fe->hashLog);
+    }
+
+    VideoDumpClose(&fe->videoDump);
+    NesDestroy(&fe->nes);
+
+    if (fe->perfLog)
+        fclose(fe->perfLog);
+    if (fe->perfOn)
+        PerfCountersClose(&fe->perf);
+}
+
+uint8_t FrontendOpenPerf(Frontend *fe, const char *logPath) {
+    if (logPath) {
+        fe->perfLog = fopen(logPath, "w");
+        if (!fe->perfLog) {
+            fprintf(stderr, "Couldn't create perf log %s\n", logPath);
+            return 0;
+        }
+    }
+
+    PerfCountersOpen(&fe->perf);
+    fe->perfOn = 1;
+
+    if (fe->perfLog) {
+        fputs("# frame", fe->perfLog);
+        for (uint8_t i = 0; i < FRAME_PHASE_NUM; ++i) {
+            fprintf(fe->perfLog, "\t%s.ns", gPhaseNames[i]);
+            for (uint8_t c = 0; c < PERF_COUNTER_NUM; ++c)
+                fprintf(fe->perfLog, "\t%s.%s", gPhaseNames[i], PerfCounterName(c));
+        }
+        fputs("\tcpu.ns\tppu.ns\n", fe->perfLog);
+    }
+
+    NesSetSampling(&fe->nes, 1);
+    return 1;
+}
+
+void FrontendReportPerf(const Frontend *fe, FILE *out) {
+    char line[256];
+
+    fprintf(out, "Per frame over %lu frames%s:\n", fe->perfFrames,
+            fe->perf.open ? "" : " (wall clock only)");
+
+    for (uint8_t i = 0; i < FRAME_PHASE_NUM; ++i) {
+        PerfCountersFormat(&fe->perf, &fe->perfTotal[i], fe->perfFrames, line, sizeof(line));
+        fprintf(out, "  %-8s %s\n", gPhaseNames[i], line);
+
+        /* Only time is known for the two halves of emulation. */
+        if (i == FRAME_EMULATE && fe->perfFrames) {
+            uint64_t emulateNs = fe->perfTotal[FRAME_EMULATE].nanoseconds;
+
+            fprintf(out, "    %-6s %.1f us\n", "cpu",
+                    (double)fe->perfTotalCpuNs / fe->perfFrames / 1000);
+            fprintf(out, "    %-6s %.1f us\n", "ppu",
+                    (double)(emulateNs - fe->perfTotalCpuNs) / fe->perfFrames / 1000);
+        }
+    }
+}
+
+uint8_t FrontendOpenHud(Frontend *fe, const char *fontPath) {
+    uint32_t height = fe->nesWindow.scaler.height;
+
+    if (fontPath) {
+        if (!HudInit(&fe->hud, fontPath, height))
+            return 0;
+    } else {
+        uint8_t found = 0;
+
+        for (uint8_t i = 0; i < sizeof(gDefaultFonts) / sizeof(gDefaultFonts[0]) && !found; ++i) {
+            FILE *file = fopen(gDefaultFonts[i], "rb");
+
+            if (file) {
+                fclose(file);
+                found = HudInit(&fe->hud, gDefaultFonts[i], height);
+            }
+        }
+
+        if (!found) {
+            fprintf(stderr, "No font for the HUD, give one with --hud-font\n");
+            return 0;
+        }
+    }
+
+    /* The HUD's times per frame come from the perf phases. */
+    if (!fe->perfOn && !FrontendOpenPerf(fe, NULL))
+        return 0;
+
+    fe->hudShown = 1;
+    return 1;
+}
+
+void NesWindowInit(NesWindow *window, SCALE_FILTER filter) {
+    SDL_RendererInfo info;
+
+    SDL_Init(SDL_INIT_VIDEO);
+
+    window->scale = 4;
+    window->width = 256 * window->scale;
+    window->height = 240 * window->scale;
+
+    window->window = SDL_CreateWindow(
+            "NES",
+            SDL_WINDOWPOS_CENTERED,
+            SDL_WINDOWPOS_CENTERED,
+            window->width,
+            window->height,
+            0
+    );
+
+    window->renderer = SDL_CreateRenderer(
+            window->window,
+            -1,
+            SDL_RENDERER_ACCELERATED
+    );
+
+    /* No GPU to stretch the texture, so do it here with SIMD instead of
+     * leaving it to SDL's blitter. */
+    if (filter == SCALE_NONE && SDL_GetRendererInfo(window->renderer, &info) == 0 &&
+        (info.flags & SDL_RENDERER_SOFTWARE))
+        filter = SCALE_NEAREST;
+
+    /* Scale3x only does 3x, SDL stretches the rest of the way. */
+    uint32_t factor = window->scale;
+    if (filter == SCALE_NONE)
+        factor = 1;
+    else if (filter == SCALE_3X)
+        factor = 3;
+
+    if (!ScalerInit(&window->scaler, filter, factor, SCALE_KERNEL_AUTO))
+        ScalerInit(&window->scaler, SCALE_NONE, 1, SCALE_KERNEL_AUTO);
+
+    window->texture = SDL_CreateTexture(
+            window->renderer,
+            SDL_PIXELFORMAT_RGBA32,
+            SDL_TEXTUREACCESS_STREAMING,
+            window->scaler.width,
+            window->scaler.height
+    );
+}
+
+void NesWindowPresent(NesWindow *window, const Nes *nes, const Hud *hud) {
+    NesFrameRgba(nes, window->pixels);
+
+    const uint32_t *pixels = ScalerRun(&window->scaler, window->pixels);
+
+    /* Either window->pixels or the scaler's own buffer, both ours to draw
+     * on until the next frame. */
+    if (hud)
+        HudDraw(hud, (uint32_t *)pixels, window->scaler.width, window->scaler.height);
+
+    SDL_UpdateTexture(window->texture, NULL, pixels, window->scaler.width * sizeof(uint32_t));
+    SDL_RenderClear(window->renderer);
+    SDL_RenderCopy(window->renderer, window->texture, NULL, NULL);
+    SDL_RenderPresent(window->renderer);
+}
+
+void NesWindowDestroy(NesWindow *window) {
+    ScalerDestroy(&window->scaler);
+    SDL_DestroyTexture(window->texture);
+    SDL_DestroyRenderer(window->renderer);
+    SDL_DestroyWindow(window->window);
+    SDL_Quit();
+}
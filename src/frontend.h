@@ -0,0 +1,119 @@
+#ifndef FRONTEND_H_
+#define FRONTEND_H_
+
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+#include "nes.h"
+#include "movie.h"
+#include "videodump.h"
+#include "scaler.h"
+#include "perfcounters.h"
+#include "hud.h"
+#include "pacer.h"
+
+#define DEFAULT_FRAME_SKIP 4
+
+typedef struct _NesWindow {
+    uint32_t scale;
+    uint32_t width;
+    uint32_t height;
+
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    SDL_Texture *texture;
+
+    /* Upscales on the CPU before the texture upload. Software renderers
+     * get SCALE_NEAREST unless another filter was asked for. */
+    Scaler scaler;
+
+    uint32_t pixels[PPU_WIDTH * PPU_HEIGHT];
+} NesWindow;
+
+typedef enum _INPUT_SOURCE {
+    INPUT_KEYBOARD,
+    INPUT_MOVIE
+} INPUT_SOURCE;
+
+/* Where a frame's time goes: stepping the machine, then hashing, dumping
+ * and drawing it. The CPU and the PPU take turns every CPU cycle, too
+ * often to read counters in between, so they are one phase whose time is
+ * split by sampling, see perfCpuNs. */
+typedef enum _FRAME_PHASE {
+    FRAME_EMULATE,
+    FRAME_PRESENT,
+    FRAME_PHASE_NUM
+} FRAME_PHASE;
+
+/* The SDL player around a Nes: window, pacing, movies and dumps. */
+typedef struct _Frontend {
+    Nes nes;
+    NesWindow nesWindow;
+
+    uint8_t paused;
+    uint8_t running;
+    uint8_t headless;
+
+    /* Buttons are sampled once per frame from inputSource, and appended to
+     * record when it's open. */
+    INPUT_SOURCE inputSource;
+    Movie movie;
+    Movie record;
+
+    /* One frame hash per line when open. */
+    FILE *hashLog;
+
+    /* Every completed frame is streamed here when videoDump.fd >= 0. */
+    VideoDump videoDump;
+
+    /* Holds windowed runs to NTSC_FRAME_RATE unless told otherwise. */
+    Pacer pacer;
+
+    /* Run unpaced and only render every frameSkip-th frame. */
+    uint8_t fastForward;
+    uint32_t frameSkip;
+
+    /* Host counters per frame phase when perfOn, see FrontendOpenPerf. */
+    uint8_t perfOn;
+    PerfCounters perf;
+    PerfSample perfMark;
+    PerfSample perfFrame[FRAME_PHASE_NUM];
+    PerfSample perfTotal[FRAME_PHASE_NUM];
+    uint64_t perfFrames;
+    /* The CPU's share of the emulate phase, the way nes's step samples split
+     * it (see NesSetSampling); the PPU has the rest. perfSamples is
+     * nes->samples at the last frame. */
+    StepSamples perfSamples;
+    uint64_t perfCpuNs;
+    uint64_t perfTotalCpuNs;
+    /* One line per frame with each phase's counters when open. */
+    FILE *perfLog;
+
+    /* Drawn over the picture while hudShown, H toggles it. hud.font is
+     * NULL without FrontendOpenHud. */
+    Hud hud;
+    uint8_t hudShown;
+} Frontend;
+
+uint8_t FrontendInit(Frontend *fe, const char *romPath);
+void FrontendEmulate(Frontend *fe);
+void FrontendRunHeadless(Frontend *fe, uint64_t maxFrames);
+void FrontendDestroy(Frontend *fe);
+
+/* Counts host instructions, cycles and cache and branch misses per frame
+ * phase, or only times them when perf_event_open can't, and turns on the
+ * step samples. logPath may be NULL. Returns 0 when the log can't be
+ * created. */
+uint8_t FrontendOpenPerf(Frontend *fe, const char *logPath);
+/* Per-frame averages of each phase so far. */
+void FrontendReportPerf(const Frontend *fe, FILE *out);
+/* Shows the HUD, see hud.h, after NesWindowInit. fontPath NULL looks for
+ * DejaVu Sans Mono. Returns 0 when no font can be loaded. */
+uint8_t FrontendOpenHud(Frontend *fe, const char *fontPath);
+
+void NesWindowInit(NesWindow *window, SCALE_FILTER filter);
+/* hud may be NULL. */
+void NesWindowPresent(NesWindow *window, const Nes *nes, const Hud *hud);
+void NesWindowDestroy(NesWindow *window);
+
+#endif
@@ -0,0 +1,175 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "hash.h"
+#include "cpu.h"
+#include "ppu.h"
+#include "memory.h"
+#include "cartridge.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define HAVE_CRC32_INSTRUCTION 1
+#endif
+
+#define CRC32C_POLY 0x82F63B78
+#define FRAME_LANES 4
+#define FRAME_SIZE  (PPU_WIDTH * PPU_HEIGHT)
+#define LANE_SIZE   (FRAME_SIZE / FRAME_LANES)
+
+typedef uint32_t (*Crc32cFn)(uint32_t crc, const uint8_t *data, size_t size);
+typedef void (*LanesFn)(const uint8_t *frame, uint32_t crcs[FRAME_LANES]);
+
+static uint32_t gCrcTable[256];
+
+static uint32_t Crc32cSoftware(uint32_t crc, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+        crc = gCrcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+static void LanesSoftware(const uint8_t *frame, uint32_t crcs[FRAME_LANES]) {
+    for (uint8_t i = 0; i < FRAME_LANES; ++i)
+        crcs[i] = Crc32cSoftware(crcs[i], frame + i * LANE_SIZE, LANE_SIZE);
+}
+
+#ifdef HAVE_CRC32_INSTRUCTION
+__attribute__((target("sse4.2")))
+static uint32_t Crc32cHardware(uint32_t crc, const uint8_t *data, size_t size) {
+    uint64_t crc64 = crc;
+
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+
+    crc = (uint32_t)crc64;
+    for (; size; --size, ++data)
+        crc = _mm_crc32_u8(crc, *data);
+
+    return crc;
+}
+
+/* crc32 has a 3 cycle latency but issues every cycle, so keep 4 chains in flight. */
+__attribute__((target("sse4.2")))
+static void LanesHardware(const uint8_t *frame, uint32_t crcs[FRAME_LANES]) {
+    uint64_t c0 = crcs[0], c1 = crcs[1], c2 = crcs[2], c3 = crcs[3];
+
+    for (size_t i = 0; i < LANE_SIZE; i += 8) {
+        uint64_t w0, w1, w2, w3;
+
+        memcpy(&w0, frame + i, 8);
+        memcpy(&w1, frame + LANE_SIZE + i, 8);
+        memcpy(&w2, frame + 2 * LANE_SIZE + i, 8);
+        memcpy(&w3, frame + 3 * LANE_SIZE + i, 8);
+
+        c0 = _mm_crc32_u64(c0, w0);
+        c1 = _mm_crc32_u64(c1, w1);
+        c2 = _mm_crc32_u64(c2, w2);
+        c3 = _mm_crc32_u64(c3, w3);
+    }
+
+    crcs[0] = (uint32_t)c0;
+    crcs[1] = (uint32_t)c1;
+    crcs[2] = (uint32_t)c2;
+    crcs[3] = (uint32_t)c3;
+}
+#endif
+
+static Crc32cFn gCrc32c;
+static LanesFn gLanes;
+static pthread_once_t gHashOnce = PTHREAD_ONCE_INIT;
+
+static void HashInit(void) {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+
+        for (uint8_t bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+
+        gCrcTable[i] = crc;
+    }
+
+    gCrc32c = Crc32cSoftware;
+    gLanes = LanesSoftware;
+
+#ifdef HAVE_CRC32_INSTRUCTION
+    if (__builtin_cpu_supports("sse4.2")) {
+        gCrc32c = Crc32cHardware;
+        gLanes = LanesHardware;
+    }
+#endif
+}
+
+uint32_t Crc32c(uint32_t crc, const void *data, size_t size) {
+    pthread_once(&gHashOnce, HashInit);
+
+    return ~gCrc32c(~crc, data, size);
+}
+
+uint32_t HashFrame(const uint8_t *frameBuffer) {
+    uint32_t crcs[FRAME_LANES];
+    uint8_t bytes[FRAME_LANES * 4];
+
+    pthread_once(&gHashOnce, HashInit);
+
+    for (uint8_t i = 0; i < FRAME_LANES; ++i)
+        crcs[i] = ~(uint32_t)i;
+
+    gLanes(frameBuffer, crcs);
+
+    for (uint8_t i = 0; i < FRAME_LANES; ++i) {
+        bytes[i * 4]     = crcs[i];
+        bytes[i * 4 + 1] = crcs[i] >> 8;
+        bytes[i * 4 + 2] = crcs[i] >> 16;
+        bytes[i * 4 + 3] = crcs[i] >> 24;
+    }
+
+    return Crc32c(0, bytes, sizeof(bytes));
+}
+
+/* Hashes everything that affects future emulation, field by field and in
+ * little-endian order so struct padding and the host never leak in. The
+ * pixels are left to HashFrame: whether they're drawn is up to the
+ * client, see ppu->renderPixels. */
+uint32_t HashState(const Cpu *cpu, const Ppu *ppu, const Memory *mem) {
+    const Registers *regs = &cpu->regs;
+    uint8_t cpuState[] = {
+        regs->pc & 0xFF, regs->pc >> 8, regs->sp, regs->a, regs->x, regs->y, regs->s,
+        cpu->interrupt, cpu->cycles & 0xFF, cpu->cycles >> 8,
+        cpu->currentCycle & 0xFF, cpu->currentCycle >> 8, cpu->jammed
+    };
+    uint8_t ppuState[] = {
+        ppu->scanline & 0xFF, ppu->scanline >> 8, ppu->cycle & 0xFF, ppu->cycle >> 8,
+        ppu->ctrl, ppu->mask, ppu->status, ppu->oamAddr, ppu->v & 0xFF, ppu->v >> 8,
+        ppu->t & 0xFF, ppu->t >> 8, ppu->x, ppu->w, ppu->dataBuffer, ppu->bus
+    };
+    const Controllers *ctrls = &mem->controllers;
+    uint8_t memState[] = {
+        ctrls->pads[0].buttons, ctrls->pads[0].shift, ctrls->pads[1].buttons, ctrls->pads[1].shift,
+        ctrls->strobe, mem->oamDmaPending
+    };
+    uint8_t cycles[8];
+    uint32_t hash;
+
+    for (uint8_t i = 0; i < 8; ++i)
+        cycles[i] = *cpu->totalCycles >> (i * 8);
+
+    hash = Crc32c(0, cpuState, sizeof(cpuState));
+    hash = Crc32c(hash, cycles, sizeof(cycles));
+    hash = Crc32c(hash, mem->cpuRam, CPU_RAM_SIZE);
+    hash = Crc32c(hash, mem->ppuRam, PPU_RAM_SIZE);
+    if (mem->cart->vram)
+        hash = Crc32c(hash, mem->cart->vram, 2 * NAMETABLE_SIZE);
+    hash = Crc32c(hash, mem->cart->prgRam, PRG_RAM_SIZE);
+    /* PPUDATA writes reach CHR whether it's RAM or ROM on the board. */
+    hash = Crc32c(hash, mem->cart->chr, CHR_SIZE);
+    hash = Crc32c(hash, memState, sizeof(memState));
+    hash = Crc32c(hash, mem->paletteRam, PALETTE_RAM_SIZE);
+    hash = Crc32c(hash, ppu->oamMemory, sizeof(ppu->oamMemory));
+    hash = Crc32c(hash, ppuState, sizeof(ppuState));
+
+    return hash;
+}
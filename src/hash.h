@@ -0,0 +1,23 @@
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct _Cpu Cpu;
+typedef struct _Ppu Ppu;
+typedef struct _Memory Memory;
+
+/* CRC32C (Castagnoli), using SSE4.2 when the host has it. */
+uint32_t Crc32c(uint32_t crc, const void *data, size_t size);
+
+/* Hash of a PPU_WIDTH x PPU_HEIGHT index frame. The frame is split into
+ * independent CRC32C lanes so the hardware path isn't bound by the crc32
+ * instruction's latency; the lane CRCs are then hashed together. Every
+ * host gets the same value. */
+uint32_t HashFrame(const uint8_t *frameBuffer);
+
+/* Hash of the whole machine state, for checking that two runs match. */
+uint32_t HashState(const Cpu *cpu, const Ppu *ppu, const Memory *mem);
+
+#endif
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "hud.h"
+
+static const SDL_Color gTextColor = {255, 255, 255, 255};
+
+static uint32_t Rgba(uint8_t r, uint8_t g, uint8_t b) {
+    uint8_t bytes[4] = {r, g, b, 0xFF};
+    uint32_t pixel;
+
+    memcpy(&pixel, bytes, sizeof(pixel));
+    return pixel;
+}
+
+static void RenderLine(Hud *hud, uint8_t line, const char *text) {
+    if (hud->lines[line])
+        SDL_FreeSurface(hud->lines[line]);
+
+    /* Blended surfaces come out as ARGB8888, coverage in the alpha. */
+    hud->lines[line] = TTF_RenderUTF8_Blended(hud->font, text, gTextColor);
+}
+
+uint8_t HudInit(Hud *hud, const char *fontPath, uint32_t height) {
+    char label[32];
+
+    memset(hud, 0, sizeof(Hud));
+
+    if (TTF_Init() != 0) {
+        fprintf(stderr, "Couldn't start SDL_ttf: %s\n", TTF_GetError());
+        return 0;
+    }
+
+    /* About 24 lines of text to the frame. */
+    hud->font = TTF_OpenFont(fontPath, height / 24 > 6 ? height / 24 : 6);
+    if (!hud->font) {
+        fprintf(stderr, "Couldn't open font %s: %s\n", fontPath, TTF_GetError());
+        TTF_Quit();
+        return 0;
+    }
+
+    snprintf(label, sizeof(label), "host ms/frame 0-%u", HUD_BUCKETS * HUD_BUCKET_US / 1000);
+    RenderLine(hud, 0, "-");
+    RenderLine(hud, 1, "-");
+    RenderLine(hud, 2, label);
+    return 1;
+}
+
+void HudDestroy(Hud *hud) {
+    for (uint8_t i = 0; i < HUD_LINES; ++i) {
+        if (hud->lines[i])
+            SDL_FreeSurface(hud->lines[i]);
+        hud->lines[i] = NULL;
+    }
+
+    TTF_CloseFont(hud->font);
+    hud->font = NULL;
+    TTF_Quit();
+}
+
+void HudAddFrame(Hud *hud, uint64_t cpuNs, uint64_t ppuNs, uint64_t presentNs) {
+    hud->cpuNs += cpuNs;
+    hud->ppuNs += ppuNs;
+    hud->presentNs += presentNs;
+    ++hud->frames;
+
+    hud->frameUs[hud->next] = (cpuNs + ppuNs + presentNs) / 1000;
+    hud->next = (hud->next + 1) % HUD_HISTORY;
+    if (hud->filled < HUD_HISTORY)
+        ++hud->filled;
+}
+
+void HudUpdate(Hud *hud, double fps) {
+    char text[96];
+    double frames = hud->frames;
+
+    if (!hud->frames)
+        return;
+
+    snprintf(text, sizeof(text), "%.1f fps  %.0f%% speed", fps, fps / NTSC_FRAME_RATE * 100.0);
+    RenderLine(hud, 0, text);
+
+    /* There's no APU to charge anything to yet. */
+    snprintf(text, sizeof(text), "CPU %.2f  PPU %.2f  APU -  present %.2f ms",
+             hud->cpuNs / frames / 1e6, hud->ppuNs / frames / 1e6, hud->presentNs / frames / 1e6);
+    RenderLine(hud, 1, text);
+
+    hud->frames = 0;
+    hud->cpuNs = 0;
+    hud->ppuNs = 0;
+    hud->presentNs = 0;
+}
+
+/* Halves the brightness of a box, clipped to the frame, for the text and
+ * bars to stand out against any picture. */
+static void Darken(uint32_t *pixels, uint32_t width, uint32_t height,
+                   uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    for (uint32_t row = y; row < y + h && row < height; ++row) {
+        uint32_t *line = pixels + (size_t)row * width;
+
+        for (uint32_t col = x; col < x + w && col < width; ++col)
+            line[col] = (line[col] >> 1 & 0x7F7F7F7F) | Rgba(0, 0, 0);
+    }
+}
+
+static void Fill(uint32_t *pixels, uint32_t width, uint32_t height,
+                 uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color) {
+    for (uint32_t row = y; row < y + h && row < height; ++row) {
+        uint32_t *line = pixels + (size_t)row * width;
+
+        for (uint32_t col = x; col < x + w && col < width; ++col)
+            line[col] = color;
+    }
+}
+
+static void BlendText(uint32_t *pixels, uint32_t width, uint32_t height,
+                      const SDL_Surface *text, uint32_t x, uint32_t y) {
+    for (int32_t row = 0; row < text->h && y + row < height; ++row) {
+        const uint32_t *src = (const uint32_t *)((const uint8_t *)text->pixels + row * text->pitch);
+        uint32_t *dst = pixels + (size_t)(y + row) * width + x;
+
+        for (int32_t col = 0; col < text->w && x + col < width; ++col) {
+            uint32_t alpha = src[col] >> 24;
+            uint8_t bytes[4];
+
+            if (!alpha)
+                continue;
+
+            /* White text, so each channel only moves up toward 255. */
+            memcpy(bytes, &dst[col], 4);
+            for (uint8_t c = 0; c < 3; ++c)
+                bytes[c] += ((255 - bytes[c]) * alpha + 127) / 255;
+            memcpy(&dst[col], bytes, 4);
+        }
+    }
+}
+
+void HudDraw(const Hud *hud, uint32_t *pixels, uint32_t width, uint32_t height) {
+    uint32_t margin = height / 60 + 1;
+    uint32_t textWidth = 0;
+    uint32_t y = margin;
+
+    for (uint8_t i = 0; i < HUD_LINES; ++i) {
+        if (hud->lines[i] && (uint32_t)hud->lines[i]->w > textWidth)
+            textWidth = hud->lines[i]->w;
+    }
+
+    uint32_t barWidth = width / 128 > 2 ? width / 128 : 2;
+    uint32_t barsHeight = height / 8;
+    uint32_t lineHeight = TTF_FontLineSkip(hud->font);
+    uint32_t boxWidth = textWidth > HUD_BUCKETS * barWidth ? textWidth : HUD_BUCKETS * barWidth;
+
+    Darken(pixels, width, height, 0, 0, boxWidth + 2 * margin,
+           HUD_LINES * lineHeight + barsHeight + 3 * margin);
+
+    for (uint8_t i = 0; i < HUD_LINES - 1; ++i, y += lineHeight) {
+        if (hud->lines[i])
+            BlendText(pixels, width, height, hud->lines[i], margin, y);
+    }
+
+    /* The histogram, with the label under it. */
+    uint32_t counts[HUD_BUCKETS] = {0};
+    uint32_t most = 1;
+
+    for (uint32_t i = 0; i < hud->filled; ++i) {
+        uint32_t bucket = hud->frameUs[i] / HUD_BUCKET_US;
+        if (bucket >= HUD_BUCKETS)
+            bucket = HUD_BUCKETS - 1;
+
+        if (++counts[bucket] > most)
+            most = counts[bucket];
+    }
+
+    y += margin;
+    for (uint32_t i = 0; i < HUD_BUCKETS; ++i) {
+        uint32_t bar = (uint64_t)counts[i] * barsHeight / most;
+        uint32_t color = i == HUD_BUCKETS - 1 ? Rgba(224, 64, 64) : Rgba(96, 224, 96);
+
+        Fill(pixels, width, height, margin + i * barWidth, y + barsHeight - bar,
+             barWidth - 1, bar, color);
+    }
+
+    if (hud->lines[HUD_LINES - 1])
+        BlendText(pixels, width, height, hud->lines[HUD_LINES - 1], margin, y + barsHeight);
+}
@@ -0,0 +1,45 @@
+#ifndef HUD_H_
+#define HUD_H_
+
+#include <stdint.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "nes.h"
+
+#define HUD_LINES 3
+/* Frames the histogram counts, and its buckets of host time per frame. */
+#define HUD_HISTORY   240
+#define HUD_BUCKETS   32
+#define HUD_BUCKET_US 250
+
+/* Emulation speed, host time per frame and a histogram of it, drawn over
+ * the frame after it's been scaled. The text only changes at HudUpdate,
+ * so drawing it is a blend of a few cached surfaces. */
+typedef struct _Hud {
+    TTF_Font *font;
+    SDL_Surface *lines[HUD_LINES];
+
+    /* Host microseconds per frame, the last HUD_HISTORY of them. */
+    uint32_t frameUs[HUD_HISTORY];
+    uint32_t next;
+    uint32_t filled;
+
+    /* Since the last HudUpdate. */
+    uint64_t frames;
+    uint64_t cpuNs;
+    uint64_t ppuNs;
+    uint64_t presentNs;
+} Hud;
+
+/* Sizes the text for a height pixels tall frame. Returns 0 when SDL_ttf or
+ * the font can't be loaded. */
+uint8_t HudInit(Hud *hud, const char *fontPath, uint32_t height);
+void HudDestroy(Hud *hud);
+
+/* Adds a frame's host time, see Frontend's perfCpuNs for the split. */
+void HudAddFrame(Hud *hud, uint64_t cpuNs, uint64_t ppuNs, uint64_t presentNs);
+/* Rewrites the text with fps and the averages since the last update. */
+void HudUpdate(Hud *hud, double fps);
+void HudDraw(const Hud *hud, uint32_t *pixels, uint32_t width, uint32_t height);
+
+#endif
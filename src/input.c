@@ -0,0 +1,53 @@
+#include <string.h>
+
+#include "input.h"
+
+#define STROBE_BIT    0x01
+/* The upper bits are open bus, which usually still holds the $40 of the address. */
+#define OPEN_BUS_BITS 0x40
+
+void ControllersInit(Controllers *ctrls) {
+    memset(ctrls, 0, sizeof(Controllers));
+}
+
+void ControllersSetButtons(Controllers *ctrls, const uint8_t buttons[CONTROLLER_NUM]) {
+    for (uint8_t i = 0; i < CONTROLLER_NUM; ++i) {
+        ctrls->pads[i].buttons = buttons[i];
+
+        if (ctrls->strobe)
+            ctrls->pads[i].shift = buttons[i];
+    }
+}
+
+void ControllersWrite(Controllers *ctrls, uint8_t byte) {
+    ctrls->strobe = byte & STROBE_BIT;
+
+    /* While strobe is high the registers keep reloading. */
+    if (ctrls->strobe) {
+        for (uint8_t i = 0; i < CONTROLLER_NUM; ++i)
+            ctrls->pads[i].shift = ctrls->pads[i].buttons;
+    }
+}
+
+uint8_t ControllersRead(Controllers *ctrls, uint8_t port) {
+    Controller *pad = &ctrls->pads[port];
+
+    if (ctrls->strobe)
+        return OPEN_BUS_BITS | (pad->buttons & BUTTON_A);
+
+    uint8_t bit = pad->shift & 1;
+
+    /* After the 8 buttons, official pads keep returning 1. */
+    pad->shift = (pad->shift >> 1) | 0x80;
+
+    return OPEN_BUS_BITS | bit;
+}
+
+uint8_t ControllersPeek(const Controllers *ctrls, uint8_t port) {
+    const Controller *pad = &ctrls->pads[port];
+
+    if (ctrls->strobe)
+        return OPEN_BUS_BITS | (pad->buttons & BUTTON_A);
+
+    return OPEN_BUS_BITS | (pad->shift & 1);
+}
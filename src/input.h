@@ -0,0 +1,39 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stdint.h>
+
+#define CONTROLLER_NUM 2
+
+typedef enum _BUTTON {
+    BUTTON_A      = 0x01,
+    BUTTON_B      = 0x02,
+    BUTTON_SELECT = 0x04,
+    BUTTON_START  = 0x08,
+    BUTTON_UP     = 0x10,
+    BUTTON_DOWN   = 0x20,
+    BUTTON_LEFT   = 0x40,
+    BUTTON_RIGHT  = 0x80
+} BUTTON;
+
+/* Standard controller: a parallel-in, serial-out shift register. */
+typedef struct _Controller {
+    uint8_t buttons;
+    uint8_t shift;
+} Controller;
+
+typedef struct _Controllers {
+    Controller pads[CONTROLLER_NUM];
+    uint8_t strobe;
+} Controllers;
+
+void ControllersInit(Controllers *ctrls);
+void ControllersSetButtons(Controllers *ctrls, const uint8_t buttons[CONTROLLER_NUM]);
+
+/* $4016 writes and $4016/$4017 reads. */
+void ControllersWrite(Controllers *ctrls, uint8_t byte);
+uint8_t ControllersRead(Controllers *ctrls, uint8_t port);
+/* What the next read would return, without shifting. */
+uint8_t ControllersPeek(const Controllers *ctrls, uint8_t port);
+
+#endif
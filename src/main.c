@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frontend.h"
+#include "disasm.h"
+#include "coverage.h"
+#include "profiler.h"
+#include "trace.h"
+#include "cartridge.h"
+
+static uint8_t ParseAddress(const char *text, const char **end, uint16_t *addr) {
+    char *stop;
+
+    if (*text == '$')
+        ++text;
+
+    unsigned long value = strtoul(text, &stop, 16);
+    if (stop == text || value > 0xFFFF)
+        return 0;
+
+    *addr = value;
+    *end = stop;
+    return 1;
+}
+
+static uint8_t AddBreakpoint(Debugger *dbg, const char *spec) {
+    const char *end;
+    uint16_t pc;
+
+    if (!ParseAddress(spec, &end, &pc) || *end) {
+        fprintf(stderr, "Bad breakpoint %s\n", spec);
+        return 0;
+    }
+
+    return DebuggerAddBreakpoint(dbg, pc);
+}
+
+/* ADDR[-END][:r|:w|:rw], reads and writes when no type is given. */
+static uint8_t AddWatchpoint(Debugger *dbg, const char *spec) {
+    const char *end;
+    uint16_t begin, last;
+    uint8_t type = WATCH_READ | WATCH_WRITE;
+
+    if (!ParseAddress(spec, &end, &begin))
+        goto bad;
+
+    last = begin;
+    if (*end == '-' && !ParseAddress(end + 1, &end, &last))
+        goto bad;
+
+    if (*end == ':') {
+        ++end;
+        type = 0;
+
+        for (; *end == 'r' || *end == 'w'; ++end)
+            type |= *end == 'r' ? WATCH_READ : WATCH_WRITE;
+    }
+
+    if (*end || !type)
+        goto bad;
+
+    return DebuggerAddWatchpoint(dbg, begin, last, type);
+
+bad:
+    fprintf(stderr, "Bad watchpoint %s\n", spec);
+    return 0;
+}
+
+static uint8_t ParseFilter(const char *name, SCALE_FILTER *filter) {
+    static const char *names[] = {"none", "nearest", "scanlines", "scale2x", "scale3x"};
+
+    for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (strcmp(name, names[i]) == 0) {
+            *filter = i;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static uint8_t ParseRate(const char *name, double *rate) {
+    char *end;
+
+    if (strcmp(name, "ntsc") == 0) {
+        *rate = NTSC_FRAME_RATE;
+    } else if (strcmp(name, "pal") == 0) {
+        *rate = PAL_FRAME_RATE;
+    } else {
+        *rate = strtod(name, &end);
+        return *end == '\0' && *rate > 0;
+    }
+
+    return 1;
+}
+
+/* The ROM's path with .sav in place of its extension. */
+static void SavePath(const char *romPath, char *path, size_t size) {
+    const char *slash = strrchr(romPath, '/');
+    const char *dot = strrchr(romPath, '.');
+    int32_t stem = dot && (!slash || dot > slash) ? dot - romPath : (int32_t)strlen(romPath);
+
+    snprintf(path, size, "%.*s.sav", stem, romPath);
+}
+
+static uint8_t WriteProfile(const Profiler *prof, const char *path,
+                            uint8_t (*write)(const Profiler *, FILE *)) {
+    FILE *out = fopen(path, "w");
+
+    if (!out) {
+        fprintf(stderr, "Couldn't create profile %s\n", path);
+        return 0;
+    }
+
+    uint8_t written = write(prof, out);
+    fclose(out);
+    return written;
+}
+
+static uint8_t WriteTrace(const Trace *trace, const char *path) {
+    FILE *out = fopen(path, "w");
+
+    if (!out) {
+        fprintf(stderr, "Couldn't create trace %s\n", path);
+        return 0;
+    }
+
+    TraceWriteJson(trace, out);
+    fclose(out);
+    return 1;
+}
+
+static void Usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [--rom FILE] [--fast-forward] [--frame-skip N] [--quiet]\n"
+            "          [--record MOVIE] [--replay MOVIE] [--headless] [--frames N]\n"
+            "          [--hash-log FILE] [--dump-video FILE] [--dump-format y4m|rgba]\n"
+            "          [--dump-drop] [--palette FILE] [--break ADDR]\n"
+            "          [--watch ADDR[-END][:r|w|rw]] [--disasm ADDR[-END]] [--no-idle-skip]\n"
+            "          [--render-thread] [--filter none|nearest|scanlines|scale2x|scale3x]\n"
+            "          [--dump-scale N] [--cdl FILE] [--coverage-image FILE]\n"
+            "          [--profile FILE] [--profile-report FILE] [--labels FILE]\n"
+            "          [--trace FILE] [--perf] [--perf-log FILE]\n"
+            "          [--hud] [--hud-font FILE] [--pace ntsc|pal|HZ]\n"
+            "          [--save FILE] [--no-save]\n"
+            "  P pauses, F toggles fast-forward, H the HUD when it's on.\n"
+            "  Pad 1: arrows, X = A, Z = B, Right Shift = Select, Enter = Start.\n"
+            "  --headless runs without a window, unpaced, until the replayed movie\n"
+            "  or --frames runs out, then prints the state hash. It implies\n"
+            "  --quiet.\n"
+            "  --hash-log writes each frame's hash, one per line, then the final\n"
+            "  state hash.\n"
+            "  --dump-video streams every frame to FILE, which may be a FIFO made\n"
+            "  with mkfifo for piping into an encoder. Y4M is the default format,\n"
+            "  rgba writes bare RGBA frames, 256x240 unless scaled. The dump\n"
+            "  waits for a slow reader unless --dump-drop is given, which drops\n"
+            "  frames instead.\n"
+            "  --palette loads a .pal file with 64 or 512 RGB colors.\n"
+            "  --break and --watch (hex addresses, repeatable) pause emulation\n"
+            "  and print the registers when the PC gets there or the range is\n"
+            "  accessed, for a breakpoint with the last instructions run on its\n"
+            "  page. Headless runs stop instead.\n"
+            "  --disasm prints the code in the range as loaded and exits.\n"
+            "  Without --quiet, every instruction is traced in nestest.log format.\n"
+            "  --no-idle-skip steps through polling loops instead of skipping\n"
+            "  them, which should never change a hash.\n"
+            "  --render-thread draws pixels on a second thread while the CPU\n"
+            "  runs on, which should never change a hash either.\n"
+            "  --filter upscales frames on the CPU before they reach the window.\n"
+            "  Software renderers get nearest unless told otherwise. scale3x\n"
+            "  draws at 3x and leaves the rest of the window to SDL.\n"
+            "  --dump-scale scales dumped frames by N with --filter, or nearest.\n"
+            "  --cdl writes an FCEUX-style code/data log of the PRG bytes run\n"
+            "  and read, --coverage-image a PPM with a pixel per PRG byte.\n"
+            "  --profile writes the CPU cycles spent under each call path as\n"
+            "  folded stacks for flamegraph.pl, --profile-report a table of\n"
+            "  inclusive and self cycles per routine. --labels names routines\n"
+            "  from an ld65 -Ln file or \"ADDR name\" lines.\n"
+            "  --trace writes interrupts, VBlank, sprite-0 hits, PPU register\n"
+            "  accesses and OAM DMA as Chrome trace JSON, for chrome://tracing\n"
+            "  or Perfetto. Only the last 65536 events are kept.\n"
+            "  --perf counts host instructions, cycles, IPC, branch misses and\n"
+            "  L1D and LLC misses per frame with perf_event_open, split into\n"
+            "  emulation and presentation, shows them in the window title and\n"
+            "  prints averages at exit. Without counters it times frames only.\n"
+            "  Emulation time is split further into CPU and PPU by sampling.\n"
+            "  --perf-log also writes every frame's counts, one line each.\n"
+            "  --hud draws fps, speed, host time per frame split into CPU, PPU\n"
+            "  and presentation, and a histogram of it over the picture. It\n"
+            "  needs a TrueType font, DejaVu Sans Mono unless --hud-font.\n"
+            "  --pace holds the window to NTSC (the default) or PAL frame rate,\n"
+            "  or any other in Hz. The core keeps NTSC timing either way.\n"
+            "  --save keeps $6000-$7FFF in FILE. Battery carts use the ROM's\n"
+            "  name with .sav unless --no-save, --headless, --record or\n"
+            "  --replay, so movies and hashes don't depend on an old save.\n",
+            name);
+}
+
+int32_t main(int32_t argc, char **argv) {
+    static Frontend fe;
+    const char *romPath = "test_roms/nestest.nes";
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+    const char *hashLogPath = NULL;
+    const char *dumpPath = NULL;
+    const char *palettePath = NULL;
+    const char *disasmRange = NULL;
+    const char *cdlPath = NULL;
+    const char *coverageImagePath = NULL;
+    const char *profilePath = NULL;
+    const char *profileReportPath = NULL;
+    const char *labelsPath = NULL;
+    const char *tracePath = NULL;
+    const char *perfLogPath = NULL;
+    const char *hudFontPath = NULL;
+    const char *savePath = NULL;
+    char defaultSavePath[4096];
+    const char *breakpoints[DEBUGGER_MAX_BREAKPOINTS];
+    const char *watchpoints[DEBUGGER_MAX_WATCHPOINTS];
+    uint8_t breakpointCount = 0;
+    uint8_t watchpointCount = 0;
+    DUMP_FORMAT dumpFormat = DUMP_Y4M;
+    DUMP_POLICY dumpPolicy = DUMP_BLOCK;
+    SCALE_FILTER filter = SCALE_NONE;
+    uint32_t dumpScale = 1;
+    uint8_t fastForward = 0;
+    uint8_t quiet = 0;
+    uint8_t headless = 0;
+    uint8_t idleSkip = 1;
+    uint8_t renderThread = 0;
+    uint8_t perf = 0;
+    uint8_t hud = 0;
+    uint8_t noSave = 0;
+    double paceRate = NTSC_FRAME_RATE;
+    uint64_t maxFrames = UINT64_MAX;
+    uint32_t frameSkip = DEFAULT_FRAME_SKIP;
+
+    for (int32_t i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+            romPath = argv[++i];
+        } else if (strcmp(argv[i], "--fast-forward") == 0) {
+            fastForward = 1;
+        } else if (strcmp(argv[i], "--frame-skip") == 0 && i + 1 < argc) {
+            frameSkip = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = 1;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--hash-log") == 0 && i + 1 < argc) {
+            hashLogPath = argv[++i];
+        } else if (strcmp(argv[i], "--dump-video") == 0 && i + 1 < argc) {
+            dumpPath = argv[++i];
+        } else if (strcmp(argv[i], "--dump-format") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "y4m") == 0) {
+                dumpFormat = DUMP_Y4M;
+            } else if (strcmp(argv[i], "rgba") == 0) {
+                dumpFormat = DUMP_RGBA;
+            } else {
+                Usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            if (!ParseFilter(argv[++i], &filter)) {
+                Usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--dump-scale") == 0 && i + 1 < argc) {
+            dumpScale = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--cdl") == 0 && i + 1 < argc) {
+            cdlPath = argv[++i];
+        } else if (strcmp(argv[i], "--coverage-image") == 0 && i + 1 < argc) {
+            coverageImagePath = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else if (strcmp(argv[i], "--profile-report") == 0 && i + 1 < argc) {
+            profileReportPath = argv[++i];
+        } else if (strcmp(argv[i], "--labels") == 0 && i + 1 < argc) {
+            labelsPath = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            perf = 1;
+        } else if (strcmp(argv[i], "--perf-log") == 0 && i + 1 < argc) {
+            perf = 1;
+            perfLogPath = argv[++i];
+        } else if (strcmp(argv[i], "--pace") == 0 && i + 1 < argc) {
+            if (!ParseRate(argv[++i], &paceRate)) {
+                Usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--hud") == 0) {
+            hud = 1;
+        } else if (strcmp(argv[i], "--hud-font") == 0 && i + 1 < argc) {
+            hud = 1;
+            hudFontPath = argv[++i];
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (strcmp(argv[i], "--no-save") == 0) {
+            noSave = 1;
+        } else if (strcmp(argv[i], "--break") == 0 && i + 1 < argc &&
+                   breakpointCount < DEBUGGER_MAX_BREAKPOINTS) {
+            breakpoints[breakpointCount++] = argv[++i];
+        } else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc &&
+                   watchpointCount < DEBUGGER_MAX_WATCHPOINTS) {
+            watchpoints[watchpointCount++] = argv[++i];
+        } else if (strcmp(argv[i], "--disasm") == 0 && i + 1 < argc) {
+            disasmRange = argv[++i];
+        } else if (strcmp(argv[i], "--palette") == 0 && i + 1 < argc) {
+            palettePath = argv[++i];
+        } else if (strcmp(argv[i], "--dump-drop") == 0) {
+            dumpPolicy = DUMP_DROP;
+        } else if (strcmp(argv[i], "--no-idle-skip") == 0) {
+            idleSkip = 0;
+        } else if (strcmp(argv[i], "--render-thread") == 0) {
+            renderThread = 1;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = 1;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            maxFrames = strtoull(argv[++i], NULL, 10);
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (frameSkip == 0)
+        frameSkip = 1;
+
+    if (headless && !replayPath && maxFrames == UINT64_MAX) {
+        fprintf(stderr, "--headless needs --replay or --frames\n");
+        return 1;
+    }
+
+    if (!FrontendInit(&fe, romPath))
+        return 1;
+
+    fe.fastForward = fastForward;
+    PacerSetRate(&fe.pacer, paceRate);
+    fe.frameSkip = frameSkip;
+    fe.nes.idleSkip = idleSkip;
+
+    /* Movies start from zeroed PRG-RAM, so recording and replaying both
+     * leave the save alone, as headless runs do. */
+    if (!savePath && !noSave && !headless && !recordPath && !replayPath &&
+        fe.nes.mem.cart->battery) {
+        SavePath(romPath, defaultSavePath, sizeof(defaultSavePath));
+        savePath = defaultSavePath;
+    }
+
+    if (savePath && !noSave && !NesMapSave(&fe.nes, savePath))
+        return 1;
+
+    if (renderThread && !NesSetRenderThread(&fe.nes, 1))
+        return 1;
+
+    if ((cdlPath || coverageImagePath) && !NesSetCoverage(&fe.nes, 1))
+        return 1;
+
+    if (tracePath && !NesSetTrace(&fe.nes, 1))
+        return 1;
+
+    if (perf) {
+        if (!FrontendOpenPerf(&fe, perfLogPath))
+            return 1;
+        if (!fe.perf.open)
+            fprintf(stderr, "No host performance counters, timing frames by wall clock only\n");
+    }
+
+    if (profilePath || profileReportPath) {
+        if (!NesSetProfiler(&fe.nes, 1))
+            return 1;
+        if (labelsPath && !ProfilerLoadLabels(fe.nes.profiler, labelsPath))
+            return 1;
+    }
+
+    if (disasmRange) {
+        const char *end;
+        uint16_t begin, last;
+
+        if (!ParseAddress(disasmRange, &end, &begin)) {
+            Usage(argv[0]);
+            return 1;
+        }
+
+        last = begin + 0x20;
+        if (*end == '-' && !ParseAddress(end + 1, &end, &last)) {
+            Usage(argv[0]);
+            return 1;
+        }
+
+        DisasmRange(&fe.nes.mem, begin, last, stdout);
+        FrontendDestroy(&fe);
+        return 0;
+    }
+
+    /* Tracing arms the debugger, which headless replays can do without. */
+    if (!quiet && !headless)
+        DebuggerSetTrace(&fe.nes.debugger, stdout);
+
+    if (replayPath) {
+        if (!MovieOpenReplay(&fe.movie, replayPath))
+            return 1;
+        fe.inputSource = INPUT_MOVIE;
+    }
+
+    if (recordPath && !MovieOpenRecord(&fe.record, recordPath))
+        return 1;
+
+    if (hashLogPath) {
+        fe.hashLog = fopen(hashLogPath, "w");
+        if (!fe.hashLog) {
+            fprintf(stderr, "Couldn't create hash log %s\n", hashLogPath);
+            return 1;
+        }
+    }
+
+    for (uint8_t i = 0; i < breakpointCount; ++i) {
+        if (!AddBreakpoint(&fe.nes.debugger, breakpoints[i]))
+            return 1;
+    }
+
+    for (uint8_t i = 0; i < watchpointCount; ++i) {
+        if (!AddWatchpoint(&fe.nes.debugger, watchpoints[i]))
+            return 1;
+    }
+
+    if (palettePath && !PaletteLoad(&fe.nes.palette, palettePath))
+        return 1;
+
+    if (dumpPath) {
+        SCALE_FILTER dumpFilter = filter;
+
+        if (dumpScale == 1)
+            dumpFilter = SCALE_NONE;
+        else if (dumpFilter == SCALE_NONE)
+            dumpFilter = SCALE_NEAREST;
+
+        if (!VideoDumpOpen(&fe.videoDump, dumpPath, dumpFormat, dumpPolicy, &fe.nes.palette,
+                           dumpFilter, dumpScale))
+            return 1;
+    }
+
+    if (headless) {
+        FrontendRunHeadless(&fe, maxFrames);
+    } else {
+        fe.headless = 0;
+        NesWindowInit(&fe.nesWindow, filter);
+        if (hud && !FrontendOpenHud(&fe, hudFontPath))
+            fprintf(stderr, "Running without the HUD\n");
+        FrontendEmulate(&fe);
+
+        if (fe.inputSource == INPUT_MOVIE)
+            printf("State hash %08x\n", NesStateHash(&fe.nes));
+    }
+
+    if (perf)
+        FrontendReportPerf(&fe, stdout);
+
+    if (cdlPath)
+        CoverageSaveCdl(fe.nes.mem.coverage, cdlPath);
+    if (coverageImagePath)
+        CoverageSaveImage(fe.nes.mem.coverage, coverageImagePath);
+
+    if (fe.nes.profiler) {
+        ProfilerCharge(fe.nes.profiler, fe.nes.steps);
+
+        if (profilePath && !WriteProfile(fe.nes.profiler, profilePath, ProfilerWriteFolded))
+            return 1;
+        if (profileReportPath && !WriteProfile(fe.nes.profiler, profileReportPath, ProfilerWriteReport))
+            return 1;
+    }
+
+    if (tracePath && !WriteTrace(fe.nes.mem.trace, tracePath))
+        return 1;
+
+    FrontendDestroy(&fe);
+
+    return 0;
+}
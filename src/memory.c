@@ -1,9 +1,12 @@
 #include <stdlib.h>
-#include <stdio.h>
 #include <string.h>
 
 #include "memory.h"
 #include "cartridge.h"
+#include "debugger.h"
+#include "coverage.h"
+#include "trace.h"
+#include "ppu.h"
 
 #define RAM_ADDR_END       0x1FFF
 #define REAL_RAM_END       0x07FF
@@ -13,11 +16,11 @@
 #define AUDIO_IO_ADDR_BEG  0x4000
 #define AUDIO_IO_ADDR_END  0x4017
 #define CARTRIDGE_ADDR_BEG 0x4020
+#define PRG_RAM_ADDR_BEG   0x6000
+#define PRG_ROM_ADDR_BEG   0x8000
 
 #define PATTERN_TABLE_ADDR_END 0x1FFF
 #define NAMETABLE_ADDR_BEG     0x2000
-#define NAMETABLE_ADDR_END     0x2FFF
-#define NAMETABLE_MIRROR_BEG   0x3000
 #define NAMETABLE_MIRROR_END   0x3EFF
 #define PALETTE_ADDR_BEG       0x3F00
 #define PALETTE_ADDR_END       0x3FFF
@@ -25,84 +28,233 @@
 void MemoryInit(Memory *mem, Cartridge *cart, uint64_t *totalCycles) {
     memset(mem->cpuRam, 0, CPU_RAM_SIZE);
     memset(mem->ppuRam, 0, PPU_RAM_SIZE);
-    memset(mem->ppuRegs, 0, PPU_REGS_SIZE);
+    memset(mem->paletteRam, 0, PALETTE_RAM_SIZE);
 
-    mem->ppustatusRead = 0;
+    mem->ppu = NULL;
+    mem->oamDmaPending = 0;
+    ControllersInit(&mem->controllers);
     mem->cart = cart;
     mem->totalCycles = totalCycles;
+    mem->debugger = NULL;
+    mem->coverage = NULL;
+    mem->trace = NULL;
+
+    MemorySetMirroring(mem, cart->mirroring);
+    MemoryMapPages(mem);
 }
 
-void MemoryClearReadFlags(Memory *mem) {
-    mem->ppustatusRead = 0;
+/* RAM and PRG-RAM are mapped for reads and writes, PRG ROM for reads only
+ * and not at all while coverage is recorded. NROM maps
+ * whole pages linearly; a mapper that switches banks has to call this again. */
+void MemoryMapPages(Memory *mem) {
+    Debugger *dbg = mem->debugger;
+
+    for (uint16_t page = 0; page < CPU_PAGE_NUM; ++page) {
+        uint16_t addr = page << 8;
+        uint8_t *read = NULL;
+        uint8_t *write = NULL;
+
+        if (addr <= RAM_ADDR_END) {
+            read = write = &mem->cpuRam[addr & REAL_RAM_END];
+        } else if (addr >= PRG_RAM_ADDR_BEG && addr < PRG_ROM_ADDR_BEG) {
+            read = write = &mem->cart->prgRam[addr & (PRG_RAM_SIZE - 1)];
+        } else if (addr >= PRG_ROM_ADDR_BEG && !mem->coverage) {
+            read = &mem->cart->prg[mem->cart->mapper->mapCpuRead(mem->cart, addr)];
+        }
+
+        mem->execPages[page] = read;
+
+        if (dbg) {
+            if (dbg->traceOut || DebuggerBreaksOnPage(dbg, page))
+                mem->execPages[page] = NULL;
+
+            if (DebuggerWatchesPage(dbg, page, WATCH_READ))
+                read = NULL;
+            if (DebuggerWatchesPage(dbg, page, WATCH_WRITE))
+                write = NULL;
+        }
+
+        mem->readPages[page] = read;
+        mem->writePages[page] = write;
+    }
 }
 
-void WriteCpuByte(Memory *mem, uint16_t addr, uint8_t byte) {
+/* Mappers that switch mirroring at runtime call this again. */
+void MemorySetMirroring(Memory *mem, MIRRORING mirroring) {
+    uint8_t *low = mem->ppuRam;
+    uint8_t *high = mem->ppuRam + NAMETABLE_SIZE;
+
+    switch (mirroring) {
+        case MIRROR_HORIZONTAL:
+            mem->nametables[0] = low;
+            mem->nametables[1] = low;
+            mem->nametables[2] = high;
+            mem->nametables[3] = high;
+            break;
+        case MIRROR_VERTICAL:
+            mem->nametables[0] = low;
+            mem->nametables[1] = high;
+            mem->nametables[2] = low;
+            mem->nametables[3] = high;
+            break;
+        case MIRROR_SINGLE_LOW:
+            mem->nametables[0] = mem->nametables[1] = low;
+            mem->nametables[2] = mem->nametables[3] = low;
+            break;
+        case MIRROR_SINGLE_HIGH:
+            mem->nametables[0] = mem->nametables[1] = high;
+            mem->nametables[2] = mem->nametables[3] = high;
+            break;
+        case MIRROR_FOUR_SCREEN:
+            mem->nametables[0] = low;
+            mem->nametables[1] = high;
+            mem->nametables[2] = mem->cart->vram;
+            mem->nametables[3] = mem->cart->vram + NAMETABLE_SIZE;
+            break;
+    }
+}
+
+/* Copies a whole CPU page into OAM, starting at OAMADDR and wrapping. Mapped
+ * pages are copied straight from their direct pointer, anything else goes
+ * through the bus. */
+static void OamDma(Memory *mem, uint8_t page) {
+    uint8_t buffer[OAM_SIZE];
+    const uint8_t *src = mem->readPages[page];
+
+    if (mem->trace)
+        TraceLog(mem->trace, TRACE_OAM_DMA, OAMDMA, page);
+
+    if (!src) {
+        for (uint16_t i = 0; i < OAM_SIZE; ++i)
+            buffer[i] = ReadCpuByte(mem, (page << 8) + i);
+        src = buffer;
+    }
+
+    PpuOamDma(mem->ppu, src);
+
+    mem->oamDmaPending = 1;
+}
+
+static void WriteBus(Memory *mem, uint16_t addr, uint8_t byte) {
     if (addr <= RAM_ADDR_END) {
         mem->cpuRam[addr & REAL_RAM_END] = byte;
     } else if (addr >= PPU_ADDR_BEG && addr <= PPU_ADDR_END) {
-        mem->ppuRegs[addr & REAL_PPU_END] = byte;
+        PpuWriteRegister(mem->ppu, PPUCTRL | (addr & REAL_PPU_END), byte);
     } else if (addr >= AUDIO_IO_ADDR_BEG && addr <= AUDIO_IO_ADDR_END) {
+        if (addr == OAMDMA)
+            OamDma(mem, byte);
+        else if (addr == JOYPAD1)
+            ControllersWrite(&mem->controllers, byte);
     } else if (addr >= CARTRIDGE_ADDR_BEG) {
         WriteCpuByteCartridge(mem->cart, addr, byte);
     }
 }
 
-uint8_t ReadCpuByte(Memory *mem, uint16_t addr) {
+static uint8_t ReadBus(Memory *mem, uint16_t addr) {
     if (addr <= RAM_ADDR_END) {
         return mem->cpuRam[addr & REAL_RAM_END];
     } else if (addr >= PPU_ADDR_BEG && addr <= PPU_ADDR_END) {
-        mem->ppustatusRead = addr == PPUSTATUS;
-
-        return mem->ppuRegs[addr & REAL_PPU_END];
+        return PpuReadRegister(mem->ppu, PPUCTRL | (addr & REAL_PPU_END));
     } else if (addr >= AUDIO_IO_ADDR_BEG && addr <= AUDIO_IO_ADDR_END) {
+        if (addr == JOYPAD1 || addr == JOYPAD2)
+            return ControllersRead(&mem->controllers, addr - JOYPAD1);
         return 0;
     } else if (addr >= CARTRIDGE_ADDR_BEG) {
         return ReadCpuByteCartridge(mem->cart, addr);
     }
-    
-    printf("ERROR read_byte got to end of function\n");
+
+    /* $4018-$401F, the disabled APU test registers. */
+    return 0;
+}
+
+void WriteCpuByte(Memory *mem, uint16_t addr, uint8_t byte) {
+    uint8_t *page = mem->writePages[addr >> 8];
+
+    if (page) {
+        page[addr & 0xFF] = byte;
+        return;
+    }
+
+    if (mem->debugger)
+        DebuggerAccess(mem->debugger, addr, WATCH_WRITE);
+    if (mem->coverage)
+        CoverageWrite(mem->coverage, addr);
+
+    WriteBus(mem, addr, byte);
+}
+
+uint8_t ReadCpuByte(Memory *mem, uint16_t addr) {
+    const uint8_t *page = mem->readPages[addr >> 8];
+
+    if (page)
+        return page[addr & 0xFF];
+
+    if (mem->debugger)
+        DebuggerAccess(mem->debugger, addr, WATCH_READ);
+    if (mem->coverage)
+        CoverageRead(mem->coverage, addr);
+
+    return ReadBus(mem, addr);
+}
+
+uint8_t PeekCpuByte(const Memory *mem, uint16_t addr) {
+    const uint8_t *page = mem->readPages[addr >> 8];
+
+    if (page)
+        return page[addr & 0xFF];
+
+    if (addr <= RAM_ADDR_END)
+        return mem->cpuRam[addr & REAL_RAM_END];
+    else if (addr >= PPU_ADDR_BEG && addr <= PPU_ADDR_END)
+        return PpuPeekRegister(mem->ppu, PPUCTRL | (addr & REAL_PPU_END));
+    else if (addr == JOYPAD1 || addr == JOYPAD2)
+        return ControllersPeek(&mem->controllers, addr - JOYPAD1);
+    else if (addr >= CARTRIDGE_ADDR_BEG)
+        return ReadCpuByteCartridge(mem->cart, addr);
+
     return 0;
 }
 
-// TODO: Finish this.
+/* $3F10/$3F14/$3F18/$3F1C mirror the background entries below them. */
+static uint8_t PaletteIndex(uint16_t addr) {
+    uint8_t index = addr & (PALETTE_RAM_SIZE - 1);
+
+    if ((index & 0x13) == 0x10)
+        index &= 0x0F;
+
+    return index;
+}
+
+/* $3000-$3EFF mirrors $2000-$2EFF, bits 10-11 pick the nametable. */
+static uint8_t *Nametable(const Memory *mem, uint16_t addr) {
+    return &mem->nametables[(addr >> 10) & (NAMETABLE_NUM - 1)][addr & (NAMETABLE_SIZE - 1)];
+}
+
 void WritePpuByte(Memory *mem, uint16_t addr, uint8_t byte) {
+    addr &= PALETTE_ADDR_END;
+
     if (addr <= PATTERN_TABLE_ADDR_END) {
-        WritePpuByteCartridge(mem->cart, addr, byte);;
-    } else if (addr >= NAMETABLE_ADDR_BEG && addr <= NAMETABLE_ADDR_END) {
-        mem->ppuRam[addr] = byte;
-    } else if (addr >= NAMETABLE_MIRROR_BEG && addr <= NAMETABLE_MIRROR_END) {
-        // TODO:
-        //mem->ppuRam[addr] = byte;
-    } else if (addr >= PALETTE_ADDR_BEG && addr <= PALETTE_ADDR_BEG) {
-        //mem->ppuRam[addr] = byte;
+        WritePpuByteCartridge(mem->cart, addr, byte);
+    } else if (addr <= NAMETABLE_MIRROR_END) {
+        *Nametable(mem, addr) = byte;
+    } else {
+        mem->paletteRam[PaletteIndex(addr)] = byte;
     }
 }
 
+/* Reads on the PPU bus itself have no side effects, the PPUDATA read
+ * buffer is on the CPU side. */
 uint8_t ReadPpuByte(Memory *mem, uint16_t addr) {
-    if (addr <= PATTERN_TABLE_ADDR_END) {
-        return ReadPpuByteCartridge(mem->cart, addr);
-    } else if (addr >= NAMETABLE_ADDR_BEG && addr <= NAMETABLE_ADDR_END) {
-        return mem->ppuRam[addr];
-    } else if (addr >= NAMETABLE_MIRROR_BEG && addr <= NAMETABLE_MIRROR_END) {
-        // TODO:
-        //return mem->ppuRam[addr];
-    } else if (addr >= PALETTE_ADDR_BEG && addr <= PALETTE_ADDR_BEG) {
-        return mem->ppuRam[addr];
-    }
-    return 0;
+    return PeekPpuByte(mem, addr);
 }
 
-void SetPpuRegisterBit(Memory *mem, uint16_t addr, uint8_t bit, uint8_t active) {
-    // After power/reset, writes to this register are ignored for about 30,000 cycles. 
-    if (addr == PPUCTRL && *(mem->totalCycles) <= 30000)
-        return;
+uint8_t PeekPpuByte(const Memory *mem, uint16_t addr) {
+    addr &= PALETTE_ADDR_END;
 
-    if (active)
-        mem->ppuRegs[addr & REAL_PPU_END] |= bit;
-    else
-        mem->ppuRegs[addr & REAL_PPU_END] &= ~bit;
-}
+    if (addr <= PATTERN_TABLE_ADDR_END)
+        return ReadPpuByteCartridge(mem->cart, addr);
+    else if (addr <= NAMETABLE_MIRROR_END)
+        return *Nametable(mem, addr);
 
-uint8_t GetPpuRegisterBit(Memory *mem, uint16_t addr, uint8_t bit) {
-    return (mem->ppuRegs[addr & REAL_PPU_END] & bit) != 0;
-}
\ No newline at end of file
+    return mem->paletteRam[PaletteIndex(addr)];
+}
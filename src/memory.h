@@ -3,9 +3,18 @@
 
 #include <stdint.h>
 
+#include "input.h"
+
 #define CPU_RAM_SIZE 2048
-#define PPU_REGS_SIZE 8
-#define PPU_RAM_SIZE 2000
+#define PPU_RAM_SIZE 2048
+#define PALETTE_RAM_SIZE 32
+#define NAMETABLE_SIZE 1024
+#define NAMETABLE_NUM 4
+#define OAM_SIZE 256
+#define CPU_PAGE_NUM 256
+
+/* CPU cycles an OAM DMA takes, plus one when it starts on an odd cycle. */
+#define OAM_DMA_CYCLES 513
 
 #define PPUCTRL_BASE_NAMETABLE_ADDR_BITS      0x03
 #define PPUCTRL_VRAM_ADDR_INCREMENT_BIT       0x04
@@ -29,13 +38,44 @@
 #define PPUSTATUS_VERTICAL_BLANK_STARTED_BIT 0x80
 
 typedef struct _Cartridge Cartridge;
+typedef struct _Debugger Debugger;
+typedef struct _Coverage Coverage;
+typedef struct _Trace Trace;
+typedef struct _Ppu Ppu;
+
+typedef enum _MIRRORING {
+    MIRROR_HORIZONTAL,  /* $2000 = $2400, $2800 = $2C00 */
+    MIRROR_VERTICAL,    /* $2000 = $2800, $2400 = $2C00 */
+    MIRROR_SINGLE_LOW,  /* All four use the first 1KiB of CIRAM */
+    MIRROR_SINGLE_HIGH, /* All four use the second 1KiB of CIRAM */
+    MIRROR_FOUR_SCREEN  /* $2800 and $2C00 live in cartridge VRAM */
+} MIRRORING;
 
 typedef struct _Memory {
+    /* Direct pointers to each 256 byte CPU page, NULL when accesses have to
+     * go through the slow path (registers, mappers, watched pages, PRG
+     * while coverage is on). Opcode fetches use execPages. Rebuilt by
+     * MemoryMapPages. */
+    uint8_t *readPages[CPU_PAGE_NUM];
+    uint8_t *writePages[CPU_PAGE_NUM];
+    const uint8_t *execPages[CPU_PAGE_NUM];
+    Debugger *debugger;
+    Coverage *coverage;
+    /* Where the CPU, the PPU and $4014 record events when set. */
+    Trace *trace;
+
     uint8_t cpuRam[CPU_RAM_SIZE];
-    uint8_t ppuRegs[PPU_REGS_SIZE];
     uint8_t ppuRam[PPU_RAM_SIZE];
+    uint8_t paletteRam[PALETTE_RAM_SIZE];
 
-    uint8_t ppustatusRead;
+    /* Where each of the four logical nametables really lives. */
+    uint8_t *nametables[NAMETABLE_NUM];
+
+    /* Handles $2000-$3FFF and is where $4014 copies to. Set by PpuInit. */
+    Ppu *ppu;
+    uint8_t oamDmaPending;
+
+    Controllers controllers;
     Cartridge *cart;
     uint64_t *totalCycles;
 } Memory;
@@ -52,8 +92,14 @@ typedef enum _PPU_REGISTERS {
     OAMDMA    = 0x4014
 } PPU_REGISTERS;
 
+typedef enum _IO_REGISTERS {
+    JOYPAD1 = 0x4016,
+    JOYPAD2 = 0x4017
+} IO_REGISTERS;
+
 void MemoryInit(Memory *mem, Cartridge *cart, uint64_t *totalCycles);
-void MemoryClearReadFlags(Memory *mem);
+void MemorySetMirroring(Memory *mem, MIRRORING mirroring);
+void MemoryMapPages(Memory *mem);
 
 void WriteCpuByte(Memory *mem, uint16_t addr, uint8_t byte);
 uint8_t ReadCpuByte(Memory *mem, uint16_t addr);
@@ -61,7 +107,8 @@ uint8_t ReadCpuByte(Memory *mem, uint16_t addr);
 void WritePpuByte(Memory *mem, uint16_t addr, uint8_t byte);
 uint8_t ReadPpuByte(Memory *mem, uint16_t addr);
 
-void SetPpuRegisterBit(Memory *mem, uint16_t addr, uint8_t bit, uint8_t active);
-uint8_t GetPpuRegisterBit(Memory *mem, uint16_t addr, uint8_t bit);
+/* Reads for debuggers and tools: no register side effects, no watchpoints. */
+uint8_t PeekCpuByte(const Memory *mem, uint16_t addr);
+uint8_t PeekPpuByte(const Memory *mem, uint16_t addr);
 
 #endif
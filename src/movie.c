@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "movie.h"
+
+#define MOVIE_MAGIC     "NESMOV01"
+#define MOVIE_MAGIC_LEN 8
+
+static void MovieReset(Movie *movie) {
+    movie->file = NULL;
+    movie->recording = 0;
+    movie->frames = NULL;
+    movie->frameCount = 0;
+    movie->position = 0;
+}
+
+uint8_t MovieOpenRecord(Movie *movie, const char *path) {
+    MovieReset(movie);
+
+    movie->file = fopen(path, "wb");
+    if (!movie->file) {
+        fprintf(stderr, "Couldn't create movie %s\n", path);
+        return 0;
+    }
+
+    fwrite(MOVIE_MAGIC, 1, MOVIE_MAGIC_LEN, movie->file);
+    movie->recording = 1;
+
+    return 1;
+}
+
+uint8_t MovieOpenReplay(Movie *movie, const char *path) {
+    char magic[MOVIE_MAGIC_LEN];
+
+    MovieReset(movie);
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Couldn't open movie %s\n", path);
+        return 0;
+    }
+
+    if (fread(magic, 1, MOVIE_MAGIC_LEN, file) != MOVIE_MAGIC_LEN ||
+        memcmp(magic, MOVIE_MAGIC, MOVIE_MAGIC_LEN) != 0) {
+        fprintf(stderr, "%s is not a movie file\n", path);
+        fclose(file);
+        return 0;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file) - MOVIE_MAGIC_LEN;
+    fseek(file, MOVIE_MAGIC_LEN, SEEK_SET);
+
+    /* Load it whole so replay never touches the disk. */
+    movie->frameCount = size / CONTROLLER_NUM;
+    movie->frames = malloc(movie->frameCount * CONTROLLER_NUM + 1);
+    if (!movie->frames) {
+        fprintf(stderr, "Not enough memory for movie %s\n", path);
+        fclose(file);
+        return 0;
+    }
+
+    if (fread(movie->frames, CONTROLLER_NUM, movie->frameCount, file) != movie->frameCount) {
+        fprintf(stderr, "Couldn't read movie %s\n", path);
+        fclose(file);
+        MovieClose(movie);
+        return 0;
+    }
+
+    fclose(file);
+    return 1;
+}
+
+void MovieRecordFrame(Movie *movie, const uint8_t buttons[CONTROLLER_NUM]) {
+    fwrite(buttons, 1, CONTROLLER_NUM, movie->file);
+    ++movie->frameCount;
+}
+
+uint8_t MovieNextFrame(Movie *movie, uint8_t buttons[CONTROLLER_NUM]) {
+    if (movie->position == movie->frameCount)
+        return 0;
+
+    memcpy(buttons, &movie->frames[movie->position * CONTROLLER_NUM], CONTROLLER_NUM);
+    ++movie->position;
+
+    return 1;
+}
+
+void MovieClose(Movie *movie) {
+    if (movie->file)
+        fclose(movie->file);
+
+    free(movie->frames);
+    MovieReset(movie);
+}
@@ -0,0 +1,29 @@
+#ifndef MOVIE_H_
+#define MOVIE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "input.h"
+
+/* Input movie: an 8-byte magic followed by one byte per controller for
+ * every emulated frame, starting at power on. */
+typedef struct _Movie {
+    FILE *file;
+    uint8_t recording;
+
+    uint8_t *frames;
+    uint64_t frameCount;
+    uint64_t position;
+} Movie;
+
+uint8_t MovieOpenRecord(Movie *movie, const char *path);
+uint8_t MovieOpenReplay(Movie *movie, const char *path);
+
+void MovieRecordFrame(Movie *movie, const uint8_t buttons[CONTROLLER_NUM]);
+/* Returns 0 once the movie is over. */
+uint8_t MovieNextFrame(Movie *movie, uint8_t buttons[CONTROLLER_NUM]);
+
+void MovieClose(Movie *movie);
+
+#endif
@@ -1,138 +1,526 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "cartridge.h"
 #include "nes.h"
 #include "ppu.h"
+#include "hash.h"
+#include "renderer.h"
+#include "coverage.h"
+#include "profiler.h"
+#include "trace.h"
+
+#define OPCODE_JSR 0x20
+#define OPCODE_RTI 0x40
+#define OPCODE_RTS 0x60
+#define RESET_VECTOR 0xFFFC
+
+#define STATE_MAGIC   "NESSTATE"
+#define STATE_VERSION 3
+
+typedef struct _StateHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t size;
+} StateHeader;
+
+uint8_t NesInit(Nes *nes, const uint8_t *data, size_t size) {
+    Cartridge *cart = CartridgeLoadINes(data, size);
+    if (!cart)
+        return 0;
+
+    NesInitCart(nes, cart);
+    return 1;
+}
 
-// TODO: Refactor cartridge logic.
+uint8_t NesInitFile(Nes *nes, const char *romPath) {
+    Cartridge *cart = CartridgeLoadFile(romPath);
+    if (!cart)
+        return 0;
 
-#define KIB_16 16 * 1024
-#define KIB_8  8  * 1024
+    NesInitCart(nes, cart);
+    return 1;
+}
 
-static Cartridge *FileToCart(const char *filename) {
-    Cartridge *cart = malloc(sizeof(Cartridge));
+void NesInitCart(Nes *nes, Cartridge *cart) {
+    nes->totalCycles = 0;
 
-    FILE *rom = fopen(filename, "r");
+    PaletteInitDefault(&nes->palette);
 
-    /* Just read nestest for now. */
-    cart->mapper = &mappers[0];
+    MemoryInit(&nes->mem, cart, &nes->totalCycles);
+    CpuInit(&nes->cpu, &nes->mem, &nes->totalCycles);
+    PpuInit(&nes->ppu, &nes->mem, &nes->totalCycles);
 
-    cart->prgBanks = 1; /* In 16KiB */
-    cart->chrBanks = 1; /* In 8KiB */
-    cart->prg = malloc(cart->prgBanks * KIB_16);
-    cart->chr = malloc(cart->chrBanks * KIB_8);
+    DebuggerInit(&nes->debugger, &nes->mem, &nes->ppu);
+    nes->midFrame = 0;
 
-    fseek(rom, 16, SEEK_SET);
-    fread(cart->prg, 1, cart->prgBanks * KIB_16, rom);
-    fread(cart->chr, 1, cart->chrBanks * KIB_8, rom);
+    nes->idleSkip = 1;
+    nes->idle.valid = 0;
+    nes->idle.lastPc = 0;
+    nes->steps = 0;
+    nes->skippedSteps = 0;
+    nes->profiler = NULL;
+    nes->sampling = 0;
+}
 
-    fclose(rom);
+void NesDestroy(Nes *nes) {
+    NesSetRenderThread(nes, 0);
+    NesSetCoverage(nes, 0);
+    NesSetProfiler(nes, 0);
+    NesSetTrace(nes, 0);
 
-    return cart;
+    CartridgeDestroy(nes->mem.cart);
+    free(nes->mem.cart);
+    nes->mem.cart = NULL;
 }
 
-void NesInit(Nes *nes) {
-    nes->paused = 0;
-    nes->running = 1;
-    nes->debug = 1;
-    nes->totalCycles = 0;
+Nes *NesCreate(const uint8_t *data, size_t size) {
+    Nes *nes = aligned_alloc(_Alignof(Nes), sizeof(Nes));
 
-    NesWindowInit(&nes->nesWindow);
+    if (!nes) {
+        fprintf(stderr, "Not enough memory for a Nes\n");
+        return NULL;
+    }
 
-    Cartridge *cart = FileToCart("test_roms/nestest.nes");
+    if (!NesInit(nes, data, size)) {
+        free(nes);
+        return NULL;
+    }
 
-    MemoryInit(&nes->mem, cart, &nes->totalCycles);
-    CpuInit(&nes->cpu, &nes->mem, &nes->totalCycles);
-    PpuInit(&nes->ppu, &nes->mem, &nes->totalCycles);
+    return nes;
+}
+
+void NesFree(Nes *nes) {
+    NesDestroy(nes);
+    free(nes);
+}
+
+static uint8_t SameRegisters(const Registers *a, const Registers *b) {
+    return a->pc == b->pc && a->sp == b->sp && a->a == b->a &&
+           a->x == b->x && a->y == b->y && a->s == b->s;
+}
+
+/* Starts timing a pass from here. PPUSTATUS loops also note how far off
+ * the next PPU event is, to tell whether the pass saw one. */
+static void IdleMark(Nes *nes) {
+    IdleLoop *idle = &nes->idle;
+
+    idle->regs = nes->cpu.regs;
+    idle->instructions = 0;
+    idle->step = nes->steps;
+    idle->cycles = nes->totalCycles;
+
+    if (idle->type == IDLE_PPUSTATUS)
+        idle->quietDots = PpuIdleDots(&nes->ppu, 1);
+}
+
+/* Called at every instruction boundary. Skipping k passes is the same as
+ * stepping them: the CPU ends up where it is now, the PPU runs k passes'
+ * worth of dots and the cycle count moves on by k passes. */
+static void NesSkipIdle(Nes *nes) {
+    Cpu *cpu = &nes->cpu;
+    IdleLoop *idle = &nes->idle;
+    uint16_t pc = cpu->regs.pc;
+    uint16_t lastPc = idle->lastPc;
+
+    idle->lastPc = pc;
+    ++idle->instructions;
+
+    /* An interrupt between two passes would be counted as part of one, and
+     * the debugger and a trace have to see every pass's reads. */
+    if (cpu->interrupt || nes->mem.debugger || nes->mem.trace) {
+        idle->valid = 0;
+        return;
+    }
+
+    if (!idle->valid || pc != idle->start) {
+        if (pc > lastPc)
+            return;
+
+        idle->valid = 1;
+        idle->start = pc;
+        idle->type = CpuIdleLoop(cpu, pc, &idle->length);
+        IdleMark(nes);
+        return;
+    }
+
+    if (idle->type == IDLE_NONE)
+        return;
+
+    uint64_t passSteps = nes->steps - idle->step;
+    uint64_t passCycles = nes->totalCycles - idle->cycles;
+    uint8_t same = idle->instructions == idle->length && SameRegisters(&cpu->regs, &idle->regs);
+    uint8_t length;
+
+    /* PPUSTATUS only holds still between PPU events, and a read of a set
+     * VBlank flag clears it. */
+    if (idle->type == IDLE_PPUSTATUS)
+        same = same && idle->quietDots >= 3 * passSteps &&
+               !(nes->ppu.status & PPUSTATUS_VERTICAL_BLANK_STARTED_BIT);
+
+    uint64_t passes = same ? PpuIdleDots(&nes->ppu, idle->type == IDLE_PPUSTATUS) / (3 * passSteps) : 0;
+
+    /* The code may have been rewritten since it was matched. */
+    if (passes && (CpuIdleLoop(cpu, pc, &length) != idle->type || length != idle->length)) {
+        idle->type = IDLE_NONE;
+        return;
+    }
+
+    if (passes) {
+        PpuSkip(&nes->ppu, passes * passSteps * 3);
+
+        nes->totalCycles += passes * passCycles;
+        nes->steps += passes * passSteps;
+        nes->skippedSteps += passes * passSteps;
+    }
+
+    IdleMark(nes);
+}
+
+/* CpuEmulate, telling the profiler about the interrupts taken and the
+ * calls and returns run. A step is a CPU cycle, skipped ones included. */
+static uint8_t NesProfileStep(Nes *nes) {
+    Cpu *cpu = &nes->cpu;
+    Profiler *prof = nes->profiler;
+    uint8_t boundary = cpu->currentCycle >= cpu->cycles;
+    uint8_t interrupt = cpu->interrupt;
+    uint8_t sp = cpu->regs.sp;
+    uint8_t opcode = boundary ? PeekCpuByte(&nes->mem, cpu->regs.pc) : 0;
+
+    uint8_t done = CpuEmulate(cpu);
+
+    if (!boundary || done == CPU_STOPPED)
+        return done;
+
+    if (interrupt & RESET) {
+        ProfilerReset(prof, cpu->regs.pc, nes->steps);
+    } else if (interrupt) {
+        ProfilerCall(prof, cpu->regs.pc, sp, nes->steps);
+    } else if (done) {
+        if (opcode == OPCODE_JSR)
+            ProfilerCall(prof, cpu->regs.pc, sp, nes->steps);
+        else if (opcode == OPCODE_RTS || opcode == OPCODE_RTI)
+            ProfilerReturn(prof, cpu->regs.sp, nes->steps);
+    }
+
+    return done;
+}
+
+static uint8_t StepCpu(Nes *nes) {
+    if (nes->profiler)
+        return NesProfileStep(nes);
+
+    return CpuEmulate(&nes->cpu);
+}
+
+static void StepPpu(Nes *nes) {
+    PpuEmulate(&nes->ppu);
+    PpuEmulate(&nes->ppu);
+    PpuEmulate(&nes->ppu);
+
+    if (nes->ppu.needsNmi) {
+        CpuRequestInterrupt(&nes->cpu, NMI);
+        nes->ppu.needsNmi = 0;
+    }
+}
+
+static uint64_t Nanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* What's left of span once the clock read inside it is taken out. */
+static uint64_t LessClock(const StepSamples *samples, uint64_t span) {
+    return span > samples->clockNs ? span - samples->clockNs : 0;
+}
+
+static uint8_t NesSampleStep(Nes *nes) {
+    StepSamples *samples = &nes->samples;
+    uint64_t start = Nanoseconds();
+
+    if (StepCpu(nes) == CPU_STOPPED)
+        return CPU_STOPPED;
+    uint64_t split = Nanoseconds();
+
+    StepPpu(nes);
+    uint64_t end = Nanoseconds();
 
+    samples->cpuNs += LessClock(samples, split - start);
+    samples->ppuNs += LessClock(samples, end - split);
+    ++samples->count;
+    return 0;
+}
+
+static void NesStep(Nes *nes) {
+    if (nes->idleSkip && nes->cpu.currentCycle >= nes->cpu.cycles)
+        NesSkipIdle(nes);
+
+    ++nes->steps;
+
+    if (nes->sampling && !(nes->steps & (NES_SAMPLE_PERIOD - 1))) {
+        if (NesSampleStep(nes) == CPU_STOPPED)
+            --nes->steps;
+        return;
+    }
+
+    /* A breakpoint stop takes no time, so the PPU waits for the CPU and
+     * resuming runs the same step again. */
+    if (StepCpu(nes) == CPU_STOPPED) {
+        --nes->steps;
+        return;
+    }
+
+    StepPpu(nes);
+}
+
+uint8_t NesRunFrame(Nes *nes) {
+    nes->ppu.frameComplete = 0;
+
+    while (!nes->ppu.frameComplete)
+        NesStep(nes);
+
+    if (nes->ppu.renderer)
+        RendererFinish(nes->ppu.renderer);
+
+    nes->midFrame = nes->debugger.hit;
+    return !nes->midFrame;
+}
+
+/* Reset can't be masked, so it skips CpuRequestInterrupt. The PPU clears
+ * its control registers and the write toggle on reset, which no register
+ * write reproduces without touching t, so a render thread is caught up and
+ * copies the PPU again. */
+void NesReset(Nes *nes) {
+    Renderer *renderer = nes->ppu.renderer;
+
+    if (renderer)
+        RendererFinish(renderer);
+
+    nes->cpu.interrupt |= RESET;
+    nes->ppu.ctrl = 0;
+    nes->ppu.mask = 0;
+    nes->ppu.w = 0;
+    nes->idle.valid = 0;
+
+    if (renderer)
+        RendererSync(renderer);
 }
 
-void NesEmulate(Nes *nes) {
-    uint8_t finishedInstruction;
-    
-    while (nes->running) {
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
-                nes->running = 0;
-            } else if (event.type == SDL_KEYDOWN) {
-                if (event.key.keysym.sym == SDLK_p)
-                    nes->paused = !nes->paused;
-            }
+uint8_t NesSetRenderThread(Nes *nes, uint8_t on) {
+    if (on && !nes->ppu.renderer) {
+        nes->ppu.renderer = RendererCreate(&nes->ppu);
+        return nes->ppu.renderer != NULL;
+    }
+
+    if (!on && nes->ppu.renderer) {
+        RendererDestroy(nes->ppu.renderer);
+        nes->ppu.renderer = NULL;
+    }
+
+    return 1;
+}
+
+uint8_t NesSetCoverage(Nes *nes, uint8_t on) {
+    Memory *mem = &nes->mem;
+
+    if (on && !mem->coverage) {
+        mem->coverage = CoverageCreate(mem->cart);
+        if (!mem->coverage) {
+            fprintf(stderr, "Not enough memory for coverage\n");
+            return 0;
         }
 
-        if (!nes->paused) {
-            MemoryClearReadFlags(&nes->mem);
-            
-            finishedInstruction = CpuEmulate(&nes->cpu);
+        MemoryMapPages(mem);
+    }
 
-            PpuEmulate(&nes->ppu);
-            PpuEmulate(&nes->ppu);
-            PpuEmulate(&nes->ppu);
+    if (!on && mem->coverage) {
+        CoverageDestroy(mem->coverage);
+        mem->coverage = NULL;
+        MemoryMapPages(mem);
+    }
 
-            if (nes->ppu.needsNmi) {
-                CpuRequestInterrupt(&nes->cpu, NMI);
-                nes->ppu.needsNmi = 0;
-            }
+    return 1;
+}
 
-            if (finishedInstruction)
-                printf("PPU: %i, %i CYC:%li\n", nes->ppu.scanline, nes->ppu.cycle, nes->totalCycles);  
+uint8_t NesSetProfiler(Nes *nes, uint8_t on) {
+    if (on && !nes->profiler) {
+        nes->profiler = ProfilerCreate();
+        if (!nes->profiler) {
+            fprintf(stderr, "Not enough memory for the profiler\n");
+            return 0;
         }
 
-        SDL_SetRenderDrawColor(nes->nesWindow.renderer, 0, 0, 0, 255);
-        SDL_RenderClear(nes->nesWindow.renderer);
+        /* Cycles before this point aren't anyone's, and the code running
+         * now is filed under the reset handler. */
+        nes->profiler->charged = nes->steps;
+        nes->profiler->nodes[0].addr = PeekCpuByte(&nes->mem, RESET_VECTOR) |
+                                       PeekCpuByte(&nes->mem, RESET_VECTOR + 1) << 8;
+    }
 
-        //SDL_SetRenderDrawColor(nes.renderer, 128, 128, 128, 255);
-        //SDL_RenderFillRect(nes.renderer, &NES_RECT);
-        SDL_RenderPresent(nes->nesWindow.renderer);
+    if (!on && nes->profiler) {
+        ProfilerDestroy(nes->profiler);
+        nes->profiler = NULL;
+    }
+
+    return 1;
+}
+
+uint8_t NesSetTrace(Nes *nes, uint8_t on) {
+    Memory *mem = &nes->mem;
 
-        //SDL_Delay(16);
+    if (on && !mem->trace) {
+        mem->trace = TraceCreate(&nes->ppu);
+        if (!mem->trace) {
+            fprintf(stderr, "Not enough memory for the trace\n");
+            return 0;
+        }
+    }
+
+    if (!on && mem->trace) {
+        TraceDestroy(mem->trace);
+        mem->trace = NULL;
     }
+
+    return 1;
 }
 
-void NesDestroy(Nes *nes) {
-    NesWindowDestroy(&nes->nesWindow);
-    CartridgeDestroy(nes->mem.cart);
-    free(nes->mem.cart);
+uint8_t NesMapSave(Nes *nes, const char *path) {
+    if (!CartridgeMapSave(nes->mem.cart, path))
+        return 0;
+
+    MemoryMapPages(&nes->mem);
+    return 1;
 }
 
-void NesWindowInit(NesWindow *window) {
-    SDL_Init(SDL_INIT_VIDEO);
+void NesSetSampling(Nes *nes, uint8_t on) {
+    StepSamples *samples = &nes->samples;
 
-    window->scale = 4;
-    window->width = 256 * window->scale;
-    window->height = 240 * window->scale;
+    if (on && !nes->sampling) {
+        samples->cpuNs = 0;
+        samples->ppuNs = 0;
+        samples->count = 0;
 
-    window->window = SDL_CreateWindow(
-            "NES",
-            SDL_WINDOWPOS_CENTERED,
-            SDL_WINDOWPOS_CENTERED,
-            window->width,
-            window->height,
-            0
-    );
+        /* The cheapest of a few back to back reads. */
+        samples->clockNs = UINT64_MAX;
+        for (uint32_t i = 0; i < 64; ++i) {
+            uint64_t start = Nanoseconds();
+            uint64_t span = Nanoseconds() - start;
 
-    window->renderer = SDL_CreateRenderer(
-            window->window,
-            -1,
-            SDL_RENDERER_ACCELERATED
-    );
+            if (span < samples->clockNs)
+                samples->clockNs = span;
+        }
+    }
 
+    nes->sampling = on;
 }
 
-void NesWindowDestroy(NesWindow *window) {
-    SDL_DestroyRenderer(window->renderer);
-    SDL_DestroyWindow(window->window);
-    SDL_Quit();
+void NesSetButtons(Nes *nes, const uint8_t buttons[CONTROLLER_NUM]) {
+    ControllersSetButtons(&nes->mem.controllers, buttons);
 }
 
-int32_t main() {
-    Nes nes;
+const uint8_t *NesFrameBuffer(const Nes *nes) {
+    return nes->ppu.frameBuffer;
+}
 
-    NesInit(&nes);
-    NesEmulate(&nes);
-    NesDestroy(&nes);
+void NesFrameRgba(const Nes *nes, uint32_t *out) {
+    PaletteConvertFrame(&nes->palette, nes->ppu.frameBuffer, nes->ppu.emphasis, out);
+}
 
-    return 0;
+uint32_t NesFrameHash(const Nes *nes) {
+    return HashFrame(nes->ppu.frameBuffer);
+}
+
+uint32_t NesStateHash(const Nes *nes) {
+    return HashState(&nes->cpu, &nes->ppu, &nes->mem);
+}
+
+/* Header, then the Cpu, Ppu and Memory structs as they are, the cycle
+ * count and the cartridge's writable memory. */
+size_t NesStateSize(const Nes *nes) {
+    return sizeof(StateHeader) + sizeof(Cpu) + sizeof(Ppu) + sizeof(Memory) +
+           sizeof(uint64_t) + CartridgeStateSize(nes->mem.cart);
+}
+
+void NesSaveState(const Nes *nes, uint8_t *state) {
+    StateHeader header;
+
+    memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+    header.version = STATE_VERSION;
+    header.size = NesStateSize(nes);
+
+    memcpy(state, &header, sizeof(header));
+    state += sizeof(header);
+    memcpy(state, &nes->cpu, sizeof(Cpu));
+    state += sizeof(Cpu);
+    memcpy(state, &nes->ppu, sizeof(Ppu));
+    state += sizeof(Ppu);
+    memcpy(state, &nes->mem, sizeof(Memory));
+    state += sizeof(Memory);
+    memcpy(state, &nes->totalCycles, sizeof(uint64_t));
+    state += sizeof(uint64_t);
+
+    CartridgeSaveState(nes->mem.cart, state);
+}
+
+/* The structs come back with the saving Nes's pointers, so everything that
+ * points into the machine is aimed back at this one. */
+uint8_t NesLoadState(Nes *nes, const uint8_t *state, size_t size) {
+    Cartridge *cart = nes->mem.cart;
+    Debugger *dbg = nes->mem.debugger;
+    Coverage *cov = nes->mem.coverage;
+    Trace *trace = nes->mem.trace;
+    Renderer *renderer = nes->ppu.renderer;
+    StateHeader header;
+
+    if (size < sizeof(header)) {
+        fprintf(stderr, "Save state is truncated\n");
+        return 0;
+    }
+
+    memcpy(&header, state, sizeof(header));
+    if (memcmp(header.magic, STATE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != STATE_VERSION || header.size != size || size != NesStateSize(nes)) {
+        fprintf(stderr, "Save state is from another build or ROM\n");
+        return 0;
+    }
+
+    state += sizeof(header);
+    memcpy(&nes->cpu, state, sizeof(Cpu));
+    state += sizeof(Cpu);
+    memcpy(&nes->ppu, state, sizeof(Ppu));
+    state += sizeof(Ppu);
+    memcpy(&nes->mem, state, sizeof(Memory));
+    state += sizeof(Memory);
+    memcpy(&nes->totalCycles, state, sizeof(uint64_t));
+    state += sizeof(uint64_t);
+
+    CartridgeLoadState(cart, state);
+
+    nes->cpu.mem = &nes->mem;
+    nes->cpu.totalCycles = &nes->totalCycles;
+    nes->ppu.mem = &nes->mem;
+    nes->ppu.totalCycles = &nes->totalCycles;
+    nes->ppu.renderer = renderer;
+    nes->mem.cart = cart;
+    nes->mem.debugger = dbg;
+    nes->mem.coverage = cov;
+    nes->mem.trace = trace;
+    nes->mem.ppu = &nes->ppu;
+    nes->mem.totalCycles = &nes->totalCycles;
+
+    MemorySetMirroring(&nes->mem, cart->mirroring);
+    MemoryMapPages(&nes->mem);
+
+    if (renderer)
+        RendererSync(renderer);
+
+    if (nes->profiler)
+        ProfilerUnwind(nes->profiler, nes->steps);
+
+    nes->midFrame = 0;
+    nes->idle.valid = 0;
+    return 1;
 }
@@ -1,39 +1,134 @@
 #ifndef NES_H_
 #define NES_H_
 
-#include <SDL2/SDL.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "cpu.h"
 #include "ppu.h"
 #include "memory.h"
+#include "palette.h"
+#include "debugger.h"
 
-typedef struct _NesWindow {
-    uint32_t scale;
-    uint32_t width;
-    uint32_t height;
+#define NTSC_FRAME_RATE 60.0988
+/* Only for pacing, the machine itself keeps NTSC timing. */
+#define PAL_FRAME_RATE  50.0070
+/* Steps between timed ones when sampling, a power of two. */
+#define NES_SAMPLE_PERIOD 128
 
-    SDL_Window *window;
-    SDL_Renderer *renderer;
-} NesWindow;
+typedef struct _Cartridge Cartridge;
+typedef struct _Profiler Profiler;
 
-typedef struct _Nes {
-    uint8_t debug;
+/* The loop NesStep last jumped back to. Once two passes in a row leave the
+ * registers the same, further passes can be skipped until something the
+ * loop reads can change. */
+typedef struct _IdleLoop {
+    uint8_t valid;
+    uint16_t start;
+    IDLE_LOOP type;
+    uint8_t length;
+
+    /* State at the last time round, and instructions run since. */
+    Registers regs;
+    uint32_t instructions;
+    uint32_t quietDots;
+    uint64_t step;
+    uint64_t cycles;
+
+    /* PC of the last instruction, a jump back is what starts a match. */
+    uint16_t lastPc;
+} IdleLoop;
 
-    NesWindow nesWindow;
+/* Host time of the sampled steps in the CPU and in the PPU, less what
+ * reading the clock costs. The CPU and the PPU take turns too often to
+ * time every turn, but the samples split a frame's time the same way. */
+typedef struct _StepSamples {
+    uint64_t cpuNs;
+    uint64_t ppuNs;
+    uint64_t count;
+    uint64_t clockNs;
+} StepSamples;
+
+/* The console itself: no window, no files, no stdio while running. The SDL
+ * frontend in frontend.c is one client, VecEnv another. */
+typedef struct _Nes {
     Cpu cpu;
     Ppu ppu;
     Memory mem;
+    Palette palette;
+
+    /* A hit ends NesRunFrame early, leaving midFrame set so the next call
+     * finishes the frame. Clients shouldn't change input while it's set. */
+    Debugger debugger;
+    uint8_t midFrame;
 
-    uint8_t paused;
-    uint8_t running;
+    /* Set by default. Clear it to check that skipping changes nothing. */
+    uint8_t idleSkip;
+    IdleLoop idle;
+    uint64_t steps;
+    uint64_t skippedSteps;
+
+    /* Charged a CPU cycle per step when set, see NesSetProfiler. */
+    Profiler *profiler;
+
+    /* Times every NES_SAMPLE_PERIOD-th step when set, see NesSetSampling. */
+    uint8_t sampling;
+    StepSamples samples;
 
     uint64_t totalCycles;
 } Nes;
 
-void NesInit(Nes *nes);
-void NesEmulate(Nes *nes);
+/* Loads an iNES image from memory; data can be freed afterwards. */
+uint8_t NesInit(Nes *nes, const uint8_t *data, size_t size);
+uint8_t NesInitFile(Nes *nes, const char *romPath);
+/* Takes ownership of cart. */
+void NesInitCart(Nes *nes, Cartridge *cart);
 void NesDestroy(Nes *nes);
 
-void NesWindowInit(NesWindow *window);
-void NesWindowDestroy(NesWindow *window);
+/* Heap-allocated Nes, for callers that can't know its size (e.g. FFI). */
+Nes *NesCreate(const uint8_t *data, size_t size);
+void NesFree(Nes *nes);
+
+/* Returns 0 when the debugger stopped the frame before it was done. A
+ * jammed CPU doesn't stop frames, the PPU runs on, so clients check
+ * cpu.jammed themselves. */
+uint8_t NesRunFrame(Nes *nes);
+/* The reset button. RAM, PRG-RAM and VRAM keep what's in them. */
+void NesReset(Nes *nes);
+
+/* Draws pixels on a second thread while the CPU keeps going, see
+ * renderer.h. Frames and hashes come out the same. Returns 0 when the
+ * thread can't be started. */
+uint8_t NesSetRenderThread(Nes *nes, uint8_t on);
+/* Records which PRG bytes run and which are read or written, in
+ * nes->mem.coverage, see coverage.h. Off, it costs nothing. Returns 0
+ * when out of memory. */
+uint8_t NesSetCoverage(Nes *nes, uint8_t on);
+/* Charges CPU cycles to 6502 routines, see profiler.h. Cheap enough to
+ * leave on for a replay. Returns 0 when out of memory. */
+uint8_t NesSetProfiler(Nes *nes, uint8_t on);
+/* Records interrupts, VBlank, sprite-0 hits and PPU register accesses in
+ * nes->mem.trace, see trace.h. Returns 0 when out of memory. */
+uint8_t NesSetTrace(Nes *nes, uint8_t on);
+/* Keeps PRG-RAM in a save file, see CartridgeMapSave. Call it before
+ * the first frame. Returns 0 when the file can't be mapped. */
+uint8_t NesMapSave(Nes *nes, const char *path);
+/* Splits host time between the CPU and the PPU in nes->samples, for a few
+ * percent of speed. */
+void NesSetSampling(Nes *nes, uint8_t on);
+void NesSetButtons(Nes *nes, const uint8_t buttons[CONTROLLER_NUM]);
+
+/* PPU_WIDTH x PPU_HEIGHT color indices, valid until the next frame. */
+const uint8_t *NesFrameBuffer(const Nes *nes);
+void NesFrameRgba(const Nes *nes, uint32_t *out);
+
+uint32_t NesFrameHash(const Nes *nes);
+uint32_t NesStateHash(const Nes *nes);
+
+/* Save states are a raw snapshot of the machine, so they only load into
+ * the same build, with the same ROM. Movies are the portable format. */
+size_t NesStateSize(const Nes *nes);
+void NesSaveState(const Nes *nes, uint8_t *state);
+uint8_t NesLoadState(Nes *nes, const uint8_t *state, size_t size);
 
 #endif
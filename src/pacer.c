@@ -0,0 +1,75 @@
+#include <errno.h>
+#include <time.h>
+
+#include "pacer.h"
+
+/* Weight of the latest oversleep in the running average. */
+#define OVERSLEEP_WEIGHT 0.125
+
+static uint64_t Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void SleepUntil(uint64_t when) {
+    struct timespec ts = {when / 1000000000, when % 1000000000};
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+static uint64_t Deadline(const Pacer *pacer) {
+    return pacer->base + (uint64_t)(pacer->frames * pacer->periodNs);
+}
+
+void PacerInit(Pacer *pacer, double rate) {
+    pacer->periodNs = 1e9 / rate;
+    pacer->spinNs = PACER_MAX_SPIN_NS / 4;
+    pacer->oversleepNs = pacer->spinNs / 2;
+    pacer->late = 0;
+    PacerReset(pacer);
+}
+
+void PacerSetRate(Pacer *pacer, double rate) {
+    pacer->base = Deadline(pacer);
+    pacer->frames = 0;
+    pacer->periodNs = 1e9 / rate;
+}
+
+void PacerReset(Pacer *pacer) {
+    pacer->base = Now();
+    pacer->frames = 0;
+}
+
+void PacerWait(Pacer *pacer) {
+    ++pacer->frames;
+
+    uint64_t deadline = Deadline(pacer);
+    uint64_t now = Now();
+
+    if (now >= deadline) {
+        ++pacer->late;
+        if (now - deadline > pacer->periodNs)
+            PacerReset(pacer);
+        return;
+    }
+
+    if (deadline - now > pacer->spinNs) {
+        uint64_t wake = deadline - pacer->spinNs;
+
+        SleepUntil(wake);
+        now = Now();
+
+        /* The spin only has to cover how late sleeps tend to wake up. */
+        pacer->oversleepNs += ((double)(now > wake ? now - wake : 0) - pacer->oversleepNs) * OVERSLEEP_WEIGHT;
+        pacer->spinNs = 2 * pacer->oversleepNs;
+        if (pacer->spinNs < PACER_MIN_SPIN_NS)
+            pacer->spinNs = PACER_MIN_SPIN_NS;
+        else if (pacer->spinNs > PACER_MAX_SPIN_NS)
+            pacer->spinNs = PACER_MAX_SPIN_NS;
+    }
+
+    while (Now() < deadline)
+        ;
+}
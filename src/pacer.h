@@ -0,0 +1,41 @@
+#ifndef PACER_H_
+#define PACER_H_
+
+#include <stdint.h>
+
+/* Longest and shortest spin before a deadline, see Pacer.spinNs. */
+#define PACER_MAX_SPIN_NS 2000000
+#define PACER_MIN_SPIN_NS 50000
+
+/* Holds frames to a fixed rate against CLOCK_MONOTONIC. Deadlines are
+ * counted from a base in whole frames, so rounding never adds up to
+ * drift. Waits sleep with clock_nanosleep until shortly before the
+ * deadline and spin the rest, the spin sized to how late the sleeps wake
+ * up, which keeps frames within microseconds of the rate while leaving
+ * the core idle between them. */
+typedef struct _Pacer {
+    double periodNs;
+    uint64_t base;
+    uint64_t frames;
+
+    /* How long before a deadline sleeping stops, twice the average
+     * oversleep. */
+    uint64_t spinNs;
+    double oversleepNs;
+
+    /* Frames that were already due when waited for. */
+    uint64_t late;
+} Pacer;
+
+void PacerInit(Pacer *pacer, double rate);
+/* Changes the rate from the next frame on, e.g. for an audio clock to
+ * nudge it. */
+void PacerSetRate(Pacer *pacer, double rate);
+/* Starts counting from now, after a pause or fast-forward. */
+void PacerReset(Pacer *pacer);
+
+/* Returns when the next frame is due. A frame more than one period late
+ * starts the count over instead of rushing to catch up. */
+void PacerWait(Pacer *pacer);
+
+#endif
@@ -0,0 +1,157 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "palette.h"
+#include "ppu.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_AVX2_GATHER 1
+#endif
+
+/* How much emphasis dims the channels it doesn't select. */
+#define EMPHASIS_ATTENUATION 0.816
+
+#define EMPHASIS_RED   0x01
+#define EMPHASIS_GREEN 0x02
+#define EMPHASIS_BLUE  0x04
+
+/* 2C02 colors, as commonly measured from NTSC hardware. */
+static const uint8_t gDefaultPalette[PALETTE_COLORS][3] = {
+    { 84,  84,  84}, {  0,  30, 116}, {  8,  16, 144}, { 48,   0, 136},
+    { 68,   0, 100}, { 92,   0,  48}, { 84,   4,   0}, { 60,  24,   0},
+    { 32,  42,   0}, {  8,  58,   0}, {  0,  64,   0}, {  0,  60,   0},
+    {  0,  50,  60}, {  0,   0,   0}, {  0,   0,   0}, {  0,   0,   0},
+    {152, 150, 152}, {  8,  76, 196}, { 48,  50, 236}, { 92,  30, 228},
+    {136,  20, 176}, {160,  20, 100}, {152,  34,  32}, {120,  60,   0},
+    { 84,  90,   0}, { 40, 114,   0}, {  8, 124,   0}, {  0, 118,  40},
+    {  0, 102, 120}, {  0,   0,   0}, {  0,   0,   0}, {  0,   0,   0},
+    {236, 238, 236}, { 76, 154, 236}, {120, 124, 236}, {176,  98, 236},
+    {228,  84, 236}, {236,  88, 180}, {236, 106, 100}, {212, 136,  32},
+    {160, 170,   0}, {116, 196,   0}, { 76, 208,  32}, { 56, 204, 108},
+    { 56, 180, 204}, { 60,  60,  60}, {  0,   0,   0}, {  0,   0,   0},
+    {236, 238, 236}, {168, 204, 236}, {188, 188, 236}, {212, 178, 236},
+    {236, 174, 236}, {236, 174, 212}, {236, 180, 176}, {228, 196, 144},
+    {204, 210, 120}, {180, 222, 120}, {168, 226, 144}, {152, 226, 180},
+    {160, 214, 228}, {160, 162, 160}, {  0,   0,   0}, {  0,   0,   0}
+};
+
+/* Fills in emphasis 1-7 from the 64 plain colors in rgba[0..63]. */
+static void BuildEmphasis(Palette *pal) {
+    static const uint8_t channelBits[3] = {EMPHASIS_RED, EMPHASIS_GREEN, EMPHASIS_BLUE};
+
+    for (uint16_t emphasis = 1; emphasis < PALETTE_EMPHASIS_NUM; ++emphasis) {
+        for (uint8_t i = 0; i < PALETTE_COLORS; ++i) {
+            uint8_t bytes[4];
+            memcpy(bytes, &pal->rgba[i], 4);
+
+            for (uint8_t c = 0; c < 3; ++c) {
+                if (!(emphasis & channelBits[c]))
+                    bytes[c] = (uint8_t)(bytes[c] * EMPHASIS_ATTENUATION);
+            }
+
+            memcpy(&pal->rgba[emphasis * PALETTE_COLORS + i], bytes, 4);
+        }
+    }
+}
+
+static void SetColors(Palette *pal, const uint8_t *rgb, uint16_t count) {
+    for (uint16_t i = 0; i < count; ++i) {
+        uint8_t bytes[4] = {rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], 0xFF};
+        memcpy(&pal->rgba[i], bytes, sizeof(bytes));
+    }
+}
+
+void PaletteInitDefault(Palette *pal) {
+    SetColors(pal, &gDefaultPalette[0][0], PALETTE_COLORS);
+    BuildEmphasis(pal);
+}
+
+/* Takes the usual .pal layouts: 64 RGB triplets, or all 512 with the
+ * emphasis variants already in them. */
+uint8_t PaletteLoad(Palette *pal, const char *path) {
+    /* One byte more than the biggest layout to notice longer files. */
+    uint8_t rgb[PALETTE_LUT_SIZE * 3 + 1];
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Couldn't open palette %s\n", path);
+        return 0;
+    }
+
+    size_t read = fread(rgb, 1, sizeof(rgb), file);
+    fclose(file);
+
+    if (read == PALETTE_LUT_SIZE * 3) {
+        SetColors(pal, rgb, PALETTE_LUT_SIZE);
+    } else if (read == PALETTE_COLORS * 3) {
+        SetColors(pal, rgb, PALETTE_COLORS);
+        BuildEmphasis(pal);
+    } else {
+        fprintf(stderr, "Palette %s should have 64 or 512 colors\n", path);
+        return 0;
+    }
+
+    return 1;
+}
+
+static void RowScalar(const uint32_t *lut, const uint8_t *indices, uint32_t *out, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i)
+        out[i] = lut[indices[i] & (PALETTE_COLORS - 1)];
+}
+
+#ifdef HAVE_AVX2_GATHER
+/* Eight pixels per gather, the LUT slice is only 256 bytes so it stays in L1. */
+__attribute__((target("avx2")))
+static void RowAvx2(const uint32_t *lut, const uint8_t *indices, uint32_t *out, uint32_t count) {
+    const __m256i colorMask = _mm256_set1_epi32(PALETTE_COLORS - 1);
+    uint32_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i bytes = _mm_loadl_epi64((const __m128i *)(indices + i));
+        __m256i index = _mm256_and_si256(_mm256_cvtepu8_epi32(bytes), colorMask);
+        __m256i colors = _mm256_i32gather_epi32((const int *)lut, index, 4);
+
+        _mm256_storeu_si256((__m256i *)(out + i), colors);
+    }
+
+    RowScalar(lut, indices + i, out + i, count - i);
+}
+#endif
+
+PaletteRowFn PaletteRowKernel(PALETTE_KERNEL kernel) {
+    PaletteRowFn avx2 = NULL;
+
+#ifdef HAVE_AVX2_GATHER
+    if (__builtin_cpu_supports("avx2"))
+        avx2 = RowAvx2;
+#endif
+
+    switch (kernel) {
+        case PALETTE_KERNEL_SCALAR:
+            return RowScalar;
+        case PALETTE_KERNEL_AVX2:
+            return avx2;
+        default:
+            return avx2 ? avx2 : RowScalar;
+    }
+}
+
+static PaletteRowFn gConvertRow;
+static pthread_once_t gConvertRowOnce = PTHREAD_ONCE_INIT;
+
+static void PickConvertRow(void) {
+    gConvertRow = PaletteRowKernel(PALETTE_KERNEL_AUTO);
+}
+
+void PaletteConvertFrame(const Palette *pal, const uint8_t *frameBuffer,
+                         const uint8_t *emphasis, uint32_t *out) {
+    pthread_once(&gConvertRowOnce, PickConvertRow);
+
+    for (uint16_t y = 0; y < PPU_HEIGHT; ++y) {
+        const uint32_t *lut = &pal->rgba[(emphasis[y] & (PALETTE_EMPHASIS_NUM - 1)) * PALETTE_COLORS];
+
+        gConvertRow(lut, frameBuffer + y * PPU_WIDTH, out + y * PPU_WIDTH, PPU_WIDTH);
+    }
+}
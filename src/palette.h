@@ -0,0 +1,35 @@
+#ifndef PALETTE_H_
+#define PALETTE_H_
+
+#include <stdint.h>
+
+#define PALETTE_COLORS 64
+#define PALETTE_EMPHASIS_NUM 8
+#define PALETTE_LUT_SIZE (PALETTE_COLORS * PALETTE_EMPHASIS_NUM)
+
+typedef struct _Palette {
+    /* Indexed by emphasis << 6 | color. Bytes in R, G, B, A order,
+     * whatever the host endianness. */
+    _Alignas(64) uint32_t rgba[PALETTE_LUT_SIZE];
+} Palette;
+
+typedef enum _PALETTE_KERNEL {
+    PALETTE_KERNEL_AUTO,
+    PALETTE_KERNEL_SCALAR,
+    PALETTE_KERNEL_AVX2
+} PALETTE_KERNEL;
+
+/* Converts count color indices to RGBA with a 64-entry slice of the LUT. */
+typedef void (*PaletteRowFn)(const uint32_t *lut, const uint8_t *indices, uint32_t *out, uint32_t count);
+
+void PaletteInitDefault(Palette *pal);
+uint8_t PaletteLoad(Palette *pal, const char *path);
+
+/* Returns NULL when the CPU can't run the kernel. */
+PaletteRowFn PaletteRowKernel(PALETTE_KERNEL kernel);
+
+/* Converts a whole PPU frame, each scanline with its own emphasis. */
+void PaletteConvertFrame(const Palette *pal, const uint8_t *frameBuffer,
+                         const uint8_t *emphasis, uint32_t *out);
+
+#endif
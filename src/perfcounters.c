@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfcounters.h"
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+
+typedef struct _CounterEvent {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} CounterEvent;
+
+static const CounterEvent gEvents[PERF_COUNTER_NUM] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,             "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,               "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,            "branch-misses"},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D), "l1d-misses"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,             "llc-misses"}
+};
+
+/* PERF_FORMAT_GROUP with both times: nr, enabled, running, then values. */
+typedef struct _GroupRead {
+    uint64_t nr;
+    uint64_t enabled;
+    uint64_t running;
+    uint64_t values[PERF_COUNTER_NUM];
+} GroupRead;
+
+static int32_t OpenEvent(const CounterEvent *event, int32_t group) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event->type;
+    attr.config = event->config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    /* Kernel time isn't the emulator's, and perf_event_paranoid 2 only
+     * allows counting user space anyway. */
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.disabled = group < 0;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+uint8_t PerfCountersOpen(PerfCounters *pc) {
+    pc->leader = -1;
+    pc->open = 0;
+
+    for (uint8_t i = 0; i < PERF_COUNTER_NUM; ++i) {
+        pc->fds[i] = OpenEvent(&gEvents[i], pc->leader);
+        if (pc->fds[i] < 0)
+            continue;
+
+        if (pc->leader < 0)
+            pc->leader = pc->fds[i];
+        pc->slots[i] = pc->open++;
+    }
+
+    if (pc->leader < 0)
+        return 0;
+
+    ioctl(pc->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(pc->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 1;
+}
+
+void PerfCountersClose(PerfCounters *pc) {
+    for (uint8_t i = 0; i < PERF_COUNTER_NUM; ++i) {
+        if (pc->fds[i] >= 0)
+            close(pc->fds[i]);
+        pc->fds[i] = -1;
+    }
+
+    pc->leader = -1;
+    pc->open = 0;
+}
+
+void PerfCountersRead(const PerfCounters *pc, PerfSample *sample) {
+    struct timespec ts;
+    GroupRead group;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    sample->nanoseconds = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    memset(sample->counts, 0, sizeof(sample->counts));
+
+    if (pc->leader < 0 || read(pc->leader, &group, sizeof(group)) < (ssize_t)(3 * sizeof(uint64_t)))
+        return;
+
+    /* When other users of the PMU push the group off now and then, the
+     * counts are scaled up to the time it was enabled. */
+    double scale = group.running && group.running < group.enabled
+                   ? (double)group.enabled / group.running : 1.0;
+
+    for (uint8_t i = 0; i < PERF_COUNTER_NUM; ++i) {
+        if (pc->fds[i] >= 0 && pc->slots[i] < group.nr)
+            sample->counts[i] = (uint64_t)(group.values[pc->slots[i]] * scale);
+    }
+}
+
+void PerfSampleAdd(PerfSample *total, const PerfSample *start, const PerfSample *end) {
+    for (uint8_t i = 0; i < PERF_COUNTER_NUM; ++i)
+        total->counts[i] += end->counts[i] - start->counts[i];
+
+    total->nanoseconds += end->nanoseconds - start->nanoseconds;
+}
+
+/* Appends to buf, keeping track of what's left. */
+static void Append(char **buf, size_t *size, const char *format, double value) {
+    int32_t n = snprintf(*buf, *size, format, value);
+
+    if (n < 0 || (size_t)n >= *size)
+        n = *size ? *size - 1 : 0;
+
+    *buf += n;
+    *size -= n;
+}
+
+void PerfCountersFormat(const PerfCounters *pc, const PerfSample *sample, uint64_t units,
+                        char *buf, size_t size) {
+    const uint64_t *counts = sample->counts;
+    double kiloInstructions = counts[PERF_INSTRUCTIONS] / 1000.0;
+
+    if (!units)
+        units = 1;
+
+    /* Units run from a pixel to a frame, hence the two scales. */
+    double ns = (double)sample->nanoseconds / units;
+    if (ns < 10000)
+        Append(&buf, &size, "%.1f ns", ns);
+    else
+        Append(&buf, &size, "%.1f us", ns / 1000);
+
+    if (pc->fds[PERF_INSTRUCTIONS] < 0 || !counts[PERF_INSTRUCTIONS])
+        return;
+
+    if (kiloInstructions / units < 10)
+        Append(&buf, &size, ", %.1f instr", (double)counts[PERF_INSTRUCTIONS] / units);
+    else
+        Append(&buf, &size, ", %.0f kI", kiloInstructions / units);
+    if (pc->fds[PERF_CYCLES] >= 0 && counts[PERF_CYCLES])
+        Append(&buf, &size, ", %.2f IPC", (double)counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES]);
+    if (pc->fds[PERF_BRANCH_MISSES] >= 0)
+        Append(&buf, &size, ", %.2f branch-miss/kI", counts[PERF_BRANCH_MISSES] / kiloInstructions);
+    if (pc->fds[PERF_L1D_MISSES] >= 0)
+        Append(&buf, &size, ", %.2f L1D-miss/kI", counts[PERF_L1D_MISSES] / kiloInstructions);
+    if (pc->fds[PERF_LLC_MISSES] >= 0)
+        Append(&buf, &size, ", %.3f LLC-miss/kI", counts[PERF_LLC_MISSES] / kiloInstructions);
+}
+
+const char *PerfCounterName(PERF_COUNTER counter) {
+    return gEvents[counter].name;
+}
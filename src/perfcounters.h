@@ -0,0 +1,50 @@
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum _PERF_COUNTER {
+    PERF_INSTRUCTIONS,
+    PERF_CYCLES,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,    /* L1 data cache read misses */
+    PERF_LLC_MISSES,    /* Last level cache misses */
+    PERF_COUNTER_NUM
+} PERF_COUNTER;
+
+/* Counter values and wall time in nanoseconds, either read at one point or
+ * added up over stretches between two. */
+typedef struct _PerfSample {
+    uint64_t counts[PERF_COUNTER_NUM];
+    uint64_t nanoseconds;
+} PerfSample;
+
+/* Host hardware counters of the calling thread, user space only, opened
+ * as one perf_event_open group so a read is one syscall and every counter
+ * covers the same stretch. Counters the kernel or the CPU won't give are
+ * left out, and with none at all a read still gives wall time. */
+typedef struct _PerfCounters {
+    int32_t leader;
+    /* The file descriptor of each counter, -1 when it's missing. */
+    int32_t fds[PERF_COUNTER_NUM];
+    /* Where each counter comes in the group read. */
+    uint8_t slots[PERF_COUNTER_NUM];
+    uint8_t open;
+} PerfCounters;
+
+/* Returns 0 when no counter could be opened, which leaves wall time. */
+uint8_t PerfCountersOpen(PerfCounters *pc);
+void PerfCountersClose(PerfCounters *pc);
+
+void PerfCountersRead(const PerfCounters *pc, PerfSample *sample);
+/* Adds end - start to total. */
+void PerfSampleAdd(PerfSample *total, const PerfSample *start, const PerfSample *end);
+
+/* "275.2 us, 253 kI, 2.41 IPC, 3.20 branch-miss/kI, ..." for sample
+ * averaged over units, leaving out what pc doesn't count. */
+void PerfCountersFormat(const PerfCounters *pc, const PerfSample *sample, uint64_t units,
+                        char *buf, size_t size);
+const char *PerfCounterName(PERF_COUNTER counter);
+
+#endif
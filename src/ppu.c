@@ -4,6 +4,8 @@
 #include "ppu.h"
 #include "memory.h"
 #include "cpu.h"
+#include "renderer.h"
+#include "trace.h"
 
 #define VISIBLE_SCANLINE_END         239
 #define POST_RENDER_SCANLINE         240
@@ -11,6 +13,33 @@
 #define VERTICAL_BLANKING_LINES_END  260
 #define LAST_CYCLE                   341
 #define SCANLINE_MAX                 262
+#define FRAME_DOTS                   (LAST_CYCLE * SCANLINE_MAX)
+
+/* The whole scanline is produced at once at this dot. */
+#define SCANLINE_RENDER_CYCLE        256
+
+#define SPRITES_PER_SCANLINE 8
+#define TILES_PER_ROW        32
+#define NAMETABLE_ADDR       0x2000
+#define ATTRIBUTE_TABLE_OFF  0x3C0
+#define PALETTE_ADDR         0x3F00
+#define SPRITE_PALETTE_OFF   0x10
+
+#define SPRITE_ATTR_PALETTE  0x03
+#define SPRITE_ATTR_BEHIND   0x20
+#define SPRITE_ATTR_FLIP_H   0x40
+#define SPRITE_ATTR_FLIP_V   0x80
+
+/* Bits of v and t: yyy NN YYYYY XXXXX, fine Y, nametable, coarse Y and X. */
+#define VRAM_ADDR_MASK       0x3FFF
+#define LOOPY_COARSE_X       0x001F
+#define LOOPY_COARSE_Y       0x03E0
+#define LOOPY_NAMETABLE      0x0C00
+#define LOOPY_FINE_Y         0x7000
+#define LOOPY_MASK           0x7FFF
+
+#define PPUSTATUS_FLAGS      0xE0
+#define PALETTE_ENTRY_MASK   0x3F
 
 static void PreRenderScanline(Ppu *ppu);
 static void VisibleScanlines(Ppu *ppu);
@@ -20,6 +49,9 @@ static void PostRenderScanline(Ppu *ppu);
 void PpuInit(Ppu *ppu, Memory *mem, uint64_t *totalCycles) {
     ppu->mem = mem;
     memset(ppu->oamMemory, 0, OAM_ENTRY_NUM * sizeof(OAMEntry));
+    mem->ppu = ppu;
+    memset(ppu->frameBuffer, 0, PPU_WIDTH * PPU_HEIGHT);
+    memset(ppu->emphasis, 0, PPU_HEIGHT);
 
     ppu->oddFrame = 0;
     ppu->scanline = SCANLINE_MAX - 1;
@@ -27,7 +59,24 @@ void PpuInit(Ppu *ppu, Memory *mem, uint64_t *totalCycles) {
 
     ppu->totalCycles = totalCycles;
 
+    ppu->ctrl = 0;
+    ppu->mask = 0;
+    ppu->status = 0;
+    ppu->oamAddr = 0;
+    ppu->v = 0;
+    ppu->t = 0;
+    ppu->x = 0;
+    ppu->w = 0;
+    ppu->dataBuffer = 0;
+    ppu->bus = 0;
+
     ppu->needsNmi = 0;
+
+    ppu->frameComplete = 0;
+    ppu->frame = 0;
+    ppu->renderPixels = 1;
+    ppu->renderingFrame = 1;
+    ppu->renderer = NULL;
 }
 
 void PpuEmulate(Ppu *ppu) {
@@ -36,19 +85,21 @@ void PpuEmulate(Ppu *ppu) {
     } else if (ppu->scanline == POST_RENDER_SCANLINE) {
         PostRenderScanline(ppu);
     } else if (ppu->scanline <= VERTICAL_BLANKING_LINES_END) {
-        if (ppu->scanline == FIRST_VERTICAL_BLANKING_LINE && ppu->cycle == 0)
-            SetPpuRegisterBit(ppu->mem, PPUSTATUS, PPUSTATUS_VERTICAL_BLANK_STARTED_BIT, 1);
-        
-        // This only needs to run once each VBlank Period.
-        if (ppu->mem->ppustatusRead) {
-            SetPpuRegisterBit(ppu->mem, PPUSTATUS, PPUSTATUS_VERTICAL_BLANK_STARTED_BIT, 0);
-            ppu->mem->ppustatusRead = 0;
-        }        
-        
+        if (ppu->scanline == FIRST_VERTICAL_BLANKING_LINE && ppu->cycle == 0) {
+            ppu->status |= PPUSTATUS_VERTICAL_BLANK_STARTED_BIT;
+            if (ppu->mem->trace)
+                TraceLog(ppu->mem->trace, TRACE_VBLANK_START, 0, 0);
+            if (ppu->ctrl & PPUCTRL_GENERATE_NMI_AT_VBLANK_BIT)
+                ppu->needsNmi = 1;
+        }
+
         VerticalBlankingLines(ppu);
     } else { /* scanline == 261 */
         if (ppu->cycle == 0) {
-            SetPpuRegisterBit(ppu->mem, PPUSTATUS, PPUSTATUS_VERTICAL_BLANK_STARTED_BIT, 0);
+            ppu->status &= ~(PPUSTATUS_VERTICAL_BLANK_STARTED_BIT | PPUSTATUS_SPRITE_0_HIT_BIT |
+                             PPUSTATUS_SPRITE_OVERFLOW_BIT);
+            if (ppu->mem->trace)
+                TraceLog(ppu->mem->trace, TRACE_VBLANK_END, 0, 0);
         }
 
         PreRenderScanline(ppu);
@@ -59,25 +110,449 @@ void PpuEmulate(Ppu *ppu) {
         ppu->scanline = (ppu->scanline + 1) % SCANLINE_MAX;
         ppu->cycle = 0;
     }
+}
+
+/* The first dot at or after cycle on scanline where PpuEmulate does
+ * anything, or LAST_CYCLE. Past the visible lines, that is only the first
+ * dot of the post-render, first VBlank and pre-render lines. */
+static uint16_t NextEvent(uint16_t scanline, uint16_t cycle) {
+    if (scanline <= VISIBLE_SCANLINE_END)
+        return cycle <= SCANLINE_RENDER_CYCLE ? SCANLINE_RENDER_CYCLE : LAST_CYCLE;
+
+    if (scanline <= FIRST_VERTICAL_BLANKING_LINE || scanline == SCANLINE_MAX - 1)
+        return cycle == 0 ? 0 : LAST_CYCLE;
 
-    ppu->needsNmi = GetPpuRegisterBit(ppu->mem, PPUCTRL, PPUCTRL_GENERATE_NMI_AT_VBLANK_BIT) && 
-                    GetPpuRegisterBit(ppu->mem, PPUSTATUS, PPUSTATUS_VERTICAL_BLANK_STARTED_BIT);
+    return LAST_CYCLE;
 }
 
-static void PreRenderScanline(Ppu *ppu) {
+uint32_t PpuIdleDots(const Ppu *ppu, uint8_t statusRead) {
+    uint32_t dot = ppu->scanline * LAST_CYCLE + ppu->cycle;
+    uint32_t dots = (POST_RENDER_SCANLINE * LAST_CYCLE + FRAME_DOTS - dot) % FRAME_DOTS;
+
+    /* With NMIs on, the one at VBlank interrupts the loop. */
+    if (ppu->ctrl & PPUCTRL_GENERATE_NMI_AT_VBLANK_BIT) {
+        uint32_t toNmi = (FIRST_VERTICAL_BLANKING_LINE * LAST_CYCLE + FRAME_DOTS - dot) % FRAME_DOTS;
 
+        if (toNmi < dots)
+            dots = toNmi;
+    }
+
+    if (statusRead) {
+        uint16_t scanline = ppu->scanline;
+        uint16_t cycle = ppu->cycle;
+        uint32_t toEvent = 0;
+        uint16_t next;
+
+        while ((next = NextEvent(scanline, cycle)) == LAST_CYCLE) {
+            toEvent += LAST_CYCLE - cycle;
+            scanline = (scanline + 1) % SCANLINE_MAX;
+            cycle = 0;
+        }
+
+        toEvent += next - cycle;
+        if (toEvent < dots)
+            dots = toEvent;
+    }
+
+    return dots;
 }
 
-static void VisibleScanlines(Ppu *ppu) {
-    if (ppu->cycle >= 1 && ppu->cycle <= 256) {
+void PpuSkip(Ppu *ppu, uint32_t dots) {
+    while (dots) {
+        uint16_t next = NextEvent(ppu->scanline, ppu->cycle);
 
+        if (next == ppu->cycle) {
+            PpuEmulate(ppu);
+            --dots;
+            continue;
+        }
+
+        uint32_t quiet = next - ppu->cycle;
+        if (quiet > dots)
+            quiet = dots;
+
+        ppu->cycle += quiet;
+        dots -= quiet;
+
+        if (ppu->cycle == LAST_CYCLE) {
+            ppu->scanline = (ppu->scanline + 1) % SCANLINE_MAX;
+            ppu->cycle = 0;
+        }
     }
 }
 
+static void IncrementVramAddr(Ppu *ppu) {
+    ppu->v = (ppu->v + (ppu->ctrl & PPUCTRL_VRAM_ADDR_INCREMENT_BIT ? TILES_PER_ROW : 1)) & LOOPY_MASK;
+}
+
+/* Palette reads skip the buffer, which gets the nametable byte under them. */
+static uint8_t ReadVram(Ppu *ppu) {
+    uint16_t addr = ppu->v & VRAM_ADDR_MASK;
+    uint8_t byte = ppu->dataBuffer;
+
+    if (addr >= PALETTE_ADDR) {
+        byte = (ppu->bus & ~PALETTE_ENTRY_MASK) | ReadPpuByte(ppu->mem, addr);
+        ppu->dataBuffer = ReadPpuByte(ppu->mem, addr - 0x1000);
+    } else {
+        ppu->dataBuffer = ReadPpuByte(ppu->mem, addr);
+    }
+
+    IncrementVramAddr(ppu);
+    return byte;
+}
+
+uint8_t PpuReadRegister(Ppu *ppu, uint16_t addr) {
+    uint8_t byte = ppu->bus;
+
+    switch (addr) {
+        case PPUSTATUS:
+            byte = ppu->status | (ppu->bus & ~PPUSTATUS_FLAGS);
+            ppu->status &= ~PPUSTATUS_VERTICAL_BLANK_STARTED_BIT;
+            ppu->w = 0;
+
+            if (ppu->renderer)
+                RendererLog(ppu->renderer, RENDER_READ, addr, 0);
+            break;
+        case OAMDATA:
+            byte = ((uint8_t *)ppu->oamMemory)[ppu->oamAddr];
+            break;
+        case PPUDATA:
+            byte = ReadVram(ppu);
+
+            if (ppu->renderer)
+                RendererLog(ppu->renderer, RENDER_READ, addr, 0);
+            break;
+        default:
+            break;
+    }
+
+    ppu->bus = byte;
+
+    if (ppu->mem->trace)
+        TraceLog(ppu->mem->trace, TRACE_PPU_READ, addr, byte);
+
+    return byte;
+}
+
+void PpuWriteRegister(Ppu *ppu, uint16_t addr, uint8_t byte) {
+    ppu->bus = byte;
+
+    if (ppu->renderer)
+        RendererLog(ppu->renderer, RENDER_WRITE, addr, byte);
+    if (ppu->mem->trace)
+        TraceLog(ppu->mem->trace, TRACE_PPU_WRITE, addr, byte);
+
+    switch (addr) {
+        case PPUCTRL:
+            /* Turning NMIs on during VBlank raises one right away. */
+            if (!(ppu->ctrl & PPUCTRL_GENERATE_NMI_AT_VBLANK_BIT) &&
+                (byte & PPUCTRL_GENERATE_NMI_AT_VBLANK_BIT) &&
+                (ppu->status & PPUSTATUS_VERTICAL_BLANK_STARTED_BIT))
+                ppu->needsNmi = 1;
+
+            ppu->ctrl = byte;
+            ppu->t = (ppu->t & ~LOOPY_NAMETABLE) | ((byte & PPUCTRL_BASE_NAMETABLE_ADDR_BITS) << 10);
+            break;
+        case PPUMASK:
+            ppu->mask = byte;
+            break;
+        case OAMADDR:
+            ppu->oamAddr = byte;
+            break;
+        case OAMDATA:
+            ((uint8_t *)ppu->oamMemory)[ppu->oamAddr++] = byte;
+            break;
+        case PPUSCROLL:
+            if (!ppu->w) {
+                ppu->t = (ppu->t & ~LOOPY_COARSE_X) | (byte >> 3);
+                ppu->x = byte & 7;
+            } else {
+                ppu->t = (ppu->t & ~(LOOPY_FINE_Y | LOOPY_COARSE_Y)) |
+                         ((uint16_t)(byte & 7) << 12) | ((uint16_t)(byte & 0xF8) << 2);
+            }
+            ppu->w ^= 1;
+            break;
+        case PPUADDR:
+            if (!ppu->w) {
+                ppu->t = (ppu->t & 0x00FF) | ((uint16_t)(byte & 0x3F) << 8);
+            } else {
+                ppu->t = (ppu->t & 0xFF00) | byte;
+                ppu->v = ppu->t;
+            }
+            ppu->w ^= 1;
+            break;
+        case PPUDATA:
+            WritePpuByte(ppu->mem, ppu->v & VRAM_ADDR_MASK, byte);
+            IncrementVramAddr(ppu);
+            break;
+        default:
+            break;
+    }
+}
+
+void PpuOamDma(Ppu *ppu, const uint8_t *page) {
+    uint8_t *oam = (uint8_t *)ppu->oamMemory;
+    uint8_t start = ppu->oamAddr;
+
+    memcpy(oam + start, page, OAM_SIZE - start);
+    memcpy(oam, page + OAM_SIZE - start, start);
+
+    if (ppu->renderer) {
+        for (uint16_t i = 0; i < OAM_SIZE; ++i)
+            RendererLog(ppu->renderer, RENDER_WRITE, OAMDATA, page[i]);
+    }
+}
+
+uint8_t PpuPeekRegister(const Ppu *ppu, uint16_t addr) {
+    uint16_t vramAddr = ppu->v & VRAM_ADDR_MASK;
+
+    switch (addr) {
+        case PPUSTATUS:
+            return ppu->status | (ppu->bus & ~PPUSTATUS_FLAGS);
+        case OAMDATA:
+            return ((const uint8_t *)ppu->oamMemory)[ppu->oamAddr];
+        case PPUDATA:
+            if (vramAddr >= PALETTE_ADDR)
+                return (ppu->bus & ~PALETTE_ENTRY_MASK) | PeekPpuByte(ppu->mem, vramAddr);
+            return ppu->dataBuffer;
+        default:
+            return ppu->bus;
+    }
+}
+
+static uint8_t SpriteHeight(Ppu *ppu) {
+    return ppu->ctrl & PPUCTRL_SPRITE_SIZE_BIT ? 16 : 8;
+}
+
+/* Writes the 2-bit pattern value of each pixel in a tile row, leftmost first. */
+static void FetchPatternRow(Ppu *ppu, uint16_t tableAddr, uint8_t tile, uint8_t row, uint8_t out[8]) {
+    uint16_t addr = tableAddr + (uint16_t)tile * 16 + row;
+    uint8_t lo = ReadPpuByte(ppu->mem, addr);
+    uint8_t hi = ReadPpuByte(ppu->mem, addr + 8);
+
+    for (uint8_t i = 0; i < 8; ++i) {
+        uint8_t bit = 7 - i;
+        out[i] = ((lo >> bit) & 1) | (((hi >> bit) & 1) << 1);
+    }
+}
+
+/* Background palette RAM offsets (0 is transparent) for one tile of scanline y. */
+static void FetchBackgroundTile(Ppu *ppu, uint16_t y, uint8_t tileX, uint8_t out[8]) {
+    uint8_t base = ppu->ctrl & PPUCTRL_BASE_NAMETABLE_ADDR_BITS;
+    uint16_t nametable = NAMETABLE_ADDR + NAMETABLE_SIZE * base;
+    uint16_t patternTable = ppu->ctrl & PPUCTRL_BG_PATTERN_TABLE_ADDR_BIT ? 0x1000 : 0;
+    uint8_t tileY = y / 8;
+
+    uint8_t tile = ReadPpuByte(ppu->mem, nametable + tileY * TILES_PER_ROW + tileX);
+    uint8_t attr = ReadPpuByte(ppu->mem, nametable + ATTRIBUTE_TABLE_OFF + (tileY / 4) * 8 + tileX / 4);
+    uint8_t shift = ((tileY & 2) << 1) | (tileX & 2);
+    uint8_t palette = ((attr >> shift) & 3) << 2;
+
+    FetchPatternRow(ppu, patternTable, tile, y & 7, out);
+
+    for (uint8_t i = 0; i < 8; ++i)
+        out[i] = out[i] ? palette | out[i] : 0;
+}
+
+/* Sprite palette RAM offsets (0 is transparent) of one OAM entry's row, already flipped. */
+static void FetchSpriteRow(Ppu *ppu, const OAMEntry *sprite, uint8_t row, uint8_t out[8]) {
+    uint8_t height = SpriteHeight(ppu);
+    uint8_t tile = sprite->tileNumber;
+    uint16_t patternTable;
+
+    if (sprite->spriteAttr & SPRITE_ATTR_FLIP_V)
+        row = height - 1 - row;
+
+    if (height == 16) {
+        patternTable = (tile & 1) ? 0x1000 : 0;
+        tile = (tile & 0xFE) + (row >= 8);
+        row &= 7;
+    } else {
+        patternTable = ppu->ctrl & PPUCTRL_SPRITE_PATTER_TABLE_ADDR_BIT ? 0x1000 : 0;
+    }
+
+    uint8_t pattern[8];
+    FetchPatternRow(ppu, patternTable, tile, row, pattern);
+
+    uint8_t palette = SPRITE_PALETTE_OFF | ((sprite->spriteAttr & SPRITE_ATTR_PALETTE) << 2);
+    for (uint8_t i = 0; i < 8; ++i) {
+        uint8_t c = pattern[(sprite->spriteAttr & SPRITE_ATTR_FLIP_H) ? 7 - i : i];
+        out[i] = c ? palette | c : 0;
+    }
+}
+
+/* Picks up to 8 sprites on scanline y, in OAM order, and sets the overflow flag. */
+static uint8_t EvaluateSprites(Ppu *ppu, uint16_t y, uint8_t found[SPRITES_PER_SCANLINE]) {
+    uint8_t height = SpriteHeight(ppu);
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < OAM_ENTRY_NUM; ++i) {
+        /* OAM holds the sprite's top minus one. */
+        uint16_t row = y - (ppu->oamMemory[i].y + 1);
+
+        if (row >= height)
+            continue;
+
+        if (count == SPRITES_PER_SCANLINE) {
+            ppu->status |= PPUSTATUS_SPRITE_OVERFLOW_BIT;
+            break;
+        }
+
+        found[count++] = i;
+    }
+
+    return count;
+}
+
+static uint8_t ShowLeftmost(Ppu *ppu, uint8_t bit, uint16_t x) {
+    return x >= 8 || (ppu->mask & bit);
+}
+
+static void CheckSprite0Hit(Ppu *ppu, uint16_t y, const uint8_t *bgLine) {
+    const OAMEntry *sprite = &ppu->oamMemory[0];
+    uint8_t sprite0[8];
+    uint8_t fetched[PPU_WIDTH];
+
+    if (ppu->status & PPUSTATUS_SPRITE_0_HIT_BIT)
+        return;
+
+    FetchSpriteRow(ppu, sprite, y - (sprite->y + 1), sprite0);
+
+    /* Without a rendered line, only fetch the tiles under sprite 0. */
+    if (!bgLine) {
+        uint8_t tileX = sprite->x / 8;
+
+        FetchBackgroundTile(ppu, y, tileX, fetched + tileX * 8);
+        if (tileX + 1 < TILES_PER_ROW)
+            FetchBackgroundTile(ppu, y, tileX + 1, fetched + (tileX + 1) * 8);
+
+        bgLine = fetched;
+    }
+
+    for (uint8_t i = 0; i < 8; ++i) {
+        uint16_t x = sprite->x + i;
+
+        if (x == PPU_WIDTH - 1)
+            break;
+
+        if (sprite0[i] && bgLine[x] &&
+            ShowLeftmost(ppu, PPUMASK_BG_LEFTMOST_8PIXELS_BIT, x) &&
+            ShowLeftmost(ppu, PPUMASK_SPRITES_LEFTMOST_8PIXELS_BIT, x)) {
+            ppu->status |= PPUSTATUS_SPRITE_0_HIT_BIT;
+            if (ppu->mem->trace)
+                TraceLog(ppu->mem->trace, TRACE_SPRITE0_HIT, 0, 0);
+            return;
+        }
+    }
+}
+
+/* Keeps the status flags a game can observe current, and fills in the
+ * scanline's pixels only when the frame is being rendered. */
+static void RenderScanline(Ppu *ppu, uint16_t y) {
+    uint8_t showBg = (ppu->mask & PPUMASK_BG_BIT) != 0;
+    uint8_t showSprites = (ppu->mask & PPUMASK_SPRITES_BIT) != 0;
+    uint8_t sprites[SPRITES_PER_SCANLINE];
+    uint8_t spriteCount = 0;
+    uint8_t hasSprite0 = 0;
+
+    if (showBg || showSprites) {
+        spriteCount = EvaluateSprites(ppu, y, sprites);
+        hasSprite0 = spriteCount && sprites[0] == 0;
+    }
+
+    /* The renderer draws the line from the logged state at this point, the
+     * flags are worked out here as when not rendering. */
+    if (ppu->renderer && ppu->renderingFrame)
+        RendererLog(ppu->renderer, RENDER_LINE, y, 0);
+
+    if (!ppu->renderingFrame || ppu->renderer) {
+        if (hasSprite0 && showBg && showSprites)
+            CheckSprite0Hit(ppu, y, NULL);
+        return;
+    }
+
+    uint8_t bgLine[PPU_WIDTH];
+    uint8_t spriteLine[PPU_WIDTH];
+    uint8_t behindLine[PPU_WIDTH];
+    uint8_t palette[32];
+    uint8_t mask = ppu->mask;
+    uint8_t colorMask = mask & PPUMASK_GREYSCALE_BIT ? 0x30 : 0x3F;
+
+    for (uint8_t i = 0; i < 32; ++i)
+        palette[i] = ReadPpuByte(ppu->mem, PALETTE_ADDR + i) & colorMask;
+
+    ppu->emphasis[y] = mask >> 5;
+
+    memset(bgLine, 0, PPU_WIDTH);
+    memset(spriteLine, 0, PPU_WIDTH);
+    memset(behindLine, 0, PPU_WIDTH);
+
+    if (showBg) {
+        for (uint8_t tileX = 0; tileX < TILES_PER_ROW; ++tileX)
+            FetchBackgroundTile(ppu, y, tileX, bgLine + tileX * 8);
+
+        if (!(ppu->mask & PPUMASK_BG_LEFTMOST_8PIXELS_BIT))
+            memset(bgLine, 0, 8);
+    }
+
+    /* Lower OAM indices win, so draw back to front. */
+    for (int8_t i = spriteCount - 1; i >= 0 && showSprites; --i) {
+        const OAMEntry *sprite = &ppu->oamMemory[sprites[i]];
+        uint8_t row[8];
+
+        FetchSpriteRow(ppu, sprite, y - (sprite->y + 1), row);
+
+        for (uint8_t j = 0; j < 8 && sprite->x + j < PPU_WIDTH; ++j) {
+            uint16_t x = sprite->x + j;
+
+            if (!row[j] || !ShowLeftmost(ppu, PPUMASK_SPRITES_LEFTMOST_8PIXELS_BIT, x))
+                continue;
+
+            spriteLine[x] = row[j];
+            behindLine[x] = (sprite->spriteAttr & SPRITE_ATTR_BEHIND) != 0;
+        }
+    }
+
+    if (hasSprite0 && showBg && showSprites)
+        CheckSprite0Hit(ppu, y, bgLine);
+
+    uint8_t *out = &ppu->frameBuffer[y * PPU_WIDTH];
+    for (uint16_t x = 0; x < PPU_WIDTH; ++x) {
+        uint8_t bg = bgLine[x];
+        uint8_t sp = spriteLine[x];
+        uint8_t index;
+
+        if (sp && (!bg || !behindLine[x]))
+            index = sp;
+        else
+            index = bg;
+
+        out[x] = palette[index];
+    }
+}
+
+void PpuRenderScanline(Ppu *ppu, uint16_t y) {
+    RenderScanline(ppu, y);
+}
+
+static void PreRenderScanline(Ppu *ppu) {
+    if (ppu->cycle == 0)
+        ppu->renderingFrame = ppu->renderPixels;
+}
+
+static void VisibleScanlines(Ppu *ppu) {
+    if (ppu->cycle == SCANLINE_RENDER_CYCLE)
+        RenderScanline(ppu, ppu->scanline);
+}
+
 static void VerticalBlankingLines(Ppu *ppu) {
     /*puts("vertical_blanking_lines");*/
+    (void)ppu;
 }
 
 static void PostRenderScanline(Ppu *ppu) {
-    /*puts("post_render_scanline");*/
-}
\ No newline at end of file
+    if (ppu->cycle == 0) {
+        ppu->frameComplete = 1;
+        ++ppu->frame;
+    }
+}
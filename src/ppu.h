@@ -5,7 +5,11 @@
 
 #define OAM_ENTRY_NUM 64
 
+#define PPU_WIDTH  256
+#define PPU_HEIGHT 240
+
 typedef struct _Memory Memory;
+typedef struct _Renderer Renderer;
 
 typedef struct _OAMEntry {
     uint8_t y;
@@ -18,15 +22,69 @@ typedef struct _Ppu {
     Memory *mem;
     OAMEntry oamMemory[OAM_ENTRY_NUM];
 
+    /* One 6-bit color index per pixel, greyscale already applied, and the
+     * PPUMASK emphasis bits (>> 5) each scanline was drawn with. */
+    uint8_t frameBuffer[PPU_WIDTH * PPU_HEIGHT];
+    uint8_t emphasis[PPU_HEIGHT];
+
     uint8_t oddFrame;
     uint16_t scanline;
     uint16_t cycle;
     uint64_t *totalCycles;
 
+    /* The registers behind $2000-$2007. v and t are the current and
+     * temporary VRAM addresses, x the fine X scroll and w the write toggle
+     * $2005 and $2006 share. bus is the last value put on the data lines,
+     * which is what the bits a read doesn't drive come back as. */
+    uint8_t ctrl;
+    uint8_t mask;
+    uint8_t status;
+    uint8_t oamAddr;
+    uint16_t v;
+    uint16_t t;
+    uint8_t x;
+    uint8_t w;
+    uint8_t dataBuffer;
+    uint8_t bus;
+
+    /* Raised on the rising edge of VBlank && NMI enable, cleared by
+     * whoever passes it on to the CPU. */
     uint8_t needsNmi;
+
+    /* Set when the last visible scanline is done. */
+    uint8_t frameComplete;
+    uint64_t frame;
+
+    /* When clear, the PPU still keeps VBlank, sprite 0 hit and sprite
+     * overflow up to date but doesn't generate pixels, leaving the previous
+     * picture in frameBuffer. Latched at the pre-render scanline. */
+    uint8_t renderPixels;
+    uint8_t renderingFrame;
+
+    /* When set, pixels are drawn on the renderer's thread instead. */
+    Renderer *renderer;
 } Ppu;
 
 void PpuInit(Ppu *ppu, Memory *mem, uint64_t *totalCycles);
 void PpuEmulate(Ppu *ppu);
 
+/* CPU accesses to $2000-$2007, addr already folded down to that range. */
+uint8_t PpuReadRegister(Ppu *ppu, uint16_t addr);
+void PpuWriteRegister(Ppu *ppu, uint16_t addr, uint8_t byte);
+/* What a read would return, without clearing VBlank or moving v. */
+uint8_t PpuPeekRegister(const Ppu *ppu, uint16_t addr);
+/* $4014: a page copied through OAMDATA, starting at OAMADDR. */
+void PpuOamDma(Ppu *ppu, const uint8_t *page);
+
+/* Draws scanline y into frameBuffer from the current state, for a
+ * Renderer's copy of the PPU. */
+void PpuRenderScanline(Ppu *ppu, uint16_t y);
+
+/* How many dots the PPU can run while the CPU sits in an idle loop before
+ * the frame ends, an NMI fires or, with statusRead, PPUSTATUS may change. */
+uint32_t PpuIdleDots(const Ppu *ppu, uint8_t statusRead);
+/* Same as calling PpuEmulate dots times with the CPU idle, but jumps
+ * straight over the dots where nothing happens. */
+void PpuSkip(Ppu *ppu, uint32_t dots);
+
 #endif
@@ -0,0 +1,280 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiler.h"
+
+#define ADDR_NUM 65536
+#define LABEL_LINE_SIZE 256
+#define NAME_SIZE 64
+#define INITIAL_NODES 1024
+
+Profiler *ProfilerCreate(void) {
+    Profiler *prof = malloc(sizeof(Profiler));
+
+    if (!prof)
+        return NULL;
+
+    prof->nodes = malloc(INITIAL_NODES * sizeof(ProfileNode));
+    if (!prof->nodes) {
+        free(prof);
+        return NULL;
+    }
+
+    prof->nodeCapacity = INITIAL_NODES;
+    prof->nodeCount = 1;
+    memset(&prof->nodes[0], 0, sizeof(ProfileNode));
+
+    prof->stack[0].node = 0;
+    prof->stack[0].sp = 0xFF;
+    prof->depth = 1;
+    prof->charged = 0;
+    prof->labels = NULL;
+
+    return prof;
+}
+
+void ProfilerDestroy(Profiler *prof) {
+    if (prof->labels) {
+        for (uint32_t i = 0; i < ADDR_NUM; ++i)
+            free(prof->labels[i]);
+        free(prof->labels);
+    }
+
+    free(prof->nodes);
+    free(prof);
+}
+
+uint8_t ProfilerLoadLabels(Profiler *prof, const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[LABEL_LINE_SIZE];
+
+    if (!file) {
+        fprintf(stderr, "Couldn't open label file %s\n", path);
+        return 0;
+    }
+
+    if (!prof->labels)
+        prof->labels = calloc(ADDR_NUM, sizeof(char *));
+    if (!prof->labels) {
+        fprintf(stderr, "Not enough memory for labels\n");
+        fclose(file);
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        char *text = line;
+        char *end;
+
+        if (strncmp(text, "al ", 3) == 0)
+            text += 3;
+        if (*text == '$')
+            ++text;
+
+        unsigned long addr = strtoul(text, &end, 16);
+        if (end == text || addr >= ADDR_NUM)
+            continue;
+
+        while (isspace((unsigned char)*end))
+            ++end;
+        if (*end == '.')
+            ++end;
+
+        size_t length = strcspn(end, " \t\r\n");
+        if (!length || prof->labels[addr])
+            continue;
+
+        prof->labels[addr] = strndup(end, length);
+        if (!prof->labels[addr]) {
+            fprintf(stderr, "Not enough memory for labels\n");
+            fclose(file);
+            return 0;
+        }
+    }
+
+    fclose(file);
+    return 1;
+}
+
+void ProfilerCharge(Profiler *prof, uint64_t cycle) {
+    prof->nodes[prof->stack[prof->depth - 1].node].self += cycle - prof->charged;
+    prof->charged = cycle;
+}
+
+void ProfilerReset(Profiler *prof, uint16_t entry, uint64_t cycle) {
+    ProfilerUnwind(prof, cycle);
+    prof->nodes[0].addr = entry;
+    ++prof->nodes[0].calls;
+}
+
+void ProfilerUnwind(Profiler *prof, uint64_t cycle) {
+    ProfilerCharge(prof, cycle);
+    prof->depth = 1;
+}
+
+/* The child of parent for addr, made on first use. Found children move to
+ * the front, which keeps the usual callees a step or two away. */
+static uint32_t Child(Profiler *prof, uint32_t parent, uint16_t addr) {
+    ProfileNode *nodes = prof->nodes;
+    uint32_t prev = 0;
+
+    for (uint32_t i = nodes[parent].child; i; prev = i, i = nodes[i].sibling) {
+        if (nodes[i].addr != addr)
+            continue;
+
+        if (prev) {
+            nodes[prev].sibling = nodes[i].sibling;
+            nodes[i].sibling = nodes[parent].child;
+            nodes[parent].child = i;
+        }
+        return i;
+    }
+
+    if (prof->nodeCount == PROFILER_MAX_NODES)
+        return parent;
+
+    if (prof->nodeCount == prof->nodeCapacity) {
+        ProfileNode *grown = realloc(nodes, 2 * prof->nodeCapacity * sizeof(ProfileNode));
+        if (!grown)
+            return parent;
+
+        prof->nodes = nodes = grown;
+        prof->nodeCapacity *= 2;
+    }
+
+    uint32_t node = prof->nodeCount++;
+    nodes[node].addr = addr;
+    nodes[node].parent = parent;
+    nodes[node].child = 0;
+    nodes[node].sibling = nodes[parent].child;
+    nodes[node].self = 0;
+    nodes[node].calls = 0;
+    nodes[parent].child = node;
+
+    return node;
+}
+
+void ProfilerCall(Profiler *prof, uint16_t entry, uint8_t sp, uint64_t cycle) {
+    ProfilerCharge(prof, cycle);
+
+    if (prof->depth == PROFILER_MAX_DEPTH)
+        return;
+
+    uint32_t node = Child(prof, prof->stack[prof->depth - 1].node, entry);
+    ++prof->nodes[node].calls;
+
+    prof->stack[prof->depth].node = node;
+    prof->stack[prof->depth].sp = sp;
+    ++prof->depth;
+}
+
+void ProfilerReturn(Profiler *prof, uint8_t sp, uint64_t cycle) {
+    ProfilerCharge(prof, cycle);
+
+    while (prof->depth > 1 && prof->stack[prof->depth - 1].sp <= sp)
+        --prof->depth;
+}
+
+static const char *Name(const Profiler *prof, uint16_t addr, char *buffer) {
+    if (prof->labels && prof->labels[addr])
+        return prof->labels[addr];
+
+    snprintf(buffer, NAME_SIZE, "$%04X", addr);
+    return buffer;
+}
+
+static void WritePath(const Profiler *prof, uint32_t node, FILE *out) {
+    char buffer[NAME_SIZE];
+
+    if (node)
+        WritePath(prof, prof->nodes[node].parent, out);
+
+    fprintf(out, "%s%s", node ? ";" : "", Name(prof, prof->nodes[node].addr, buffer));
+}
+
+uint8_t ProfilerWriteFolded(const Profiler *prof, FILE *out) {
+    for (uint32_t i = 0; i < prof->nodeCount; ++i) {
+        if (!prof->nodes[i].self)
+            continue;
+
+        WritePath(prof, i, out);
+        fprintf(out, " %lu\n", prof->nodes[i].self);
+    }
+
+    return 1;
+}
+
+typedef struct _RoutineTotal {
+    uint16_t addr;
+    uint64_t inclusive;
+    uint64_t self;
+    uint64_t calls;
+} RoutineTotal;
+
+static int ByInclusive(const void *a, const void *b) {
+    const RoutineTotal *x = a;
+    const RoutineTotal *y = b;
+
+    if (x->inclusive != y->inclusive)
+        return (x->inclusive < y->inclusive) - (x->inclusive > y->inclusive);
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+/* Subtree totals add up from the leaves, which come after their parents.
+ * A recursive routine's inclusive time only counts its outermost calls. */
+uint8_t ProfilerWriteReport(const Profiler *prof, FILE *out) {
+    const ProfileNode *nodes = prof->nodes;
+    uint64_t *subtree = malloc(prof->nodeCount * sizeof(uint64_t));
+    RoutineTotal *totals = calloc(ADDR_NUM, sizeof(RoutineTotal));
+    uint32_t count = 0;
+
+    if (!subtree || !totals) {
+        fprintf(stderr, "Not enough memory for the profile report\n");
+        free(subtree);
+        free(totals);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < prof->nodeCount; ++i)
+        subtree[i] = nodes[i].self;
+    for (uint32_t i = prof->nodeCount - 1; i > 0; --i)
+        subtree[nodes[i].parent] += subtree[i];
+
+    for (uint32_t i = 0; i < prof->nodeCount; ++i) {
+        RoutineTotal *total = &totals[nodes[i].addr];
+        uint8_t outermost = 1;
+
+        for (uint32_t up = i; up && outermost;) {
+            up = nodes[up].parent;
+            outermost = nodes[up].addr != nodes[i].addr;
+        }
+
+        total->self += nodes[i].self;
+        total->calls += nodes[i].calls;
+        if (outermost)
+            total->inclusive += subtree[i];
+    }
+
+    for (uint32_t addr = 0; addr < ADDR_NUM; ++addr) {
+        if (totals[addr].inclusive || totals[addr].calls) {
+            totals[count] = totals[addr];
+            totals[count++].addr = addr;
+        }
+    }
+
+    qsort(totals, count, sizeof(RoutineTotal), ByInclusive);
+
+    double all = subtree[0] ? subtree[0] : 1;
+    char buffer[NAME_SIZE];
+
+    fprintf(out, "%14s %7s %14s %7s %10s  %s\n", "inclusive", "%", "self", "%", "calls", "routine");
+    for (uint32_t i = 0; i < count; ++i) {
+        fprintf(out, "%14lu %6.2f%% %14lu %6.2f%% %10lu  %s\n", totals[i].inclusive,
+                100.0 * totals[i].inclusive / all, totals[i].self, 100.0 * totals[i].self / all,
+                totals[i].calls, Name(prof, totals[i].addr, buffer));
+    }
+
+    free(subtree);
+    free(totals);
+    return 1;
+}
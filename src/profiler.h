@@ -0,0 +1,77 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Deeper calls are charged to the deepest frame kept. */
+#define PROFILER_MAX_DEPTH 128
+/* Distinct call paths; calls along new paths past this are charged to
+ * the caller. */
+#define PROFILER_MAX_NODES 65536
+
+/* One call path: the routine at addr, called from parent's path. */
+typedef struct _ProfileNode {
+    uint16_t addr;
+    uint32_t parent;
+    /* First child and next sibling, 0 for none since the root is no one's
+     * child. */
+    uint32_t child;
+    uint32_t sibling;
+
+    uint64_t self;
+    uint64_t calls;
+} ProfileNode;
+
+typedef struct _ProfileFrame {
+    uint32_t node;
+    /* The 6502 stack pointer before the call, which a matching RTS or RTI
+     * restores. */
+    uint8_t sp;
+} ProfileFrame;
+
+/* Charges CPU cycles to the routine on top of a shadow call stack that
+ * follows JSR, RTS, RTI and interrupts. Cycles go to the call tree node
+ * of the whole path, so self and inclusive time per routine and folded
+ * stacks for flame graphs all come out of the same data. Returns pop every
+ * frame the stack pointer went back past, which keeps the shadow stack
+ * straight when code jumps through RTS or drops return addresses. */
+typedef struct _Profiler {
+    ProfileNode *nodes;
+    uint32_t nodeCount;
+    uint32_t nodeCapacity;
+
+    /* stack[0] is the root, the code reset runs. */
+    ProfileFrame stack[PROFILER_MAX_DEPTH];
+    uint32_t depth;
+    /* Cycles up to here are charged. */
+    uint64_t charged;
+
+    /* 64K names by address once a label file is loaded, NULL before. */
+    char **labels;
+} Profiler;
+
+/* Returns NULL when out of memory. */
+Profiler *ProfilerCreate(void);
+void ProfilerDestroy(Profiler *prof);
+
+/* ld65 -Ln files ("al 00C000 .reset") or plain "C000 reset" lines. The
+ * first label at an address wins. */
+uint8_t ProfilerLoadLabels(Profiler *prof, const char *path);
+
+/* cycle is the running CPU cycle count; everything since the last event
+ * goes to the routine that was on top. */
+void ProfilerReset(Profiler *prof, uint16_t entry, uint64_t cycle);
+void ProfilerCall(Profiler *prof, uint16_t entry, uint8_t sp, uint64_t cycle);
+void ProfilerReturn(Profiler *prof, uint8_t sp, uint64_t cycle);
+void ProfilerCharge(Profiler *prof, uint64_t cycle);
+/* Forgets the shadow stack, e.g. after loading a state. */
+void ProfilerUnwind(Profiler *prof, uint64_t cycle);
+
+/* "reset;nmi;$C123 cycles" per path with self time, for flamegraph.pl. */
+uint8_t ProfilerWriteFolded(const Profiler *prof, FILE *out);
+/* Inclusive and self cycles and calls per routine, busiest first. The
+ * writers return 0 if they run out of memory. */
+uint8_t ProfilerWriteReport(const Profiler *prof, FILE *out);
+
+#endif
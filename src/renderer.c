@@ -0,0 +1,193 @@
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "renderer.h"
+#include "cartridge.h"
+
+#define RENDER_LOG_MASK (RENDER_LOG_SIZE - 1)
+
+static void DrawLine(Renderer *renderer, uint16_t y) {
+    Ppu *target = renderer->target;
+
+    PpuRenderScanline(&renderer->ppu, y);
+
+    memcpy(target->frameBuffer + y * PPU_WIDTH, renderer->ppu.frameBuffer + y * PPU_WIDTH, PPU_WIDTH);
+    target->emphasis[y] = renderer->ppu.emphasis[y];
+}
+
+static void Replay(Renderer *renderer, const RenderCommand *cmd) {
+    switch (cmd->type) {
+        case RENDER_WRITE:
+            PpuWriteRegister(&renderer->ppu, cmd->addr, cmd->value);
+            break;
+        case RENDER_READ:
+            PpuReadRegister(&renderer->ppu, cmd->addr);
+            break;
+        case RENDER_LINE:
+            DrawLine(renderer, cmd->addr);
+            break;
+    }
+}
+
+static void *Worker(void *arg) {
+    Renderer *renderer = arg;
+
+    for (;;) {
+        uint32_t tail = atomic_load_explicit(&renderer->tail, memory_order_relaxed);
+        uint32_t head = atomic_load(&renderer->head);
+
+        if (tail != head) {
+            for (; tail != head; ++tail)
+                Replay(renderer, &renderer->log[tail & RENDER_LOG_MASK]);
+
+            atomic_store(&renderer->tail, tail);
+            continue;
+        }
+
+        pthread_mutex_lock(&renderer->lock);
+        pthread_cond_broadcast(&renderer->drained);
+
+        atomic_store(&renderer->sleeping, 1);
+        while (!renderer->quit && atomic_load(&renderer->tail) == atomic_load(&renderer->head))
+            pthread_cond_wait(&renderer->wake, &renderer->lock);
+        atomic_store(&renderer->sleeping, 0);
+
+        uint8_t quit = renderer->quit && atomic_load(&renderer->tail) == atomic_load(&renderer->head);
+        pthread_mutex_unlock(&renderer->lock);
+
+        if (quit)
+            break;
+    }
+
+    return NULL;
+}
+
+static void Wake(Renderer *renderer) {
+    if (!atomic_load(&renderer->sleeping))
+        return;
+
+    pthread_mutex_lock(&renderer->lock);
+    pthread_cond_signal(&renderer->wake);
+    pthread_mutex_unlock(&renderer->lock);
+}
+
+Renderer *RendererCreate(Ppu *target) {
+    Renderer *renderer = malloc(sizeof(Renderer));
+    if (!renderer) {
+        fprintf(stderr, "Not enough memory for the render thread\n");
+        return NULL;
+    }
+
+    renderer->target = target;
+    renderer->cart = CartridgeClone(target->mem->cart);
+    renderer->cartState = renderer->cart ? malloc(CartridgeStateSize(renderer->cart)) : NULL;
+    renderer->log = malloc(RENDER_LOG_SIZE * sizeof(RenderCommand));
+
+    if (!renderer->cart || !renderer->cartState || !renderer->log) {
+        fprintf(stderr, "Not enough memory for the render thread\n");
+        if (renderer->cart) {
+            CartridgeDestroy(renderer->cart);
+            free(renderer->cart);
+        }
+        free(renderer->cartState);
+        free(renderer->log);
+        free(renderer);
+        return NULL;
+    }
+
+    renderer->totalCycles = 0;
+    MemoryInit(&renderer->mem, renderer->cart, &renderer->totalCycles);
+    PpuInit(&renderer->ppu, &renderer->mem, &renderer->totalCycles);
+    RendererSync(renderer);
+
+    atomic_init(&renderer->head, 0);
+    atomic_init(&renderer->tail, 0);
+    atomic_init(&renderer->sleeping, 0);
+    renderer->quit = 0;
+
+    pthread_mutex_init(&renderer->lock, NULL);
+    pthread_cond_init(&renderer->wake, NULL);
+    pthread_cond_init(&renderer->drained, NULL);
+
+    if (pthread_create(&renderer->thread, NULL, Worker, renderer) != 0) {
+        fprintf(stderr, "Couldn't start the render thread\n");
+        pthread_mutex_destroy(&renderer->lock);
+        pthread_cond_destroy(&renderer->wake);
+        pthread_cond_destroy(&renderer->drained);
+        CartridgeDestroy(renderer->cart);
+        free(renderer->cart);
+        free(renderer->cartState);
+        free(renderer->log);
+        free(renderer);
+        return NULL;
+    }
+
+    return renderer;
+}
+
+void RendererDestroy(Renderer *renderer) {
+    pthread_mutex_lock(&renderer->lock);
+    renderer->quit = 1;
+    pthread_cond_signal(&renderer->wake);
+    pthread_mutex_unlock(&renderer->lock);
+
+    pthread_join(renderer->thread, NULL);
+
+    pthread_mutex_destroy(&renderer->lock);
+    pthread_cond_destroy(&renderer->wake);
+    pthread_cond_destroy(&renderer->drained);
+
+    CartridgeDestroy(renderer->cart);
+    free(renderer->cart);
+    free(renderer->cartState);
+    free(renderer->log);
+    free(renderer);
+}
+
+/* Only lines wake the worker, the writes before one are replayed with it. */
+void RendererLog(Renderer *renderer, RENDER_COMMAND type, uint16_t addr, uint8_t value) {
+    uint32_t head = atomic_load_explicit(&renderer->head, memory_order_relaxed);
+
+    while (head - atomic_load(&renderer->tail) == RENDER_LOG_SIZE) {
+        Wake(renderer);
+        sched_yield();
+    }
+
+    RenderCommand *cmd = &renderer->log[head & RENDER_LOG_MASK];
+    cmd->addr = addr;
+    cmd->value = value;
+    cmd->type = type;
+
+    atomic_store(&renderer->head, head + 1);
+
+    if (type == RENDER_LINE)
+        Wake(renderer);
+}
+
+void RendererFinish(Renderer *renderer) {
+    pthread_mutex_lock(&renderer->lock);
+    pthread_cond_signal(&renderer->wake);
+    while (atomic_load(&renderer->tail) != atomic_load(&renderer->head))
+        pthread_cond_wait(&renderer->drained, &renderer->lock);
+    pthread_mutex_unlock(&renderer->lock);
+}
+
+void RendererSync(Renderer *renderer) {
+    const Ppu *target = renderer->target;
+    const Memory *mem = target->mem;
+
+    renderer->ppu = *target;
+    renderer->ppu.mem = &renderer->mem;
+    renderer->ppu.totalCycles = &renderer->totalCycles;
+    renderer->ppu.renderer = NULL;
+    renderer->ppu.renderingFrame = 1;
+
+    memcpy(renderer->mem.ppuRam, mem->ppuRam, PPU_RAM_SIZE);
+    memcpy(renderer->mem.paletteRam, mem->paletteRam, PALETTE_RAM_SIZE);
+
+    CartridgeSaveState(mem->cart, renderer->cartState);
+    CartridgeLoadState(renderer->cart, renderer->cartState);
+    MemorySetMirroring(&renderer->mem, mem->cart->mirroring);
+}
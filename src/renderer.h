@@ -0,0 +1,73 @@
+#ifndef RENDERER_H_
+#define RENDERER_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "memory.h"
+#include "ppu.h"
+
+/* Entries in the log, a power of two. The emulation thread waits when the
+ * worker falls this far behind. */
+#define RENDER_LOG_SIZE 65536
+
+typedef struct _Cartridge Cartridge;
+
+typedef enum _RENDER_COMMAND {
+    RENDER_WRITE, /* CPU write to PPU register addr */
+    RENDER_READ,  /* CPU read of PPU register addr, for its side effects */
+    RENDER_LINE   /* Draw scanline addr */
+} RENDER_COMMAND;
+
+typedef struct _RenderCommand {
+    uint16_t addr;
+    uint8_t value;
+    uint8_t type;
+} RenderCommand;
+
+/* Draws a Ppu's pixels on a thread of its own. The emulated PPU keeps
+ * updating the status flags but only logs, in order, every register access
+ * and the point where each visible scanline would have been drawn. The
+ * worker replays the log against its own copy of the PPU and its memory,
+ * so each line is drawn from the state the game left at that point of the
+ * frame, and copies the line into the emulated PPU's frameBuffer. */
+typedef struct _Renderer {
+    Ppu *target;
+
+    /* The worker's copy of everything drawing reads. */
+    Memory mem;
+    Ppu ppu;
+    uint64_t totalCycles;
+    Cartridge *cart;
+    uint8_t *cartState;
+
+    /* Single producer, single consumer ring. head and tail count entries
+     * ever logged and replayed. */
+    RenderCommand *log;
+    atomic_uint head;
+    atomic_uint tail;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t drained;
+    atomic_uchar sleeping;
+    uint8_t quit;
+} Renderer;
+
+/* Starts drawing for target from its current state. Returns NULL on
+ * failure. */
+Renderer *RendererCreate(Ppu *target);
+void RendererDestroy(Renderer *renderer);
+
+void RendererLog(Renderer *renderer, RENDER_COMMAND type, uint16_t addr, uint8_t value);
+
+/* Waits until every logged line is in the target's frameBuffer. */
+void RendererFinish(Renderer *renderer);
+
+/* Copies the target's state again after it changed without going through
+ * the log, e.g. on a state load. Only call it after RendererFinish. */
+void RendererSync(Renderer *renderer);
+
+#endif
@@ -0,0 +1,580 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scaler.h"
+#include "ppu.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_SSE2 1
+#endif
+
+#define SCALER_ALIGN 64
+
+/* Row kernels. Scale2x and Scale3x rows come from an edge-padded copy, so
+ * row[-1] and row[count] can be read, and above and below are clamped to
+ * the frame by the caller. */
+struct _ScaleKernels {
+    void (*expand)(const uint32_t *src, uint32_t *dst, uint32_t count, uint32_t factor);
+    void (*dim)(const uint32_t *src, uint32_t *dst, uint32_t count);
+    void (*scale2x)(const uint32_t *above, const uint32_t *row, const uint32_t *below,
+                    uint32_t *out0, uint32_t *out1, uint32_t count);
+    void (*scale3x)(const uint32_t *above, const uint32_t *row, const uint32_t *below,
+                    uint32_t *out0, uint32_t *out1, uint32_t *out2, uint32_t count);
+};
+
+/* The A byte of an RGBA pixel, wherever the host puts it. */
+static uint32_t AlphaMask(void) {
+    static const uint8_t bytes[4] = {0, 0, 0, 0xFF};
+    uint32_t mask;
+
+    memcpy(&mask, bytes, sizeof(mask));
+    return mask;
+}
+
+static void ExpandScalar(const uint32_t *src, uint32_t *dst, uint32_t count, uint32_t factor) {
+    for (uint32_t i = 0; i < count; ++i) {
+        for (uint32_t k = 0; k < factor; ++k)
+            *dst++ = src[i];
+    }
+}
+
+static void DimScalar(const uint32_t *src, uint32_t *dst, uint32_t count) {
+    uint32_t alpha = AlphaMask();
+
+    for (uint32_t i = 0; i < count; ++i)
+        dst[i] = ((src[i] >> 1) & 0x7F7F7F7F & ~alpha) | (src[i] & alpha);
+}
+
+static void Scale2xScalar(const uint32_t *above, const uint32_t *row, const uint32_t *below,
+                          uint32_t *out0, uint32_t *out1, uint32_t count) {
+    for (uint32_t x = 0; x < count; ++x) {
+        const uint32_t *r = row + x;
+        uint32_t b = above[x], d = r[-1], e = r[0], f = r[1], h = below[x];
+
+        if (b != h && d != f) {
+            out0[2 * x]     = d == b ? d : e;
+            out0[2 * x + 1] = b == f ? f : e;
+            out1[2 * x]     = d == h ? d : e;
+            out1[2 * x + 1] = h == f ? f : e;
+        } else {
+            out0[2 * x] = out0[2 * x + 1] = e;
+            out1[2 * x] = out1[2 * x + 1] = e;
+        }
+    }
+}
+
+static void Scale3xScalar(const uint32_t *above, const uint32_t *row, const uint32_t *below,
+                          uint32_t *out0, uint32_t *out1, uint32_t *out2, uint32_t count) {
+    for (uint32_t x = 0; x < count; ++x) {
+        const uint32_t *up = above + x, *r = row + x, *down = below + x;
+        uint32_t a = up[-1], b = up[0], c = up[1];
+        uint32_t d = r[-1], e = r[0], f = r[1];
+        uint32_t g = down[-1], h = down[0], i = down[1];
+        uint32_t *o0 = out0 + 3 * x, *o1 = out1 + 3 * x, *o2 = out2 + 3 * x;
+
+        if (b != h && d != f) {
+            o0[0] = d == b ? d : e;
+            o0[1] = (d == b && e != c) || (b == f && e != a) ? b : e;
+            o0[2] = b == f ? f : e;
+            o1[0] = (d == b && e != g) || (d == h && e != a) ? d : e;
+            o1[1] = e;
+            o1[2] = (b == f && e != i) || (h == f && e != c) ? f : e;
+            o2[0] = d == h ? d : e;
+            o2[1] = (d == h && e != i) || (h == f && e != g) ? h : e;
+            o2[2] = h == f ? f : e;
+        } else {
+            o0[0] = o0[1] = o0[2] = e;
+            o1[0] = o1[1] = o1[2] = e;
+            o2[0] = o2[1] = o2[2] = e;
+        }
+    }
+}
+
+static const ScaleKernels gScalarKernels = {
+    ExpandScalar, DimScalar, Scale2xScalar, Scale3xScalar
+};
+
+#ifdef HAVE_SSE2
+/* mask ? a : b */
+static inline __m128i Select128(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static void ExpandSse2(const uint32_t *src, uint32_t *dst, uint32_t count, uint32_t factor) {
+    uint32_t i = 0;
+
+    if (factor == 2) {
+        for (; i + 4 <= count; i += 4) {
+            __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+
+            _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi32(p, p));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i + 4), _mm_unpackhi_epi32(p, p));
+        }
+    } else if (factor == 4) {
+        for (; i + 4 <= count; i += 4) {
+            __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i *out = (__m128i *)(dst + 4 * i);
+
+            _mm_storeu_si128(out,     _mm_shuffle_epi32(p, 0x00));
+            _mm_storeu_si128(out + 1, _mm_shuffle_epi32(p, 0x55));
+            _mm_storeu_si128(out + 2, _mm_shuffle_epi32(p, 0xAA));
+            _mm_storeu_si128(out + 3, _mm_shuffle_epi32(p, 0xFF));
+        }
+    }
+
+    ExpandScalar(src + i, dst + factor * i, count - i, factor);
+}
+
+static void DimSse2(const uint32_t *src, uint32_t *dst, uint32_t count) {
+    uint32_t alpha = AlphaMask();
+    const __m128i half = _mm_set1_epi32(0x7F7F7F7F & ~alpha);
+    const __m128i keep = _mm_set1_epi32(alpha);
+    uint32_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i dimmed = _mm_and_si128(_mm_srli_epi32(p, 1), half);
+
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(dimmed, _mm_and_si128(p, keep)));
+    }
+
+    DimScalar(src + i, dst + i, count - i);
+}
+
+static void Scale2xSse2(const uint32_t *above, const uint32_t *row, const uint32_t *below,
+                        uint32_t *out0, uint32_t *out1, uint32_t count) {
+    uint32_t x = 0;
+
+    for (; x + 4 <= count; x += 4) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(above + x));
+        __m128i d = _mm_loadu_si128((const __m128i *)(row + x - 1));
+        __m128i e = _mm_loadu_si128((const __m128i *)(row + x));
+        __m128i f = _mm_loadu_si128((const __m128i *)(row + x + 1));
+        __m128i h = _mm_loadu_si128((const __m128i *)(below + x));
+
+        __m128i db = _mm_cmpeq_epi32(d, b), bf = _mm_cmpeq_epi32(b, f);
+        __m128i dh = _mm_cmpeq_epi32(d, h), hf = _mm_cmpeq_epi32(h, f);
+
+        __m128i e0 = Select128(_mm_andnot_si128(_mm_or_si128(bf, dh), db), d, e);
+        __m128i e1 = Select128(_mm_andnot_si128(_mm_or_si128(db, hf), bf), f, e);
+        __m128i e2 = Select128(_mm_andnot_si128(_mm_or_si128(db, hf), dh), d, e);
+        __m128i e3 = Select128(_mm_andnot_si128(_mm_or_si128(dh, bf), hf), f, e);
+
+        _mm_storeu_si128((__m128i *)(out0 + 2 * x),     _mm_unpacklo_epi32(e0, e1));
+        _mm_storeu_si128((__m128i *)(out0 + 2 * x + 4), _mm_unpackhi_epi32(e0, e1));
+        _mm_storeu_si128((__m128i *)(out1 + 2 * x),     _mm_unpacklo_epi32(e2, e3));
+        _mm_storeu_si128((__m128i *)(out1 + 2 * x + 4), _mm_unpackhi_epi32(e2, e3));
+    }
+
+    Scale2xScalar(above + x, row + x, below + x, out0 + 2 * x, out1 + 2 * x, count - x);
+}
+
+/* a0 b0 c0 a1 | b1 c1 a2 b2 | c2 a3 b3 c3, with shufps picking two lanes
+ * from each of two unpacked pairs. */
+static inline void Interleave3(__m128i a, __m128i b, __m128i c, __m128i out[3]) {
+    __m128 ab = _mm_castsi128_ps(_mm_unpacklo_epi32(a, b));
+    __m128 ca = _mm_castsi128_ps(_mm_unpacklo_epi32(c, a));
+    __m128 bc = _mm_castsi128_ps(_mm_unpacklo_epi32(b, c));
+    __m128 abHi = _mm_castsi128_ps(_mm_unpackhi_epi32(a, b));
+    __m128 caHi = _mm_castsi128_ps(_mm_unpackhi_epi32(c, a));
+    __m128 bcHi = _mm_castsi128_ps(_mm_unpackhi_epi32(b, c));
+
+    out[0] = _mm_castps_si128(_mm_shuffle_ps(ab, ca, _MM_SHUFFLE(3, 0, 1, 0)));
+    out[1] = _mm_castps_si128(_mm_shuffle_ps(bc, abHi, _MM_SHUFFLE(1, 0, 3, 2)));
+    out[2] = _mm_castps_si128(_mm_shuffle_ps(caHi, bcHi, _MM_SHUFFLE(3, 2, 3, 0)));
+}
+
+static inline void Store3(__m128i a, __m128i b, __m128i c, uint32_t *out) {
+    __m128i v[3];
+
+    Interleave3(a, b, c, v);
+    _mm_storeu_si128((__m128i *)out, v[0]);
+    _mm_storeu_si128((__m128i *)(out + 4), v[1]);
+    _mm_storeu_si128((__m128i *)(out + 8), v[2]);
+}
+
+static void Scale3xSse2(const uint32_t *above, const uint32_t *row, const uint32_t *below,
+                        uint32_t *out0, uint32_t *out1, uint32_t *out2, uint32_t count) {
+    uint32_t x = 0;
+
+    for (; x + 4 <= count; x += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(above + x - 1));
+        __m128i b = _mm_loadu_si128((const __m128i *)(above + x));
+        __m128i c = _mm_loadu_si128((const __m128i *)(above + x + 1));
+        __m128i d = _mm_loadu_si128((const __m128i *)(row + x - 1));
+        __m128i m = _mm_loadu_si128((const __m128i *)(row + x));
+        __m128i f = _mm_loadu_si128((const __m128i *)(row + x + 1));
+        __m128i g = _mm_loadu_si128((const __m128i *)(below + x - 1));
+        __m128i h = _mm_loadu_si128((const __m128i *)(below + x));
+        __m128i i = _mm_loadu_si128((const __m128i *)(below + x + 1));
+
+        __m128i guard = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f)),
+                                         _mm_set1_epi32(-1));
+        __m128i db = _mm_and_si128(guard, _mm_cmpeq_epi32(d, b));
+        __m128i bf = _mm_and_si128(guard, _mm_cmpeq_epi32(b, f));
+        __m128i dh = _mm_and_si128(guard, _mm_cmpeq_epi32(d, h));
+        __m128i hf = _mm_and_si128(guard, _mm_cmpeq_epi32(h, f));
+        __m128i ea = _mm_cmpeq_epi32(m, a), ec = _mm_cmpeq_epi32(m, c);
+        __m128i eg = _mm_cmpeq_epi32(m, g), ei = _mm_cmpeq_epi32(m, i);
+
+        __m128i e0 = Select128(db, d, m);
+        __m128i e1 = Select128(_mm_or_si128(_mm_andnot_si128(ec, db), _mm_andnot_si128(ea, bf)), b, m);
+        __m128i e2 = Select128(bf, f, m);
+        __m128i e3 = Select128(_mm_or_si128(_mm_andnot_si128(eg, db), _mm_andnot_si128(ea, dh)), d, m);
+        __m128i e5 = Select128(_mm_or_si128(_mm_andnot_si128(ei, bf), _mm_andnot_si128(ec, hf)), f, m);
+        __m128i e6 = Select128(dh, d, m);
+        __m128i e7 = Select128(_mm_or_si128(_mm_andnot_si128(ei, dh), _mm_andnot_si128(eg, hf)), h, m);
+        __m128i e8 = Select128(hf, f, m);
+
+        Store3(e0, e1, e2, out0 + 3 * x);
+        Store3(e3, m, e5, out1 + 3 * x);
+        Store3(e6, e7, e8, out2 + 3 * x);
+    }
+
+    Scale3xScalar(above + x, row + x, below + x, out0 + 3 * x, out1 + 3 * x, out2 + 3 * x, count - x);
+}
+
+static const ScaleKernels gSse2Kernels = {
+    ExpandSse2, DimSse2, Scale2xSse2, Scale3xSse2
+};
+
+__attribute__((target("avx2")))
+static inline __m256i Select256(__m256i mask, __m256i a, __m256i b) {
+    return _mm256_blendv_epi8(b, a, mask);
+}
+
+__attribute__((target("avx2")))
+static void ExpandAvx2(const uint32_t *src, uint32_t *dst, uint32_t count, uint32_t factor) {
+    uint32_t i = 0;
+
+    if (factor == 2) {
+        const __m256i lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+        const __m256i hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+
+        for (; i + 8 <= count; i += 8) {
+            __m256i p = _mm256_loadu_si256((const __m256i *)(src + i));
+
+            _mm256_storeu_si256((__m256i *)(dst + 2 * i), _mm256_permutevar8x32_epi32(p, lo));
+            _mm256_storeu_si256((__m256i *)(dst + 2 * i + 8), _mm256_permutevar8x32_epi32(p, hi));
+        }
+    } else if (factor == 4) {
+        const __m256i spread[4] = {
+            _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1),
+            _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3),
+            _mm256_setr_epi32(4, 4, 4, 4, 5, 5, 5, 5),
+            _mm256_setr_epi32(6, 6, 6, 6, 7, 7, 7, 7)
+        };
+
+        for (; i + 8 <= count; i += 8) {
+            __m256i p = _mm256_loadu_si256((const __m256i *)(src + i));
+            __m256i *out = (__m256i *)(dst + 4 * i);
+
+            for (uint8_t k = 0; k < 4; ++k)
+                _mm256_storeu_si256(out + k, _mm256_permutevar8x32_epi32(p, spread[k]));
+        }
+    }
+
+    ExpandScalar(src + i, dst + factor * i, count - i, factor);
+}
+
+__attribute__((target("avx2")))
+static void DimAvx2(const uint32_t *src, uint32_t *dst, uint32_t count) {
+    uint32_t alpha = AlphaMask();
+    const __m256i half = _mm256_set1_epi32(0x7F7F7F7F & ~alpha);
+    const __m256i keep = _mm256_set1_epi32(alpha);
+    uint32_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i dimmed = _mm256_and_si256(_mm256_srli_epi32(p, 1), half);
+
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(dimmed, _mm256_and_si256(p, keep)));
+    }
+
+    DimScalar(src + i, dst + i, count - i);
+}
+
+/* unpacklo/hi interleave within each 128-bit lane, so the halves are put
+ * back in order afterwards. */
+__attribute__((target("avx2")))
+static inline void StoreInterleaved(__m256i a, __m256i b, uint32_t *out) {
+    __m256i lo = _mm256_unpacklo_epi32(a, b);
+    __m256i hi = _mm256_unpackhi_epi32(a, b);
+
+    _mm256_storeu_si256((__m256i *)out,       _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *)(out + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+__attribute__((target("avx2")))
+static void Scale2xAvx2(const uint32_t *above, const uint32_t *row, const uint32_t *below,
+                        uint32_t *out0, uint32_t *out1, uint32_t count) {
+    uint32_t x = 0;
+
+    for (; x + 8 <= count; x += 8) {
+        __m256i b = _mm256_loadu_si256((const __m256i *)(above + x));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(row + x - 1));
+        __m256i e = _mm256_loadu_si256((const __m256i *)(row + x));
+        __m256i f = _mm256_loadu_si256((const __m256i *)(row + x + 1));
+        __m256i h = _mm256_loadu_si256((const __m256i *)(below + x));
+
+        __m256i db = _mm256_cmpeq_epi32(d, b), bf = _mm256_cmpeq_epi32(b, f);
+        __m256i dh = _mm256_cmpeq_epi32(d, h), hf = _mm256_cmpeq_epi32(h, f);
+
+        __m256i e0 = Select256(_mm256_andnot_si256(_mm256_or_si256(bf, dh), db), d, e);
+        __m256i e1 = Select256(_mm256_andnot_si256(_mm256_or_si256(db, hf), bf), f, e);
+        __m256i e2 = Select256(_mm256_andnot_si256(_mm256_or_si256(db, hf), dh), d, e);
+        __m256i e3 = Select256(_mm256_andnot_si256(_mm256_or_si256(dh, bf), hf), f, e);
+
+        StoreInterleaved(e0, e1, out0 + 2 * x);
+        StoreInterleaved(e2, e3, out1 + 2 * x);
+    }
+
+    Scale2xSse2(above + x, row + x, below + x, out0 + 2 * x, out1 + 2 * x, count - x);
+}
+
+/* Interleave3 within each 128-bit lane, then the halves put back in order. */
+__attribute__((target("avx2")))
+static inline void Store3Avx2(__m256i a, __m256i b, __m256i c, uint32_t *out) {
+    __m256 ab = _mm256_castsi256_ps(_mm256_unpacklo_epi32(a, b));
+    __m256 ca = _mm256_castsi256_ps(_mm256_unpacklo_epi32(c, a));
+    __m256 bc = _mm256_castsi256_ps(_mm256_unpacklo_epi32(b, c));
+    __m256 abHi = _mm256_castsi256_ps(_mm256_unpackhi_epi32(a, b));
+    __m256 caHi = _mm256_castsi256_ps(_mm256_unpackhi_epi32(c, a));
+    __m256 bcHi = _mm256_castsi256_ps(_mm256_unpackhi_epi32(b, c));
+
+    __m256i v0 = _mm256_castps_si256(_mm256_shuffle_ps(ab, ca, _MM_SHUFFLE(3, 0, 1, 0)));
+    __m256i v1 = _mm256_castps_si256(_mm256_shuffle_ps(bc, abHi, _MM_SHUFFLE(1, 0, 3, 2)));
+    __m256i v2 = _mm256_castps_si256(_mm256_shuffle_ps(caHi, bcHi, _MM_SHUFFLE(3, 2, 3, 0)));
+
+    _mm256_storeu_si256((__m256i *)out,        _mm256_permute2x128_si256(v0, v1, 0x20));
+    _mm256_storeu_si256((__m256i *)(out + 8),  _mm256_permute2x128_si256(v2, v0, 0x30));
+    _mm256_storeu_si256((__m256i *)(out + 16), _mm256_permute2x128_si256(v1, v2, 0x31));
+}
+
+__attribute__((target("avx2")))
+static void Scale3xAvx2(const uint32_t *above, const uint32_t *row, const uint32_t *below,
+                        uint32_t *out0, uint32_t *out1, uint32_t *out2, uint32_t count) {
+    uint32_t x = 0;
+
+    for (; x + 8 <= count; x += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(above + x - 1));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(above + x));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(above + x + 1));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(row + x - 1));
+        __m256i m = _mm256_loadu_si256((const __m256i *)(row + x));
+        __m256i f = _mm256_loadu_si256((const __m256i *)(row + x + 1));
+        __m256i g = _mm256_loadu_si256((const __m256i *)(below + x - 1));
+        __m256i h = _mm256_loadu_si256((const __m256i *)(below + x));
+        __m256i i = _mm256_loadu_si256((const __m256i *)(below + x + 1));
+
+        __m256i guard = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpeq_epi32(b, h),
+                                                             _mm256_cmpeq_epi32(d, f)),
+                                            _mm256_set1_epi32(-1));
+        __m256i db = _mm256_and_si256(guard, _mm256_cmpeq_epi32(d, b));
+        __m256i bf = _mm256_and_si256(guard, _mm256_cmpeq_epi32(b, f));
+        __m256i dh = _mm256_and_si256(guard, _mm256_cmpeq_epi32(d, h));
+        __m256i hf = _mm256_and_si256(guard, _mm256_cmpeq_epi32(h, f));
+        __m256i ea = _mm256_cmpeq_epi32(m, a), ec = _mm256_cmpeq_epi32(m, c);
+        __m256i eg = _mm256_cmpeq_epi32(m, g), ei = _mm256_cmpeq_epi32(m, i);
+
+        __m256i e0 = Select256(db, d, m);
+        __m256i e1 = Select256(_mm256_or_si256(_mm256_andnot_si256(ec, db), _mm256_andnot_si256(ea, bf)),
+                               b, m);
+        __m256i e2 = Select256(bf, f, m);
+        __m256i e3 = Select256(_mm256_or_si256(_mm256_andnot_si256(eg, db), _mm256_andnot_si256(ea, dh)),
+                               d, m);
+        __m256i e5 = Select256(_mm256_or_si256(_mm256_andnot_si256(ei, bf), _mm256_andnot_si256(ec, hf)),
+                               f, m);
+        __m256i e6 = Select256(dh, d, m);
+        __m256i e7 = Select256(_mm256_or_si256(_mm256_andnot_si256(ei, dh), _mm256_andnot_si256(eg, hf)),
+                               h, m);
+        __m256i e8 = Select256(hf, f, m);
+
+        Store3Avx2(e0, e1, e2, out0 + 3 * x);
+        Store3Avx2(e3, m, e5, out1 + 3 * x);
+        Store3Avx2(e6, e7, e8, out2 + 3 * x);
+    }
+
+    Scale3xSse2(above + x, row + x, below + x, out0 + 3 * x, out1 + 3 * x, out2 + 3 * x, count - x);
+}
+
+static const ScaleKernels gAvx2Kernels = {
+    ExpandAvx2, DimAvx2, Scale2xAvx2, Scale3xAvx2
+};
+#endif
+
+static const ScaleKernels *PickKernels(SCALE_KERNEL kernel) {
+    const ScaleKernels *sse2 = NULL;
+    const ScaleKernels *avx2 = NULL;
+
+#ifdef HAVE_SSE2
+    sse2 = &gSse2Kernels;
+    if (__builtin_cpu_supports("avx2"))
+        avx2 = &gAvx2Kernels;
+#endif
+
+    switch (kernel) {
+        case SCALE_KERNEL_SCALAR:
+            return &gScalarKernels;
+        case SCALE_KERNEL_SSE2:
+            return sse2;
+        case SCALE_KERNEL_AVX2:
+            return avx2;
+        default:
+            return avx2 ? avx2 : sse2 ? sse2 : &gScalarKernels;
+    }
+}
+
+static uint8_t FilterDoes(SCALE_FILTER filter, uint32_t factor) {
+    switch (filter) {
+        case SCALE_NONE:
+            return factor == 1;
+        case SCALE_NEAREST:
+            return factor >= 1 && factor <= SCALER_MAX_FACTOR;
+        case SCALE_SCANLINES:
+            return factor >= 2 && factor <= SCALER_MAX_FACTOR;
+        case SCALE_2X:
+            return factor == 2 || factor == 4;
+        case SCALE_3X:
+            return factor == 3;
+    }
+
+    return 0;
+}
+
+uint8_t ScalerInit(Scaler *scaler, SCALE_FILTER filter, uint32_t factor, SCALE_KERNEL kernel) {
+    if (!FilterDoes(filter, factor)) {
+        fprintf(stderr, "That filter can't scale by %u\n", factor);
+        return 0;
+    }
+
+    scaler->kernels = PickKernels(kernel);
+    if (!scaler->kernels) {
+        fprintf(stderr, "This CPU can't run that scaler kernel\n");
+        return 0;
+    }
+
+    scaler->filter = filter;
+    scaler->factor = factor;
+    scaler->width = PPU_WIDTH * factor;
+    scaler->height = PPU_HEIGHT * factor;
+
+    scaler->out = aligned_alloc(SCALER_ALIGN, (size_t)scaler->width * scaler->height * sizeof(uint32_t));
+    scaler->padded = NULL;
+    scaler->pass = NULL;
+
+    /* Big enough for the input of the second Scale2x pass. */
+    if (filter == SCALE_2X || filter == SCALE_3X)
+        scaler->padded = malloc((size_t)(2 * PPU_WIDTH + 2) * 2 * PPU_HEIGHT * sizeof(uint32_t));
+
+    if (filter == SCALE_2X && factor == 4)
+        scaler->pass = aligned_alloc(SCALER_ALIGN, (size_t)4 * PPU_WIDTH * PPU_HEIGHT * sizeof(uint32_t));
+
+    if (!scaler->out || ((filter == SCALE_2X || filter == SCALE_3X) && !scaler->padded) ||
+        (filter == SCALE_2X && factor == 4 && !scaler->pass)) {
+        fprintf(stderr, "Not enough memory for the scaler\n");
+        ScalerDestroy(scaler);
+        return 0;
+    }
+
+    return 1;
+}
+
+void ScalerDestroy(Scaler *scaler) {
+    free(scaler->out);
+    free(scaler->padded);
+    free(scaler->pass);
+
+    scaler->out = NULL;
+    scaler->padded = NULL;
+    scaler->pass = NULL;
+}
+
+static void Nearest(Scaler *scaler, const uint32_t *src) {
+    uint32_t factor = scaler->factor;
+    uint32_t width = scaler->width;
+
+    for (uint32_t y = 0; y < PPU_HEIGHT; ++y) {
+        uint32_t *first = scaler->out + (size_t)y * factor * width;
+
+        scaler->kernels->expand(src + y * PPU_WIDTH, first, PPU_WIDTH, factor);
+
+        for (uint32_t k = 1; k < factor; ++k)
+            memcpy(first + k * width, first, width * sizeof(uint32_t));
+
+        if (scaler->filter == SCALE_SCANLINES)
+            scaler->kernels->dim(first, first + (factor - 1) * width, width);
+    }
+}
+
+/* Copies a width x height frame with each row one pixel wider on both
+ * sides, repeating the edge pixels. Returns pixel (0, 0). */
+static const uint32_t *Pad(Scaler *scaler, const uint32_t *src, uint32_t width, uint32_t height) {
+    uint32_t stride = width + 2;
+
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint32_t *row = src + (size_t)y * width;
+        uint32_t *dst = scaler->padded + (size_t)y * stride;
+
+        dst[0] = row[0];
+        memcpy(dst + 1, row, width * sizeof(uint32_t));
+        dst[width + 1] = row[width - 1];
+    }
+
+    return scaler->padded + 1;
+}
+
+static void Scale2x(Scaler *scaler, const uint32_t *src, uint32_t width, uint32_t height, uint32_t *dst) {
+    const uint32_t *padded = Pad(scaler, src, width, height);
+    uint32_t stride = width + 2;
+
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint32_t *above = padded + (size_t)(y ? y - 1 : 0) * stride;
+        const uint32_t *row = padded + (size_t)y * stride;
+        const uint32_t *below = padded + (size_t)(y + 1 < height ? y + 1 : y) * stride;
+        uint32_t *out = dst + (size_t)2 * y * 2 * width;
+
+        scaler->kernels->scale2x(above, row, below, out, out + 2 * width, width);
+    }
+}
+
+static void Scale3x(Scaler *scaler, const uint32_t *src) {
+    const uint32_t *padded = Pad(scaler, src, PPU_WIDTH, PPU_HEIGHT);
+    uint32_t stride = PPU_WIDTH + 2;
+    uint32_t width = scaler->width;
+
+    for (uint32_t y = 0; y < PPU_HEIGHT; ++y) {
+        const uint32_t *above = padded + (y ? y - 1 : 0) * stride;
+        const uint32_t *row = padded + y * stride;
+        const uint32_t *below = padded + (y + 1 < PPU_HEIGHT ? y + 1 : y) * stride;
+        uint32_t *out = scaler->out + (size_t)3 * y * width;
+
+        scaler->kernels->scale3x(above, row, below, out, out + width, out + 2 * width, PPU_WIDTH);
+    }
+}
+
+const uint32_t *ScalerRun(Scaler *scaler, const uint32_t *rgba) {
+    switch (scaler->filter) {
+        case SCALE_NONE:
+            return rgba;
+        case SCALE_NEAREST:
+        case SCALE_SCANLINES:
+            Nearest(scaler, rgba);
+            break;
+        case SCALE_2X:
+            if (scaler->factor == 4) {
+                Scale2x(scaler, rgba, PPU_WIDTH, PPU_HEIGHT, scaler->pass);
+                Scale2x(scaler, scaler->pass, 2 * PPU_WIDTH, 2 * PPU_HEIGHT, scaler->out);
+            } else {
+                Scale2x(scaler, rgba, PPU_WIDTH, PPU_HEIGHT, scaler->out);
+            }
+            break;
+        case SCALE_3X:
+            Scale3x(scaler, rgba);
+            break;
+    }
+
+    return scaler->out;
+}
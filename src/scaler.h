@@ -0,0 +1,50 @@
+#ifndef SCALER_H_
+#define SCALER_H_
+
+#include <stdint.h>
+
+#define SCALER_MAX_FACTOR 8
+
+typedef enum _SCALE_FILTER {
+    SCALE_NONE,      /* Hand the frame over as it is */
+    SCALE_NEAREST,   /* Each pixel becomes a factor x factor block */
+    SCALE_SCANLINES, /* Nearest, with the last row of each block at half brightness */
+    SCALE_2X,        /* Scale2x, 2x, or applied twice for 4x */
+    SCALE_3X         /* Scale3x, 3x only */
+} SCALE_FILTER;
+
+typedef enum _SCALE_KERNEL {
+    SCALE_KERNEL_AUTO,
+    SCALE_KERNEL_SCALAR,
+    SCALE_KERNEL_SSE2,
+    SCALE_KERNEL_AVX2
+} SCALE_KERNEL;
+
+typedef struct _ScaleKernels ScaleKernels;
+
+/* Upscales PPU_WIDTH x PPU_HEIGHT RGBA frames on the CPU, for SDL software
+ * renderers and for video dumps, which can't leave it to a GPU. */
+typedef struct _Scaler {
+    SCALE_FILTER filter;
+    uint32_t factor;
+    uint32_t width;
+    uint32_t height;
+
+    const ScaleKernels *kernels;
+
+    uint32_t *out;
+    /* Edge-padded copy of a pass's input, and the output of all but the
+     * last Scale2x pass. */
+    uint32_t *padded;
+    uint32_t *pass;
+} Scaler;
+
+/* Returns 0 when the filter doesn't do factor or the CPU can't run the
+ * kernel. */
+uint8_t ScalerInit(Scaler *scaler, SCALE_FILTER filter, uint32_t factor, SCALE_KERNEL kernel);
+void ScalerDestroy(Scaler *scaler);
+
+/* Returns width x height pixels, valid until the next call. */
+const uint32_t *ScalerRun(Scaler *scaler, const uint32_t *rgba);
+
+#endif
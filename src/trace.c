@@ -0,0 +1,117 @@
+#include <stdlib.h>
+
+#include "trace.h"
+#include "ppu.h"
+
+#define TRACE_MASK (TRACE_CAPACITY - 1)
+#define CPU_CLOCK_HZ 1789773.0
+
+#define TRACK_CPU 1
+#define TRACK_PPU 2
+
+static const char *gRegisterNames[8] = {
+    "PPUCTRL", "PPUMASK", "PPUSTATUS", "OAMADDR", "OAMDATA", "PPUSCROLL", "PPUADDR", "PPUDATA"
+};
+
+Trace *TraceCreate(const Ppu *ppu) {
+    Trace *trace = malloc(sizeof(Trace));
+
+    if (!trace)
+        return NULL;
+
+    trace->events = malloc(TRACE_CAPACITY * sizeof(TraceEvent));
+    if (!trace->events) {
+        free(trace);
+        return NULL;
+    }
+
+    trace->ppu = ppu;
+    trace->count = 0;
+    return trace;
+}
+
+void TraceDestroy(Trace *trace) {
+    free(trace->events);
+    free(trace);
+}
+
+void TraceLog(Trace *trace, TRACE_EVENT type, uint16_t addr, uint8_t value) {
+    TraceEvent *event = &trace->events[trace->count++ & TRACE_MASK];
+
+    event->cycle = *trace->ppu->totalCycles;
+    event->scanline = trace->ppu->scanline;
+    event->dot = trace->ppu->cycle;
+    event->addr = addr;
+    event->value = value;
+    event->type = type;
+}
+
+static void WriteEvent(const TraceEvent *event, FILE *out) {
+    const char *phase = "i";
+    const char *name;
+    int32_t track = TRACK_CPU;
+    char label[32];
+
+    switch (event->type) {
+        case TRACE_NMI:
+            name = "NMI";
+            break;
+        case TRACE_IRQ:
+            name = "IRQ";
+            break;
+        case TRACE_VBLANK_START:
+        case TRACE_VBLANK_END:
+            name = "VBlank";
+            phase = event->type == TRACE_VBLANK_START ? "B" : "E";
+            track = TRACK_PPU;
+            break;
+        case TRACE_SPRITE0_HIT:
+            name = "Sprite 0 hit";
+            track = TRACK_PPU;
+            break;
+        case TRACE_PPU_READ:
+        case TRACE_PPU_WRITE:
+            snprintf(label, sizeof(label), "%s %s", gRegisterNames[event->addr & 7],
+                     event->type == TRACE_PPU_READ ? "read" : "write");
+            name = label;
+            break;
+        default:
+            name = "OAMDMA";
+            break;
+    }
+
+    fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"%s\",%s\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+                 "\"args\":{\"cycle\":%lu,\"scanline\":%u,\"dot\":%u",
+            name, phase, *phase == 'i' ? "\"s\":\"t\"," : "", event->cycle * 1e6 / CPU_CLOCK_HZ,
+            track, event->cycle, event->scanline, event->dot);
+
+    if (event->type >= TRACE_PPU_READ)
+        fprintf(out, ",\"addr\":\"$%04X\",\"value\":\"$%02X\"", event->addr, event->value);
+
+    fputs("}}", out);
+}
+
+void TraceWriteJson(const Trace *trace, FILE *out) {
+    uint64_t first = trace->count > TRACE_CAPACITY ? trace->count - TRACE_CAPACITY : 0;
+    uint8_t inVblank = 0;
+
+    fprintf(out, "{\"otherData\":{\"dropped\":%lu},\"traceEvents\":[\n", first);
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"CPU\"}},\n",
+            TRACK_CPU);
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"PPU\"}}",
+            TRACK_PPU);
+
+    for (uint64_t i = first; i < trace->count; ++i) {
+        const TraceEvent *event = &trace->events[i & TRACE_MASK];
+
+        /* Power on and the ring both can leave an end without its start. */
+        if (event->type == TRACE_VBLANK_END && !inVblank)
+            continue;
+        if (event->type == TRACE_VBLANK_START || event->type == TRACE_VBLANK_END)
+            inVblank = event->type == TRACE_VBLANK_START;
+
+        WriteEvent(event, out);
+    }
+
+    fputs("\n]}\n", out);
+}
@@ -0,0 +1,55 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Events kept, a power of two. Older ones are overwritten. */
+#define TRACE_CAPACITY 65536
+
+typedef struct _Ppu Ppu;
+
+typedef enum _TRACE_EVENT {
+    TRACE_NMI,          /* NMI asserted */
+    TRACE_IRQ,          /* IRQ asserted, which is how a mapper IRQ arrives */
+    TRACE_VBLANK_START,
+    TRACE_VBLANK_END,
+    TRACE_SPRITE0_HIT,
+    TRACE_PPU_READ,     /* $2000-$2007 read, addr and the value read */
+    TRACE_PPU_WRITE,    /* $2000-$2007 write, addr and the value */
+    TRACE_OAM_DMA       /* $4014 write, value is the page */
+} TRACE_EVENT;
+
+typedef struct _TraceEvent {
+    uint64_t cycle;
+    uint16_t scanline;
+    uint16_t dot;
+    uint16_t addr;
+    uint8_t value;
+    uint8_t type;
+} TraceEvent;
+
+/* A timeline of one Nes's CPU, PPU and bus events. Every event is stamped
+ * with the CPU cycle and the PPU scanline and dot; register accesses get
+ * the position the instruction started at, since the CPU runs an
+ * instruction in one go. Each Nes has its own fixed ring that only its
+ * emulation thread writes, so recording takes no locks, never allocates
+ * and costs the same per event however long the run. */
+typedef struct _Trace {
+    const Ppu *ppu;
+    TraceEvent *events;
+    /* Events ever recorded, the latest TRACE_CAPACITY are in the ring. */
+    uint64_t count;
+} Trace;
+
+/* Stamps events with ppu's position. Returns NULL when out of memory. */
+Trace *TraceCreate(const Ppu *ppu);
+void TraceDestroy(Trace *trace);
+
+void TraceLog(Trace *trace, TRACE_EVENT type, uint16_t addr, uint8_t value);
+
+/* Chrome trace-event JSON, for chrome://tracing or Perfetto. CPU events
+ * are on one track, PPU events on another and VBlank is a span. */
+void TraceWriteJson(const Trace *trace, FILE *out);
+
+#endif
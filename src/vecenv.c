@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "vecenv.h"
+#include "cartridge.h"
+
+static void RunJob(VecEnv *venv) {
+    uint32_t index;
+
+    while ((index = atomic_fetch_add(&venv->next, 1)) < venv->num)
+        venv->job(venv, index);
+}
+
+static void *Worker(void *arg) {
+    VecEnv *venv = arg;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&venv->lock);
+    for (;;) {
+        while (venv->generation == seen && !venv->quit)
+            pthread_cond_wait(&venv->start, &venv->lock);
+
+        if (venv->quit)
+            break;
+
+        seen = venv->generation;
+        pthread_mutex_unlock(&venv->lock);
+
+        RunJob(venv);
+
+        pthread_mutex_lock(&venv->lock);
+        if (--venv->busy == 0)
+            pthread_cond_signal(&venv->done);
+    }
+    pthread_mutex_unlock(&venv->lock);
+
+    return NULL;
+}
+
+/* Runs job on every environment and returns once all of them are done. */
+static void Dispatch(VecEnv *venv, VecEnvJob job) {
+    venv->job = job;
+    atomic_store(&venv->next, 0);
+
+    pthread_mutex_lock(&venv->lock);
+    ++venv->generation;
+    venv->busy = venv->threadNum - 1;
+    pthread_cond_broadcast(&venv->start);
+    pthread_mutex_unlock(&venv->lock);
+
+    RunJob(venv);
+
+    pthread_mutex_lock(&venv->lock);
+    while (venv->busy)
+        pthread_cond_wait(&venv->done, &venv->lock);
+    pthread_mutex_unlock(&venv->lock);
+}
+
+static void StepJob(VecEnv *venv, uint32_t index) {
+    Nes *nes = &venv->envs[index];
+    const VecEnvOutput *out = venv->out;
+    uint8_t wantsPixels = out && (out->frames || out->rgba);
+
+    if (venv->actions)
+        NesSetButtons(nes, venv->actions + index * CONTROLLER_NUM);
+
+    /* Only the last frame is looked at, so only it is drawn. */
+    for (uint32_t i = 0; i < venv->frameNum; ++i) {
+        nes->ppu.renderPixels = wantsPixels && i + 1 == venv->frameNum;
+        NesRunFrame(nes);
+    }
+
+    if (!out)
+        return;
+
+    if (out->frames)
+        memcpy(out->frames + (size_t)index * PPU_WIDTH * PPU_HEIGHT,
+               NesFrameBuffer(nes), PPU_WIDTH * PPU_HEIGHT);
+
+    if (out->rgba)
+        NesFrameRgba(nes, out->rgba + (size_t)index * PPU_WIDTH * PPU_HEIGHT);
+
+    if (out->ram)
+        memcpy(out->ram + (size_t)index * CPU_RAM_SIZE, nes->mem.cpuRam, CPU_RAM_SIZE);
+
+    if (out->hashes)
+        out->hashes[index] = NesStateHash(nes);
+}
+
+static void ResetJob(VecEnv *venv, uint32_t index) {
+    if (venv->mask && !venv->mask[index])
+        return;
+
+    NesLoadState(&venv->envs[index], venv->boot, venv->bootSize);
+}
+
+VecEnv *VecEnvCreateCart(const Cartridge *cart, uint32_t num, uint32_t threads) {
+    if (num == 0) {
+        fprintf(stderr, "A vector environment needs at least one console\n");
+        return NULL;
+    }
+
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? cpus : 1;
+    }
+
+    if (threads > num)
+        threads = num;
+
+    VecEnv *venv = malloc(sizeof(VecEnv));
+    if (!venv)
+        goto oom;
+
+    /* Counts consoles as they're made, for cleaning up after a failure. */
+    venv->num = 0;
+    venv->envs = aligned_alloc(_Alignof(Nes), (size_t)num * sizeof(Nes));
+    venv->boot = NULL;
+    venv->threads = malloc(threads * sizeof(pthread_t));
+    if (!venv->envs || !venv->threads)
+        goto oom;
+
+    for (; venv->num < num; ++venv->num) {
+        Cartridge *clone = CartridgeClone(cart);
+        if (!clone)
+            goto oom;
+
+        NesInitCart(&venv->envs[venv->num], clone);
+    }
+
+    venv->bootSize = NesStateSize(&venv->envs[0]);
+    venv->boot = malloc(venv->bootSize);
+    if (!venv->boot)
+        goto oom;
+    NesSaveState(&venv->envs[0], venv->boot);
+
+    venv->threadNum = threads;
+    venv->generation = 0;
+    venv->busy = 0;
+    venv->quit = 0;
+    venv->actions = NULL;
+    venv->mask = NULL;
+    venv->frameNum = 0;
+    venv->out = NULL;
+    atomic_init(&venv->next, 0);
+
+    pthread_mutex_init(&venv->lock, NULL);
+    pthread_cond_init(&venv->start, NULL);
+    pthread_cond_init(&venv->done, NULL);
+
+    for (uint32_t i = 1; i < threads; ++i) {
+        if (pthread_create(&venv->threads[i], NULL, Worker, venv) != 0) {
+            fprintf(stderr, "Couldn't start vector environment thread %u\n", i);
+            venv->threadNum = i;
+            VecEnvDestroy(venv);
+            return NULL;
+        }
+    }
+
+    return venv;
+
+oom:
+    fprintf(stderr, "Not enough memory for %u consoles\n", num);
+    if (venv) {
+        for (uint32_t i = 0; i < venv->num; ++i)
+            NesDestroy(&venv->envs[i]);
+
+        free(venv->envs);
+        free(venv->boot);
+        free(venv->threads);
+        free(venv);
+    }
+
+    return NULL;
+}
+
+VecEnv *VecEnvCreate(const char *romPath, uint32_t num, uint32_t threads) {
+    Cartridge *cart = CartridgeLoadFile(romPath);
+    if (!cart)
+        return NULL;
+
+    VecEnv *venv = VecEnvCreateCart(cart, num, threads);
+
+    CartridgeDestroy(cart);
+    free(cart);
+
+    return venv;
+}
+
+void VecEnvDestroy(VecEnv *venv) {
+    pthread_mutex_lock(&venv->lock);
+    venv->quit = 1;
+    pthread_cond_broadcast(&venv->start);
+    pthread_mutex_unlock(&venv->lock);
+
+    for (uint32_t i = 1; i < venv->threadNum; ++i)
+        pthread_join(venv->threads[i], NULL);
+
+    pthread_mutex_destroy(&venv->lock);
+    pthread_cond_destroy(&venv->start);
+    pthread_cond_destroy(&venv->done);
+
+    for (uint32_t i = 0; i < venv->num; ++i)
+        NesDestroy(&venv->envs[i]);
+
+    free(venv->envs);
+    free(venv->boot);
+    free(venv->threads);
+    free(venv);
+}
+
+void VecEnvStep(VecEnv *venv, const uint8_t *actions, uint32_t frames, const VecEnvOutput *out) {
+    venv->actions = actions;
+    venv->frameNum = frames;
+    venv->out = out;
+
+    Dispatch(venv, StepJob);
+}
+
+void VecEnvReset(VecEnv *venv, const uint8_t *mask) {
+    venv->mask = mask;
+
+    Dispatch(venv, ResetJob);
+}
+
+void VecEnvSetBoot(VecEnv *venv, uint32_t index) {
+    if (index >= venv->num)
+        return;
+
+    NesSaveState(&venv->envs[index], venv->boot);
+}
@@ -0,0 +1,74 @@
+#ifndef VECENV_H_
+#define VECENV_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "nes.h"
+
+/* Caller-owned, contiguous arrays with one row per environment, written in
+ * place by VecEnvStep. Any of them may be NULL to skip that output.
+ *   frames: num x PPU_HEIGHT x PPU_WIDTH palette indices
+ *   rgba:   num x PPU_HEIGHT x PPU_WIDTH RGBA pixels
+ *   ram:    num x CPU_RAM_SIZE
+ *   hashes: num state hashes */
+typedef struct _VecEnvOutput {
+    uint8_t *frames;
+    uint32_t *rgba;
+    uint8_t *ram;
+    uint32_t *hashes;
+} VecEnvOutput;
+
+typedef struct _VecEnv VecEnv;
+typedef void (*VecEnvJob)(VecEnv *venv, uint32_t index);
+
+/* A batch of consoles stepped in lockstep by a thread pool. The calling
+ * thread works too, so a pool of threadNum has threadNum - 1 workers. Each
+ * job hands out environments one at a time from an atomic counter. */
+typedef struct _VecEnv {
+    uint32_t num;
+    Nes *envs;
+
+    /* Save state restored by VecEnvReset. Starts out as the power-on state. */
+    uint8_t *boot;
+    size_t bootSize;
+
+    uint32_t threadNum;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;
+    uint32_t busy;
+    uint8_t quit;
+
+    VecEnvJob job;
+    atomic_uint next;
+
+    /* Arguments of the running job. */
+    const uint8_t *actions;
+    const uint8_t *mask;
+    uint32_t frameNum;
+    const VecEnvOutput *out;
+} VecEnv;
+
+/* threads = 0 uses one per online CPU. Returns NULL on failure. */
+VecEnv *VecEnvCreate(const char *romPath, uint32_t num, uint32_t threads);
+VecEnv *VecEnvCreateCart(const Cartridge *cart, uint32_t num, uint32_t threads);
+void VecEnvDestroy(VecEnv *venv);
+
+/* Holds actions[i * CONTROLLER_NUM + port] on every environment for frames
+ * frames, then fills in out for the last one. NULL actions keeps holding
+ * the previous buttons. */
+void VecEnvStep(VecEnv *venv, const uint8_t *actions, uint32_t frames, const VecEnvOutput *out);
+
+/* Restores the boot snapshot, for every environment whose mask byte is set,
+ * or all of them when mask is NULL. */
+void VecEnvReset(VecEnv *venv, const uint8_t *mask);
+
+/* Makes environment index's current state the one VecEnvReset restores,
+ * e.g. to start every episode past the title screen. */
+void VecEnvSetBoot(VecEnv *venv, uint32_t index);
+
+#endif
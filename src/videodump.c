@@ -0,0 +1,280 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "videodump.h"
+#include "ppu.h"
+
+#define SLOT_ALIGN   4096
+#define FRAME_PIXELS (PPU_WIDTH * PPU_HEIGHT)
+
+/* NTSC runs at 39375000 / 655171 = 60.0988 Hz. */
+static const char gY4mHeader[] = "YUV4MPEG2 W%u H%u F39375000:655171 Ip A8:7 C444\n";
+static const char gY4mFrame[] = "FRAME\n";
+#define Y4M_FRAME_LEN (sizeof(gY4mFrame) - 1)
+
+static uint8_t Clamp(double value) {
+    return value < 0 ? 0 : value > 255 ? 255 : (uint8_t)(value + 0.5);
+}
+
+static void BuildTables(VideoDump *dump, const Palette *pal) {
+    dump->palette = *pal;
+
+    for (uint16_t i = 0; i < PALETTE_LUT_SIZE; ++i) {
+        uint8_t c[4];
+        memcpy(c, &pal->rgba[i], 4);
+
+        dump->y[i] = Clamp(16 + ( 65.481 * c[0] + 128.553 * c[1] +  24.966 * c[2]) / 255);
+        dump->u[i] = Clamp(128 + (-37.797 * c[0] -  74.203 * c[1] + 112.000 * c[2]) / 255);
+        dump->v[i] = Clamp(128 + (112.000 * c[0] -  93.786 * c[1] -  18.214 * c[2]) / 255);
+    }
+}
+
+static size_t HeaderSize(const VideoDump *dump) {
+    return dump->format == DUMP_Y4M ? Y4M_FRAME_LEN : 0;
+}
+
+static uint8_t WriteAll(int fd, const void *data, size_t size) {
+    const uint8_t *bytes = data;
+
+    while (size) {
+        ssize_t n = write(fd, bytes, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+
+        bytes += n;
+        size -= n;
+    }
+
+    return 1;
+}
+
+uint8_t VideoDumpOpen(VideoDump *dump, const char *path, DUMP_FORMAT format,
+                      DUMP_POLICY policy, const Palette *pal, SCALE_FILTER filter, uint32_t factor) {
+    char header[sizeof(gY4mHeader) + 16];
+
+    if (!ScalerInit(&dump->scaler, filter, factor, SCALE_KERNEL_AUTO))
+        return 0;
+
+    dump->format = format;
+    dump->policy = policy;
+    dump->head = 0;
+    dump->queued = 0;
+    dump->headWritten = 0;
+    dump->frames = 0;
+    dump->dropped = 0;
+    dump->frameSize = (size_t)dump->scaler.width * dump->scaler.height * (format == DUMP_Y4M ? 3 : 4);
+    dump->rgba = filter == SCALE_NONE ? NULL : malloc(FRAME_PIXELS * sizeof(uint32_t));
+
+    BuildTables(dump, pal);
+
+    /* aligned_alloc wants a multiple of the alignment. */
+    size_t slotsSize = (VIDEO_DUMP_SLOTS * dump->frameSize + SLOT_ALIGN - 1) & ~(size_t)(SLOT_ALIGN - 1);
+
+    dump->slots = aligned_alloc(SLOT_ALIGN, slotsSize);
+    if (!dump->slots || (filter != SCALE_NONE && !dump->rgba)) {
+        fprintf(stderr, "Not enough memory for the video dump\n");
+        ScalerDestroy(&dump->scaler);
+        free(dump->slots);
+        free(dump->rgba);
+        dump->slots = NULL;
+        dump->rgba = NULL;
+        return 0;
+    }
+
+    /* A reader going away should end the dump, not the emulator. */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Opening a FIFO waits here for the reader to show up. */
+    dump->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dump->fd < 0) {
+        fprintf(stderr, "Couldn't open video dump %s\n", path);
+        ScalerDestroy(&dump->scaler);
+        free(dump->slots);
+        free(dump->rgba);
+        dump->slots = NULL;
+        dump->rgba = NULL;
+        return 0;
+    }
+
+    snprintf(header, sizeof(header), gY4mHeader, dump->scaler.width, dump->scaler.height);
+
+    if (format == DUMP_Y4M && !WriteAll(dump->fd, header, strlen(header))) {
+        fprintf(stderr, "Couldn't write video dump header\n");
+        VideoDumpClose(dump);
+        return 0;
+    }
+
+    if (policy == DUMP_DROP)
+        fcntl(dump->fd, F_SETFL, fcntl(dump->fd, F_GETFL) | O_NONBLOCK);
+
+    return 1;
+}
+
+static uint8_t *Slot(VideoDump *dump, uint32_t index) {
+    return dump->slots + (size_t)(index % VIDEO_DUMP_SLOTS) * dump->frameSize;
+}
+
+/* Writes queued frames until done, or until the pipe is full when dropping. */
+static void Flush(VideoDump *dump) {
+    struct iovec iov[2 * VIDEO_DUMP_SLOTS];
+    size_t headerSize = HeaderSize(dump);
+
+    while (dump->queued) {
+        uint32_t count = 0;
+
+        for (uint32_t i = 0; i < dump->queued; ++i) {
+            if (headerSize) {
+                iov[count].iov_base = (void *)gY4mFrame;
+                iov[count++].iov_len = headerSize;
+            }
+            iov[count].iov_base = Slot(dump, dump->head + i);
+            iov[count++].iov_len = dump->frameSize;
+        }
+
+        /* Skip what already went out of the head frame. */
+        struct iovec *first = iov;
+        size_t skip = dump->headWritten;
+        while (skip >= first->iov_len) {
+            skip -= first->iov_len;
+            ++first;
+            --count;
+        }
+        first->iov_base = (uint8_t *)first->iov_base + skip;
+        first->iov_len -= skip;
+
+        ssize_t n = writev(dump->fd, first, count);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                return;
+
+            fprintf(stderr, "Video dump write failed, closing it\n");
+            dump->dropped += dump->queued;
+            close(dump->fd);
+            free(dump->slots);
+            free(dump->rgba);
+            ScalerDestroy(&dump->scaler);
+            dump->fd = -1;
+            dump->slots = NULL;
+            dump->rgba = NULL;
+            return;
+        }
+
+        size_t written = dump->headWritten + n;
+        size_t perFrame = headerSize + dump->frameSize;
+
+        dump->head += written / perFrame;
+        dump->queued -= written / perFrame;
+        dump->headWritten = written % perFrame;
+    }
+}
+
+static void ConvertY4m(const VideoDump *dump, const uint8_t *indices,
+                       const uint8_t *emphasis, uint8_t *out) {
+    uint8_t *y = out;
+    uint8_t *u = out + FRAME_PIXELS;
+    uint8_t *v = out + 2 * FRAME_PIXELS;
+
+    for (uint32_t i = 0; i < FRAME_PIXELS; ++i) {
+        uint16_t index = (emphasis[i / PPU_WIDTH] & (PALETTE_EMPHASIS_NUM - 1)) * PALETTE_COLORS +
+                         (indices[i] & (PALETTE_COLORS - 1));
+
+        y[i] = dump->y[index];
+        u[i] = dump->u[index];
+        v[i] = dump->v[index];
+    }
+}
+
+/* The scaled frames have left the palette behind, so they are converted a
+ * pixel at a time, in 16-bit fixed point with the BuildTables coefficients. */
+static void ConvertRgbaY4m(const uint32_t *rgba, size_t count, uint8_t *out) {
+    uint8_t *y = out;
+    uint8_t *u = out + count;
+    uint8_t *v = out + 2 * count;
+
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t c[4];
+        memcpy(c, &rgba[i], 4);
+
+        y[i] = ((16 << 16) + 16829 * c[0] + 33039 * c[1] + 6416 * c[2] + 0x8000) >> 16;
+        u[i] = ((128 << 16) - 9714 * c[0] - 19071 * c[1] + 28784 * c[2] + 0x8000) >> 16;
+        v[i] = ((128 << 16) + 28784 * c[0] - 24103 * c[1] - 4681 * c[2] + 0x8000) >> 16;
+    }
+}
+
+static void ConvertScaled(VideoDump *dump, const uint8_t *frameBuffer, const uint8_t *emphasis,
+                          uint8_t *out) {
+    PaletteConvertFrame(&dump->palette, frameBuffer, emphasis, dump->rgba);
+
+    const uint32_t *pixels = ScalerRun(&dump->scaler, dump->rgba);
+    size_t count = (size_t)dump->scaler.width * dump->scaler.height;
+
+    if (dump->format == DUMP_Y4M)
+        ConvertRgbaY4m(pixels, count, out);
+    else
+        memcpy(out, pixels, count * sizeof(uint32_t));
+}
+
+void VideoDumpFrame(VideoDump *dump, const uint8_t *frameBuffer, const uint8_t *emphasis) {
+    if (dump->queued == VIDEO_DUMP_SLOTS) {
+        if (dump->policy == DUMP_DROP) {
+            Flush(dump);
+
+            if (dump->queued == VIDEO_DUMP_SLOTS) {
+                ++dump->dropped;
+                return;
+            }
+        } else {
+            Flush(dump);
+        }
+
+        if (dump->fd < 0)
+            return;
+    }
+
+    uint8_t *slot = Slot(dump, dump->head + dump->queued);
+
+    if (dump->rgba)
+        ConvertScaled(dump, frameBuffer, emphasis, slot);
+    else if (dump->format == DUMP_Y4M)
+        ConvertY4m(dump, frameBuffer, emphasis, slot);
+    else
+        PaletteConvertFrame(&dump->palette, frameBuffer, emphasis, (uint32_t *)slot);
+
+    ++dump->queued;
+    ++dump->frames;
+
+    if (dump->queued >= VIDEO_DUMP_BATCH || dump->policy == DUMP_DROP)
+        Flush(dump);
+}
+
+void VideoDumpClose(VideoDump *dump) {
+    if (dump->fd < 0)
+        return;
+
+    /* Whatever is still queued is worth waiting for now. */
+    fcntl(dump->fd, F_SETFL, fcntl(dump->fd, F_GETFL) & ~O_NONBLOCK);
+    dump->policy = DUMP_BLOCK;
+    Flush(dump);
+
+    if (dump->dropped)
+        fprintf(stderr, "Video dump: %lu frames written, %lu dropped\n", dump->frames, dump->dropped);
+
+    close(dump->fd);
+    free(dump->slots);
+    free(dump->rgba);
+    ScalerDestroy(&dump->scaler);
+
+    dump->fd = -1;
+    dump->slots = NULL;
+    dump->rgba = NULL;
+}
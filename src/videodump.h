@@ -0,0 +1,55 @@
+#ifndef VIDEODUMP_H_
+#define VIDEODUMP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "palette.h"
+#include "scaler.h"
+
+#define VIDEO_DUMP_SLOTS 8
+#define VIDEO_DUMP_BATCH 4
+
+typedef enum _DUMP_FORMAT {
+    DUMP_Y4M,  /* YUV4MPEG2, 4:4:4 BT.601 */
+    DUMP_RGBA  /* Raw RGBA frames, no header */
+} DUMP_FORMAT;
+
+typedef enum _DUMP_POLICY {
+    DUMP_BLOCK, /* Backpressure: wait for the consumer */
+    DUMP_DROP   /* Never wait, drop frames when the ring is full */
+} DUMP_POLICY;
+
+/* Streams frames to a file or FIFO. Frames are converted straight into a
+ * ring of aligned slots and written out in batches with writev. */
+typedef struct _VideoDump {
+    int fd;
+    DUMP_FORMAT format;
+    DUMP_POLICY policy;
+
+    uint8_t *slots;
+    size_t frameSize;
+    uint32_t head;
+    uint32_t queued;
+    /* Bytes of the head frame, header included, already written. */
+    size_t headWritten;
+
+    uint64_t frames;
+    uint64_t dropped;
+
+    Palette palette;
+    uint8_t y[PALETTE_LUT_SIZE];
+    uint8_t u[PALETTE_LUT_SIZE];
+    uint8_t v[PALETTE_LUT_SIZE];
+
+    /* Frames are upscaled from rgba unless the filter is SCALE_NONE. */
+    Scaler scaler;
+    uint32_t *rgba;
+} VideoDump;
+
+uint8_t VideoDumpOpen(VideoDump *dump, const char *path, DUMP_FORMAT format,
+                      DUMP_POLICY policy, const Palette *pal, SCALE_FILTER filter, uint32_t factor);
+void VideoDumpFrame(VideoDump *dump, const uint8_t *frameBuffer, const uint8_t *emphasis);
+void VideoDumpClose(VideoDump *dump);
+
+#endif